@@ -0,0 +1,78 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Find the classes, fields and methods annotated with given annotation types
+ *
+ * Before a class is parsed its constant pool is checked for the type
+ * descriptors of the annotations, which every class using one of them has to
+ * contain. Only the classes that pass this check are parsed, so the cost for
+ * all other classes is a single walk over their constant pool. A search can
+ * be used by many threads at once.
+ */
+
+#ifndef __JAVAANNOTATIONSEARCH_H__
+#define __JAVAANNOTATIONSEARCH_H__
+
+#include <glib.h>
+
+#include "javaarchive.h"
+#include "javaclass.h"
+
+typedef struct _JavaAnnotationSearch JavaAnnotationSearch;
+
+/*
+ * Called for every use of one of the annotations
+ *
+ * field and method are NULL if the class itself is annotated, type is the
+ * index of the annotation type. The class is only valid during the call.
+ */
+typedef void (*JavaAnnotationMatchFunc)(const gchar *location, JavaClass *c,
+        JavaField *field, JavaMethod *method, guint type,
+        gpointer user_data);
+
+/*
+ * Create a search for a NULL terminated array of annotation type
+ * descriptors like "Ljavax/persistence/Entity;"
+ */
+JavaAnnotationSearch* javaannotationsearch_new(const gchar **types);
+
+/*
+ * Search the annotations of a class
+ *
+ * Returns FALSE and sets error if the class is malformed.
+ */
+gboolean javaannotationsearch_scan(JavaAnnotationSearch *search,
+        const guchar *classbytes, guint32 length, const gchar *location,
+        JavaAnnotationMatchFunc func, gpointer user_data, GError **error);
+
+/*
+ * Search the annotations of all classes in an archive
+ *
+ * The location passed to func is "<archive>!<entry>". Malformed classes are
+ * skipped, the number of classes scanned is returned.
+ */
+guint javaannotationsearch_scan_archive(JavaAnnotationSearch *search,
+        JavaArchive *archive, JavaAnnotationMatchFunc func,
+        gpointer user_data);
+
+/*
+ * Free a search
+ */
+void javaannotationsearch_free(JavaAnnotationSearch *search);
+
+#endif /* __JAVAANNOTATIONSEARCH_H__ */
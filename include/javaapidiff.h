@@ -0,0 +1,99 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Comparison of the API of two versions of a class or an archive
+ *
+ * The API of a class are its public and protected fields and methods that
+ * aren't synthetic. A diff reports members that were added to or removed
+ * from the API, changes of their access flags and of the exceptions methods
+ * declare, and changes of the access flags, the superclass and the
+ * interfaces of the class. A member that becomes private is reported as a
+ * change of its access flags.
+ *
+ * Members are matched by a hash of their name and descriptor: both versions
+ * are sorted by it and then merged, so a comparison takes O(n log n) and
+ * names are only compared when two hashes are equal. Members are therefore
+ * reported in the order of their hashes, not in the order of the class.
+ */
+
+#ifndef __JAVAAPIDIFF_H__
+#define __JAVAAPIDIFF_H__
+
+#include <glib.h>
+
+#include "javaarchive.h"
+#include "javaclass.h"
+
+typedef enum
+{
+    JAVAAPIDIFF_CLASS_ADDED,         // only for archives
+    JAVAAPIDIFF_CLASS_REMOVED,       // only for archives
+    JAVAAPIDIFF_CLASS_ACCESS,
+    JAVAAPIDIFF_SUPERCLASS,
+    JAVAAPIDIFF_INTERFACE_ADDED,
+    JAVAAPIDIFF_INTERFACE_REMOVED,
+    JAVAAPIDIFF_FIELD_ADDED,
+    JAVAAPIDIFF_FIELD_REMOVED,
+    JAVAAPIDIFF_FIELD_ACCESS,
+    JAVAAPIDIFF_METHOD_ADDED,
+    JAVAAPIDIFF_METHOD_REMOVED,
+    JAVAAPIDIFF_METHOD_ACCESS,
+    JAVAAPIDIFF_METHOD_EXCEPTIONS
+} JavaApiChangeKind;
+
+/*
+ * A difference between two versions, the strings are only valid during the
+ * call of the JavaApiDiffFunc
+ */
+typedef struct _JavaApiChange
+{
+    JavaApiChangeKind kind;
+    const gchar *class_name;    // fully qualified name of the class
+    const gchar *name;          // of the member or interface (else NULL)
+    const gchar *descriptor;    // of the member (else NULL)
+    const gchar *old_value;     // superclass or comma separated exceptions
+    const gchar *new_value;     // before and after (else NULL)
+    guint16 old_access;         // access flags of the class or member
+    guint16 new_access;         // before and after
+} JavaApiChange;
+
+typedef void (*JavaApiDiffFunc)(const JavaApiChange *change,
+        gpointer user_data);
+
+/*
+ * Compare two versions of a class and pass every difference to func (which
+ * may be NULL)
+ *
+ * The members are compared whether the class is public or not. Returns the
+ * number of differences.
+ */
+guint javaapidiff_compare(JavaClass *oldc, JavaClass *newc,
+        JavaApiDiffFunc func, gpointer user_data);
+
+/*
+ * Compare the public classes of two versions of an archive, matching them
+ * by their entry names
+ *
+ * Classes that are not public in either version are skipped. Returns the
+ * number of differences or -1 if a class couldn't be read or parsed.
+ */
+gint javaapidiff_compare_archives(JavaArchive *oldarchive,
+        JavaArchive *newarchive, JavaApiDiffFunc func, gpointer user_data,
+        GError **error);
+
+#endif /* __JAVAAPIDIFF_H__ */
@@ -0,0 +1,81 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Read-only access to JAR (ZIP) archives
+ *
+ * The archive is memory mapped and only its central directory is read when
+ * it is opened. Stored entries are returned as views into the mapping,
+ * deflated entries are inflated on demand. Reading entries of an open
+ * archive from several threads at once is safe.
+ */
+
+#ifndef __JAVAARCHIVE_H__
+#define __JAVAARCHIVE_H__
+
+#include <glib.h>
+
+typedef struct _JavaArchive JavaArchive;
+
+typedef struct _JavaArchiveEntry
+{
+    const gchar *name;       // path of the entry inside the archive
+    guint32 offset;          // offset of the local file header
+    guint32 compressed_size;
+    guint32 size;
+    guint16 method;          // 0 = stored, 8 = deflated
+} JavaArchiveEntry;
+
+/*
+ * Open an archive and read its central directory
+ */
+JavaArchive* javaarchive_open(const gchar *filename, GError **error);
+
+/*
+ * Get the filename the archive was opened from
+ */
+const gchar* javaarchive_get_filename(JavaArchive *archive);
+
+/*
+ * Get the number of entries in the central directory
+ */
+guint javaarchive_get_entry_count(JavaArchive *archive);
+
+/*
+ * Get an entry of the central directory
+ */
+const JavaArchiveEntry* javaarchive_get_entry(JavaArchive *archive, guint i);
+
+/*
+ * Is this entry a class file?
+ */
+gboolean javaarchive_entry_is_class(const JavaArchiveEntry *entry);
+
+/*
+ * Read the uncompressed contents of an entry
+ *
+ * The bytes keep the archive mapping alive, so they may outlive the archive.
+ */
+GBytes* javaarchive_read_entry(JavaArchive *archive,
+        const JavaArchiveEntry *entry, GError **error);
+
+/*
+ * Close an archive
+ */
+void javaarchive_free(JavaArchive *archive);
+
+#endif /* __JAVAARCHIVE_H__ */
@@ -0,0 +1,78 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Decoding of JVM bytecode
+ *
+ * The decoder walks the code array of a method instruction by instruction
+ * and tells the length and operand of every instruction, including the
+ * variable length tableswitch, lookupswitch and wide instructions. It never
+ * reads beyond the end of the code array and doesn't allocate memory.
+ */
+
+#ifndef __JAVABYTECODE_H__
+#define __JAVABYTECODE_H__
+
+#include <glib.h>
+
+#define JAVABYTECODE_OPCODE_COUNT 202
+
+#define JAVABYTECODE_LDC            18
+#define JAVABYTECODE_MONITORENTER   194
+#define JAVABYTECODE_MONITOREXIT    195
+#define JAVABYTECODE_INVOKEDYNAMIC  186
+#define JAVABYTECODE_WIDE           196
+
+/*
+ * What the operand of an instruction refers to
+ */
+typedef enum
+{
+    JAVABYTECODE_OPERAND_NONE,
+    JAVABYTECODE_OPERAND_CONSTANT,  // index into the constant pool
+    JAVABYTECODE_OPERAND_LOCAL,     // index of a local variable
+    JAVABYTECODE_OPERAND_BRANCH,    // signed offset of the branch target
+    JAVABYTECODE_OPERAND_IMMEDIATE, // immediate value like for bipush
+    JAVABYTECODE_OPERAND_SWITCH     // jump table of a switch
+} JavaBytecodeOperand;
+
+typedef struct _JavaInstruction
+{
+    guint32 offset;         // offset of the opcode in the code array
+    guint32 length;         // length including opcode and operands
+    guint8 opcode;          // for wide instructions the widened opcode
+    gboolean wide;
+    JavaBytecodeOperand operand;
+    guint16 cp_index;       // for JAVABYTECODE_OPERAND_CONSTANT (counting
+                            // from 1 like the class file)
+} JavaInstruction;
+
+/*
+ * Decode the instruction at offset
+ *
+ * Returns the length of the instruction or 0 if it is invalid or would end
+ * beyond codelen.
+ */
+guint32 javabytecode_decode(const guchar *code, guint32 codelen,
+        guint32 offset, JavaInstruction *instruction);
+
+/*
+ * Get the mnemonic of an opcode (NULL if the opcode is invalid)
+ */
+const gchar* javabytecode_get_opcode_name(guint8 opcode);
+
+#endif /* __JAVABYTECODE_H__ */
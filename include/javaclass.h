@@ -38,39 +38,62 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 typedef enum
 {
     JAVACLASS_ERROR_UNSUPPORTED_VERSION,
-    JAVACLASS_ERROR_TAG_UNKNOWN
+    JAVACLASS_ERROR_TAG_UNKNOWN,
+    JAVACLASS_ERROR_INVALID_ARCHIVE,
+    JAVACLASS_ERROR_CLASS_NOT_FOUND,
+    JAVACLASS_ERROR_INVALID_CLASS
 } JavaClassGError;
 
+/*
+ * Options for parsing a class
+ */
+typedef enum
+{
+    // keep the bytecode of the methods
+    JAVACLASS_PARSE_CODE        = 1 << 0,
+    // keep the bytecode but let the methods reference it in the buffer the
+    // class was parsed from instead of copying it (implies
+    // JAVACLASS_PARSE_CODE)
+    JAVACLASS_PARSE_BORROW_CODE = 1 << 1,
+    // only read the names of the class, its parent and its interfaces, the
+    // class has no fields, methods or attributes then
+    JAVACLASS_PARSE_HIERARCHY   = 1 << 2
+} JavaClassParseFlags;
+
 /*
  * Types used to represent a Java class file and its contents
  */
 
+/*
+ * The constant pool is stored as a structure of arrays: a dense array with
+ * the tag of each entry and a parallel array with its 4 byte value. Scans
+ * for all entries of a given tag only touch the tag array and the pool needs
+ * 5 bytes per entry instead of 16 for a struct of tag and 8 byte union.
+ */
 typedef union _cp_value
 {
-    gchar *str;
+    guint32 offset;     // TAG_UTF8: offset of the string in cp_strings
     gint32 i;
     gfloat f;
-    gint64 l;
-    gdouble d;
-    guint16 index;
-    guint16 indexpair[2];
+    guint32 word;       // TAG_LONG and TAG_DOUBLE occupy two slots anyway so
+                        // we store the high word in the first and the low
+                        // word in the second slot
+    guint16 index;      // also TAG_METHODTYPE, TAG_MODULE and TAG_PACKAGE
+    guint16 indexpair[2]; // TAG_DYNAMIC and TAG_INVOKEDYNAMIC: the index of
+                        // the bootstrap method (not a constant) and of the
+                        // name and type
+    struct {
+        guint8 kind;
+        guint16 index;
+    } handle;           // TAG_METHODHANDLE: the reference kind and index
 } cp_value;
 
-typedef struct _cp_info
-{
-    guchar tag;
-    cp_value value; // we use a union here instead of a pointer to a
-                    // specialized struct per tag like the spec does because
-                    // on a 64 bit machine each pointer takes 8 bytes anyway
-                    // and we would only waste memory if we stored a pointer
-                    // to a <= 8 bytes struct and we also don't have to do more
-                    // mallocs after allocating the initial cp_info array excpet
-                    // for UTF-8 entries
-} cp_info;
-
 typedef struct _attribute_info
 {
     guint16 attribute_name_index;
+    guint8 _kind;       // which of the attributes we know this is (0 if we
+                        // don't, then info is only kept when the class was
+                        // parsed with its bytecode)
     guint32 attribute_length;
     guchar *info;
 } attribute_info;
@@ -99,7 +122,10 @@ typedef struct _JavaClass
    guint16 minor_version;
    guint16 major_version;
    guint16 constant_pool_count;
-   cp_info *constant_pool;
+   guint8 *cp_tags;
+   cp_value *cp_values;
+   gchar *cp_strings;   // all UTF-8 entries back to back, each NUL terminated
+   guint32 cp_strings_size;
 
    guint16 access_flags;
    guint16 this_class;
@@ -118,16 +144,94 @@ typedef struct _JavaClass
    attribute_info *attributes;
 
    // convenience attributes for getters
+   gchar *_fq_name;
+   gchar *_fq_parent;
    gchar *_package;
    gchar *_classname;
    gchar **_interfaces;
    JavaField **_fields;
    JavaMethod **_methods;
    gchar *_signature;
+
+   // hash index for javaclass_find_field()/javaclass_find_method(), built on
+   // first use
+   gpointer _member_index;
+
+   // decoded tables of the "Code" attributes of the methods, each decoded
+   // on first use
+   gpointer _code_tables;
+
+   // arena the class was allocated from (NULL if it owns its memory)
+   struct _JavaArena *_arena;
+
+   // buffer the attributes are borrowed from (NULL if they are copies)
+   GBytes *_bytes;
+
+   gint _refcount;
 } JavaClass;
 
+/*
+ * An entry of the exception table of a method
+ */
+typedef struct _JavaExceptionHandler
+{
+    guint16 start_pc;        // first instruction the handler covers
+    guint16 end_pc;          // first instruction it doesn't cover anymore
+    guint16 handler_pc;
+    const gchar *catch_type; // like java.io.IOException, NULL for finally
+} JavaExceptionHandler;
+
+/*
+ * An entry of the "LineNumberTable" of a method
+ */
+typedef struct _JavaLineNumber
+{
+    guint16 start_pc;
+    guint16 line_number;
+} JavaLineNumber;
+
+/*
+ * An entry of the "LocalVariableTable" of a method
+ */
+typedef struct _JavaLocalVariable
+{
+    guint16 start_pc;        // the variable has a value from start_pc
+    guint16 length;          // up to start_pc + length
+    guint16 index;           // slot in the local variable array
+    const gchar *name;
+    const gchar *descriptor;
+} JavaLocalVariable;
+
+/*
+ * Memory used by a JavaClass object in bytes, broken down by what it is
+ * used for. The numbers are the sizes of the allocations without the
+ * overhead of the allocator.
+ */
+typedef struct _JavaClassMemoryUsage
+{
+    gsize total;          // sum of all of the following except borrowed_code
+    gsize object;         // the JavaClass struct itself
+    gsize constant_pool;  // tag and value arrays of the constant pool
+    gsize strings;        // the UTF-8 entries of the constant pool
+    gsize members;        // interface, field, method and attribute tables
+    gsize attributes;     // retained attribute payloads (including "Code")
+    gsize code;           // copies of the bytecode made for the methods
+    gsize names;          // external names of class, parent and interfaces
+    gsize fields;         // the JavaField objects returned by the getters
+    gsize methods;        // the JavaMethod objects returned by the getters
+    gsize index;          // the member lookup index if it was built
+    gsize code_tables;    // the tables of the "Code" attributes decoded so far
+    gsize borrowed_code;  // bytecode the methods reference in a shared buffer
+} JavaClassMemoryUsage;
+
 /*
  * Methods of the JavaClass structure
+ *
+ * A JavaClass never changes after it was created, so one class can be used
+ * by any number of threads at the same time without locking. This includes
+ * the JavaField and JavaMethod objects returned by the getters, which must
+ * not be modified. The lifetime of a class is managed with an atomic
+ * reference count.
  */
 
 /*
@@ -140,6 +244,25 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
  */
 JavaClass* javaclass_new_from_file(gchar *filename, gboolean includecode, GError **error);
 
+/*
+ * Create a new JavaClass object from a buffer holding all the bytes of a class
+ *
+ * flags is a combination of JavaClassParseFlags. With
+ * JAVACLASS_PARSE_BORROW_CODE the bytecode of the methods points into bytes
+ * and every method holds a reference on it, so the buffer stays alive as long
+ * as any method uses it. Otherwise bytes isn't used after the call returns.
+ */
+JavaClass* javaclass_new_from_bytes(GBytes *bytes, guint flags, GError **error);
+
+/*
+ * Create a new JavaClass object from a memory mapped file
+ *
+ * Together with JAVACLASS_PARSE_BORROW_CODE this retains the bytecode without
+ * copying it. The file stays mapped until the last method is freed.
+ */
+JavaClass* javaclass_new_from_mapped_file(const gchar *filename, guint flags,
+        GError **error);
+
 /*
  * Get the unqualified name of this class
  */
@@ -220,6 +343,73 @@ guint16 javaclass_get_method_number(JavaClass *c);
  */
 JavaMethod** javaclass_get_methods(JavaClass *c);
 
+/*
+ * Find a field of this class by its name (returns NULL if there is none)
+ *
+ * The first lookup builds a hash index of the members of the class, every
+ * following lookup only costs a hash and a string compare.
+ */
+JavaField* javaclass_find_field(JavaClass *c, const gchar *name);
+
+/*
+ * Find a method of this class by its name and descriptor, for example "equals"
+ * and "(Ljava/lang/Object;)Z" (returns NULL if there is none)
+ */
+JavaMethod* javaclass_find_method(JavaClass *c, const gchar *name,
+        const gchar *descriptor);
+
+/*
+ * Get the exception table of a method of this class
+ *
+ * The exception, line number and local variable tables of a method are
+ * decoded from its "Code" attribute the first time one of them is asked for,
+ * so methods nobody looks at cost nothing. They are only there if the class
+ * was parsed with its bytecode, otherwise count is set to 0 and NULL is
+ * returned.
+ */
+const JavaExceptionHandler* javaclass_get_exception_handlers(JavaClass *c,
+        JavaMethod *method, guint *count);
+
+/*
+ * Get the line number table of a method of this class sorted by start_pc
+ */
+const JavaLineNumber* javaclass_get_line_numbers(JavaClass *c,
+        JavaMethod *method, guint *count);
+
+/*
+ * Get the local variable table of a method of this class
+ */
+const JavaLocalVariable* javaclass_get_local_variables(JavaClass *c,
+        JavaMethod *method, guint *count);
+
+/*
+ * Get the source line of the instruction at offset pc of the bytecode of a
+ * method (returns -1 if it isn't known)
+ */
+gint javaclass_get_line_number(JavaClass *c, JavaMethod *method, guint32 pc);
+
+/*
+ * Get the type descriptors of the annotations of this class, like
+ * "Ljavax/persistence/Entity;" (returns NULL if there are none)
+ *
+ * Both runtime visible and invisible annotations are returned, their
+ * element values are skipped. The strings belong to the class, free the
+ * array with g_free(). Annotations are only kept if the class was parsed
+ * with more than JAVACLASS_PARSE_HIERARCHY.
+ */
+const gchar** javaclass_get_annotations(JavaClass *c);
+
+/*
+ * Get the type descriptors of the annotations of a field of this class
+ */
+const gchar** javaclass_get_field_annotations(JavaClass *c, JavaField *field);
+
+/*
+ * Get the type descriptors of the annotations of a method of this class
+ */
+const gchar** javaclass_get_method_annotations(JavaClass *c,
+        JavaMethod *method);
+
 /*
  * Get the major version number of a class file
  */
@@ -240,6 +430,15 @@ const gchar* javaclass_get_version_name(JavaClass *c);
  */
 const gchar* javaclass_get_signature(JavaClass *c);
 
+/*
+ * Get the number of bytes held by a class and optionally a breakdown of them
+ *
+ * Buffers shared with other objects (like the mapping of a class parsed with
+ * JAVACLASS_PARSE_BORROW_CODE) are not part of the total. For classes of a
+ * JavaClassParser the total is the part of the arena the class uses.
+ */
+gsize javaclass_get_memory_usage(JavaClass *c, JavaClassMemoryUsage *usage);
+
 /*
  * Extract the classname component from a fully qualified classname
  */
@@ -251,7 +450,21 @@ gchar* javaclass_extract_classname(const gchar *fqn);
 gchar* javaclass_extract_package(const gchar *fqn);
 
 /*
- * Free all the memory occupied by a JavaClass object
+ * Take a new reference on a class (returns c)
+ *
+ * Classes created by a JavaClassParser aren't reference counted, they live
+ * until the parser is reset.
+ */
+JavaClass* javaclass_ref(JavaClass *c);
+
+/*
+ * Drop a reference and free all the memory occupied by a JavaClass object
+ * once the last reference is gone
+ */
+void javaclass_unref(JavaClass *c);
+
+/*
+ * Same as javaclass_unref()
  */
 void javaclass_free(JavaClass*);
 
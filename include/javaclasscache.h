@@ -0,0 +1,101 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * A cache of parsed classes bounded by the memory the classes use
+ *
+ * Every class is charged what javaclass_get_memory_usage() reports when it
+ * is added, so one large class counts as much as many small ones. Eviction
+ * follows W-TinyLFU: new classes enter a small LRU window and only move on
+ * into the main area (a segmented LRU) if a frequency sketch says they are
+ * used more often than the classes they would push out. A scan over many
+ * classes that are used once therefore can't flush the classes that are
+ * used all the time.
+ *
+ * A cache can be used by many threads at once.
+ */
+
+#ifndef __JAVACLASSCACHE_H__
+#define __JAVACLASSCACHE_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+typedef struct _JavaClassCache JavaClassCache;
+
+/*
+ * Counters of a cache
+ */
+typedef struct _JavaClassCacheStats
+{
+    guint64 hits;
+    guint64 misses;
+    guint64 evictions;    // classes dropped to make room
+    guint64 rejections;   // classes not admitted because they are used less
+    guint classes;        // classes in the cache
+    gsize size;           // bytes charged for them
+} JavaClassCacheStats;
+
+/*
+ * Create a cache that holds up to budget bytes of classes
+ */
+JavaClassCache* javaclasscache_new(gsize budget);
+
+/*
+ * Get a class by its key, for example its fully qualified name (returns a
+ * new reference or NULL if the class isn't cached)
+ */
+JavaClass* javaclasscache_lookup(JavaClassCache *cache, const gchar *key);
+
+/*
+ * Add a class under a key, the cache takes its own reference
+ *
+ * The class may be dropped right away if it is larger than the cache or
+ * used less than the classes it would replace. Classes of a
+ * JavaClassParser can't be cached.
+ */
+void javaclasscache_insert(JavaClassCache *cache, const gchar *key,
+        JavaClass *c);
+
+/*
+ * Get the class parsed from bytes with the given JavaClassParseFlags,
+ * keyed by a hash of its content
+ *
+ * Identical class files (like the same library in several archives) are
+ * parsed once as long as the class stays cached. Returns a new reference.
+ */
+JavaClass* javaclasscache_parse(JavaClassCache *cache, GBytes *bytes,
+        guint flags, GError **error);
+
+/*
+ * Remove a class from the cache
+ */
+void javaclasscache_remove(JavaClassCache *cache, const gchar *key);
+
+/*
+ * Get the counters of a cache
+ */
+void javaclasscache_get_stats(JavaClassCache *cache,
+        JavaClassCacheStats *stats);
+
+/*
+ * Free a cache and release its references on the classes
+ */
+void javaclasscache_free(JavaClassCache *cache);
+
+#endif /* __JAVACLASSCACHE_H__ */
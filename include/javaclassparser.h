@@ -0,0 +1,70 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * A reusable parser context for reading many classes in a row
+ *
+ * The parser owns a read buffer and an arena that all the classes it creates
+ * are allocated from. Resetting the parser recycles that memory, so a worker
+ * that parses class after class stops calling malloc once the buffers have
+ * grown to the size of the largest class. A parser must only be used by one
+ * thread at a time.
+ */
+
+#ifndef __JAVACLASSPARSER_H__
+#define __JAVACLASSPARSER_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+typedef struct _JavaClassParser JavaClassParser;
+
+/*
+ * Create a new parser context
+ */
+JavaClassParser* javaclass_parser_new(void);
+
+/*
+ * Parse a class from an array of all the bytes of this class
+ *
+ * The returned class belongs to the parser and stays valid until the next
+ * call of javaclass_parser_reset() or javaclass_parser_free(). Calling
+ * javaclass_free() on it is allowed but doesn't do anything.
+ */
+JavaClass* javaclass_parser_parse(JavaClassParser *parser, guchar *classbytes,
+        guint32 length, gboolean includecode, GError **error);
+
+/*
+ * Parse a class from a file using the read buffer of the parser
+ *
+ * The same lifetime rules as for javaclass_parser_parse() apply.
+ */
+JavaClass* javaclass_parser_parse_file(JavaClassParser *parser,
+        const gchar *filename, gboolean includecode, GError **error);
+
+/*
+ * Invalidate all classes created by the parser and recycle their memory
+ */
+void javaclass_parser_reset(JavaClassParser *parser);
+
+/*
+ * Free a parser and all the classes created by it
+ */
+void javaclass_parser_free(JavaClassParser *parser);
+
+#endif /* __JAVACLASSPARSER_H__ */
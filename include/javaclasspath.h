@@ -0,0 +1,108 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Resolution of classes against a classpath of JAR files and directories
+ *
+ * Adding an element indexes all the classes it contains once (for JARs only
+ * the central directory is read), so finding a class is a single hash lookup
+ * no matter how many elements the classpath has. Parsed classes are kept in
+ * an LRU cache of bounded size.
+ *
+ * Once all elements are added a classpath can be shared by many threads.
+ */
+
+#ifndef __JAVACLASSPATH_H__
+#define __JAVACLASSPATH_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+#include "javapackages.h"
+
+typedef struct _JavaClassPath JavaClassPath;
+
+/*
+ * Create a new empty classpath
+ *
+ * cache_size is the maximum number of parsed classes kept in memory and flags
+ * are the JavaClassParseFlags the classes are parsed with.
+ */
+JavaClassPath* javaclasspath_new(guint cache_size, guint flags);
+
+/*
+ * Append a JAR file or a directory to the classpath
+ *
+ * If a class is contained in several elements the first one wins like it
+ * does for the JVM.
+ */
+gboolean javaclasspath_add(JavaClassPath *cp, const gchar *path,
+        GError **error);
+
+/*
+ * Append all elements of a classpath string like "a.jar:b.jar:classes"
+ */
+gboolean javaclasspath_add_path_list(JavaClassPath *cp, const gchar *paths,
+        GError **error);
+
+/*
+ * Get the number of classes found on the classpath
+ */
+guint javaclasspath_get_class_number(JavaClassPath *cp);
+
+/*
+ * Get the packages of all classes found on the classpath
+ *
+ * The tree belongs to the classpath, the data of its classes is opaque.
+ */
+JavaPackageTree* javaclasspath_get_packages(JavaClassPath *cp);
+
+/*
+ * Is there a class with this fully qualified name (like java.lang.Object)?
+ */
+gboolean javaclasspath_contains(JavaClassPath *cp, const gchar *fqn);
+
+/*
+ * Get a class by its fully qualified name
+ *
+ * Returns a new reference, release it with javaclass_unref(). The class stays
+ * valid even if the cache evicts it in the meantime.
+ */
+JavaClass* javaclasspath_get_class(JavaClassPath *cp, const gchar *fqn,
+        GError **error);
+
+/*
+ * Get the fully qualified names of all superclasses of a class starting with
+ * its direct parent (free the result with g_strfreev())
+ */
+gchar** javaclasspath_get_superclasses(JavaClassPath *cp, const gchar *fqn,
+        GError **error);
+
+/*
+ * Get the fully qualified names of all interfaces a class implements, either
+ * directly or through its superclasses and superinterfaces (free the result
+ * with g_strfreev())
+ */
+gchar** javaclasspath_get_all_interfaces(JavaClassPath *cp, const gchar *fqn,
+        GError **error);
+
+/*
+ * Free a classpath and all the classes in its cache
+ */
+void javaclasspath_free(JavaClassPath *cp);
+
+#endif /* __JAVACLASSPATH_H__ */
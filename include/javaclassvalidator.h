@@ -0,0 +1,73 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Structural validation of class files
+ *
+ * javaclass_validate() checks the layout of a class file against the class
+ * file format without building a JavaClass: the magic number and version,
+ * the tags and references of the constant pool, the lengths of all members
+ * and attributes (including the tables inside "Code" attributes) and that
+ * the file ends right after the last attribute. It allocates no memory and
+ * reads every byte only once or twice, so it can run on every class before
+ * the class is given to anything else.
+ *
+ * Validation accepts the class file versions javaclass_new() supports.
+ */
+
+#ifndef __JAVACLASSVALIDATOR_H__
+#define __JAVACLASSVALIDATOR_H__
+
+#include <glib.h>
+
+typedef enum
+{
+    JAVACLASS_VALID,
+    JAVACLASS_INVALID_MAGIC,
+    JAVACLASS_INVALID_VERSION,
+    JAVACLASS_INVALID_TRUNCATED,      // a structure ends beyond the file
+    JAVACLASS_INVALID_CONSTANT,       // unknown tag or malformed constant
+    JAVACLASS_INVALID_REFERENCE,      // index to a missing or wrong constant
+    JAVACLASS_INVALID_ATTRIBUTE,      // contents that don't fit the length
+    JAVACLASS_INVALID_TRAILING_BYTES  // bytes after the last attribute
+} JavaClassValidity;
+
+/*
+ * The outcome of a validation, the counts are set as far as the class was
+ * read
+ */
+typedef struct _JavaClassValidation
+{
+    JavaClassValidity result;
+    const gchar *message;   // static description of the problem (or NULL)
+    guint32 offset;         // of the structure that is invalid
+    guint16 major_version;
+    guint16 minor_version;
+    guint16 constant_pool_count;
+    guint16 fields_count;
+    guint16 methods_count;
+} JavaClassValidation;
+
+/*
+ * Check whether classbytes hold a well-formed class file
+ *
+ * report may be NULL. Returns TRUE if the class is valid.
+ */
+gboolean javaclass_validate(const guchar *classbytes, gsize length,
+        JavaClassValidation *report);
+
+#endif /* __JAVACLASSVALIDATOR_H__ */
@@ -0,0 +1,68 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Writing classes back to the class file format
+ *
+ * A class is written with its constant pool, its members and all their
+ * attributes, unchanged. That needs a class parsed with its bytecode, as
+ * only then the parser keeps the attributes it doesn't know.
+ *
+ * A stripped class keeps the attributes that matter to the compiler, with
+ * their constants renumbered: Exceptions, Signature, ConstantValue,
+ * Deprecated, Synthetic, InnerClasses, EnclosingMethod, AnnotationDefault,
+ * NestHost, NestMembers, PermittedSubclasses, Record, Module,
+ * ModulePackages, ModuleMainClass, MethodParameters and the runtime visible
+ * and invisible annotations, parameter annotations and type annotations.
+ * Code, SourceFile, BootstrapMethods and unknown attributes are left out.
+ */
+
+#ifndef __JAVACLASSWRITER_H__
+#define __JAVACLASSWRITER_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+/*
+ * Options for writing a class
+ */
+typedef enum
+{
+    // only keep what is needed to compile against the class: drop the
+    // bytecode, the debug attributes, the private members and the static
+    // initializer and remove the constants nothing refers to anymore. The
+    // result can't be run but javac treats it like the original class.
+    JAVACLASS_WRITE_STRIP = 1 << 0
+} JavaClassWriteFlags;
+
+/*
+ * Write a class to a new buffer
+ *
+ * flags is a combination of JavaClassWriteFlags. Returns NULL and sets error
+ * if an attribute that has to be rewritten is malformed, or if the class is
+ * written without JAVACLASS_WRITE_STRIP but wasn't parsed with its bytecode.
+ */
+GBytes* javaclass_write(JavaClass *c, guint flags, GError **error);
+
+/*
+ * Write a class to a file
+ */
+gboolean javaclass_write_file(JavaClass *c, guint flags,
+        const gchar *filename, GError **error);
+
+#endif /* __JAVACLASSWRITER_H__ */
@@ -0,0 +1,134 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Detection of cloned methods
+ *
+ * The fingerprint of a method is computed from its bytecode with every
+ * constant pool operand replaced by a hash of the constant it refers to and
+ * branch offsets and switch tables left out, so the same code compiled into
+ * different classes gets the same fingerprint. It has a hash of the whole
+ * instruction stream, which is equal for exact clones, and a MinHash
+ * signature of the sequences of JAVACLONES_SHINGLE_SIZE instructions taken
+ * with a rolling hash, which estimates how similar two methods are.
+ *
+ * A JavaCloneIndex finds similar methods by locality sensitive hashing:
+ * the signature is cut into bands and two methods are candidates if any of
+ * their bands is equal. Methods that share 60% of their instruction
+ * sequences are found with a probability of 97%, more similar ones with a
+ * higher probability.
+ */
+
+#ifndef __JAVACLONES_H__
+#define __JAVACLONES_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+#define JAVACLONES_SIGNATURE_SIZE 16
+#define JAVACLONES_SHINGLE_SIZE 4
+
+// shorter methods (getters, setters, ...) are clones of each other anyway
+#define JAVACLONES_MIN_INSTRUCTIONS 8
+
+typedef struct _JavaCloneIndex JavaCloneIndex;
+
+typedef struct _JavaMethodFingerprint
+{
+    guint64 hash;           // of the normalized instruction stream
+    guint32 instructions;
+    guint32 signature[JAVACLONES_SIGNATURE_SIZE];
+} JavaMethodFingerprint;
+
+/*
+ * A method similar to the one looked for
+ */
+typedef struct _JavaCloneMatch
+{
+    guint32 id;
+    gdouble similarity;     // estimated share of equal instruction sequences
+    gboolean exact;         // same normalized instruction stream
+} JavaCloneMatch;
+
+/*
+ * Compute the fingerprint of the i-th method of a class (in the order of
+ * javaclass_get_methods()), which has to be parsed with its bytecode
+ *
+ * Returns FALSE if the method has no bytecode.
+ */
+gboolean javaclones_fingerprint(JavaClass *c, guint16 i,
+        JavaMethodFingerprint *fingerprint);
+
+/*
+ * Estimate the similarity of two methods from their fingerprints (0 to 1)
+ */
+gdouble javaclones_similarity(const JavaMethodFingerprint *a,
+        const JavaMethodFingerprint *b);
+
+/*
+ * Create a new empty index
+ */
+JavaCloneIndex* javacloneindex_new(void);
+
+/*
+ * Add a fingerprint, returns the id of the method which counts from 0
+ */
+guint32 javacloneindex_add(JavaCloneIndex *index,
+        const JavaMethodFingerprint *fingerprint, const gchar *location);
+
+/*
+ * Add all methods of a class with at least JAVACLONES_MIN_INSTRUCTIONS
+ * instructions, located as "<class>.<name><descriptor>"
+ *
+ * Returns the number of methods added.
+ */
+guint javacloneindex_add_class(JavaCloneIndex *index, JavaClass *c);
+
+/*
+ * Get the number of methods in the index
+ */
+guint32 javacloneindex_get_method_number(JavaCloneIndex *index);
+
+/*
+ * Get the location of a method
+ */
+const gchar* javacloneindex_get_location(JavaCloneIndex *index, guint32 id);
+
+/*
+ * Get the fingerprint of a method
+ */
+const JavaMethodFingerprint* javacloneindex_get_fingerprint(
+        JavaCloneIndex *index, guint32 id);
+
+/*
+ * Find the methods whose estimated similarity to a fingerprint is at least
+ * min_similarity, most similar first
+ *
+ * Free the array with g_free(). Returns NULL and sets n_matches to 0 if
+ * nothing was found.
+ */
+JavaCloneMatch* javacloneindex_query(JavaCloneIndex *index,
+        const JavaMethodFingerprint *fingerprint, gdouble min_similarity,
+        guint *n_matches);
+
+/*
+ * Free an index
+ */
+void javacloneindex_free(JavaCloneIndex *index);
+
+#endif /* __JAVACLONES_H__ */
@@ -0,0 +1,98 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Statistics over the bytecode of many classes
+ *
+ * A JavaCodeStats holds counters and histograms of the "Code" attributes of
+ * the methods added to it: how often every opcode occurs and how many
+ * methods use it, and the distributions of the code size, max_stack and
+ * max_locals. Statistics of parts of a corpus can be merged, so
+ * javacodestats_collect() lets every parser thread of a JavaPipeline fill
+ * its own statistics and adds them up at the end. Classes are dropped as
+ * soon as they were counted, the memory used doesn't grow with the corpus.
+ *
+ * Histograms have JAVACODESTATS_BUCKET_COUNT buckets: bucket 0 counts the
+ * value 0 and bucket k > 0 the values from 2^(k-1) to 2^k - 1, which covers
+ * every value the class file format allows.
+ */
+
+#ifndef __JAVACODESTATS_H__
+#define __JAVACODESTATS_H__
+
+#include <glib.h>
+
+#include "javabytecode.h"
+#include "javaclass.h"
+#include "javapipeline.h"
+
+#define JAVACODESTATS_BUCKET_COUNT 17
+
+typedef struct _JavaCodeStats
+{
+    guint64 classes;
+    guint64 methods;            // methods with bytecode
+    guint64 invalid_methods;    // methods with bytecode that can't be decoded
+    guint64 instructions;
+    guint64 code_bytes;
+    guint64 exception_handlers;
+
+    // instructions by opcode, a wide instruction counts for its widened
+    // opcode and for JAVABYTECODE_WIDE
+    guint64 opcodes[JAVABYTECODE_OPCODE_COUNT];
+
+    // methods that contain the opcode at least once, e.g. the synchronized
+    // blocks are methods_using[JAVABYTECODE_MONITORENTER]
+    guint64 methods_using[JAVABYTECODE_OPCODE_COUNT];
+
+    guint64 code_sizes[JAVACODESTATS_BUCKET_COUNT];
+    guint64 max_stack[JAVACODESTATS_BUCKET_COUNT];
+    guint64 max_locals[JAVACODESTATS_BUCKET_COUNT];
+} JavaCodeStats;
+
+/*
+ * Set all counters to 0
+ */
+void javacodestats_init(JavaCodeStats *stats);
+
+/*
+ * Count the methods of a class, which has to be parsed with its bytecode
+ */
+void javacodestats_add_class(JavaCodeStats *stats, JavaClass *c);
+
+/*
+ * Add the counters of other to stats
+ */
+void javacodestats_merge(JavaCodeStats *stats, const JavaCodeStats *other);
+
+/*
+ * Get the histogram bucket of a value
+ */
+guint javacodestats_get_bucket(guint32 value);
+
+/*
+ * Run a pipeline and add the statistics of all classes it parses to stats
+ *
+ * The pipeline is switched to include the bytecode and gets a worker
+ * callback for the run. func may be NULL, otherwise it gets every class
+ * (or error) like with javapipeline_run(). pipelinestats may be NULL.
+ */
+void javacodestats_collect(JavaCodeStats *stats, JavaPipeline *pipeline,
+        JavaPipelineFunc func, gpointer user_data,
+        JavaPipelineStats *pipelinestats);
+
+#endif /* __JAVACODESTATS_H__ */
@@ -0,0 +1,171 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Columnar export of class, field and method metadata
+ *
+ * A column file holds the tables listed below. Every column has a fixed
+ * width and all strings are stored once in the strings table and referenced
+ * by their id. Rows are written in groups of JAVACOLUMNS_ROW_GROUP_SIZE, so
+ * the writer only keeps the current row group and the string dictionary in
+ * memory and classes can be added right after they were parsed, e.g. with a
+ * JavaClassParser that is reset after every class.
+ *
+ * File layout (all numbers little-endian):
+ *
+ *   "JCOL" u32 version
+ *   column chunks, each starting at a multiple of 8
+ *   footer: one 32 byte entry per chunk
+ *       u8 table, u8 column, u8 codec, u8 width, u32 rows,
+ *       u64 offset, u64 stored size, u64 size
+ *   u64 footer offset, u32 chunk count, "JCOL"
+ *
+ * A chunk is a column of one row group, compressed with zlib (codec 1) or
+ * stored as it is (codec 0) if compression doesn't make it smaller. Stored
+ * chunks can be used directly from a memory mapping of the file.
+ */
+
+#ifndef __JAVACOLUMNS_H__
+#define __JAVACOLUMNS_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+#define JAVACOLUMNS_VERSION 1
+#define JAVACOLUMNS_ROW_GROUP_SIZE 65536
+
+typedef enum
+{
+    JAVACOLUMNS_TABLE_CLASSES,
+    JAVACOLUMNS_TABLE_FIELDS,
+    JAVACOLUMNS_TABLE_METHODS,
+    JAVACOLUMNS_TABLE_STRINGS,
+    JAVACOLUMNS_TABLE_COUNT
+} JavaColumnsTable;
+
+/*
+ * Columns of the classes table, the id of a class is its row number
+ */
+typedef enum
+{
+    JAVACOLUMNS_CLASS_ACCESS_FLAGS,  // u16
+    JAVACOLUMNS_CLASS_NAME,          // u32 string id of the fq name
+    JAVACOLUMNS_CLASS_PARENT,        // u32 string id of the fq parent name
+    JAVACOLUMNS_CLASS_MAJOR_VERSION, // u16
+    JAVACOLUMNS_CLASS_MINOR_VERSION, // u16
+    JAVACOLUMNS_CLASS_INTERFACES,    // u16 number of interfaces
+    JAVACOLUMNS_CLASS_FIELDS,        // u16 number of fields
+    JAVACOLUMNS_CLASS_METHODS,       // u16 number of methods
+    JAVACOLUMNS_CLASS_CODE_SIZE,     // u32 bytecode size of all methods
+    JAVACOLUMNS_CLASS_COLUMN_COUNT
+} JavaColumnsClassColumn;
+
+/*
+ * Columns of the fields table
+ */
+typedef enum
+{
+    JAVACOLUMNS_FIELD_CLASS,         // u32 class id
+    JAVACOLUMNS_FIELD_ACCESS_FLAGS,  // u16
+    JAVACOLUMNS_FIELD_NAME,          // u32 string id
+    JAVACOLUMNS_FIELD_DESCRIPTOR,    // u32 string id
+    JAVACOLUMNS_FIELD_COLUMN_COUNT
+} JavaColumnsFieldColumn;
+
+/*
+ * Columns of the methods table
+ */
+typedef enum
+{
+    JAVACOLUMNS_METHOD_CLASS,        // u32 class id
+    JAVACOLUMNS_METHOD_ACCESS_FLAGS, // u16
+    JAVACOLUMNS_METHOD_NAME,         // u32 string id
+    JAVACOLUMNS_METHOD_DESCRIPTOR,   // u32 string id
+    JAVACOLUMNS_METHOD_CODE_SIZE,    // u32 bytecode size
+    JAVACOLUMNS_METHOD_EXCEPTIONS,   // u16 number of declared exceptions
+    JAVACOLUMNS_METHOD_COLUMN_COUNT
+} JavaColumnsMethodColumn;
+
+/*
+ * Columns of the strings table, string 0 is the empty string
+ */
+typedef enum
+{
+    JAVACOLUMNS_STRING_OFFSET,       // u32 offset of the string in the data
+    JAVACOLUMNS_STRING_DATA,         // u8 NUL terminated UTF-8 strings
+    JAVACOLUMNS_STRING_COLUMN_COUNT
+} JavaColumnsStringColumn;
+
+typedef struct _JavaColumnWriter JavaColumnWriter;
+typedef struct _JavaColumnReader JavaColumnReader;
+
+/*
+ * Create a column file
+ */
+JavaColumnWriter* javacolumnwriter_new(const gchar *filename, GError **error);
+
+/*
+ * Add a class with its fields and methods
+ *
+ * All the data is copied, so the class may be freed or its parser reset
+ * right away. The code sizes are 0 unless the class was parsed with its
+ * bytecode. Returns the id of the class or -1 on a write error.
+ */
+gint64 javacolumnwriter_add_class(JavaColumnWriter *writer, JavaClass *c,
+        GError **error);
+
+/*
+ * Write the last row groups, the strings and the footer and free the writer
+ *
+ * Returns FALSE if writing failed, the file is incomplete then.
+ */
+gboolean javacolumnwriter_close(JavaColumnWriter *writer, GError **error);
+
+/*
+ * Open a column file (the file is memory mapped)
+ */
+JavaColumnReader* javacolumnreader_open(const gchar *filename,
+        GError **error);
+
+/*
+ * Get the number of rows of a table
+ */
+guint32 javacolumnreader_get_row_number(JavaColumnReader *reader,
+        JavaColumnsTable table);
+
+/*
+ * Read all values of a column as an array of little-endian numbers
+ *
+ * Columns that consist of a single stored chunk are returned as a view into
+ * the mapping without copying.
+ */
+GBytes* javacolumnreader_read_column(JavaColumnReader *reader,
+        JavaColumnsTable table, guint column, GError **error);
+
+/*
+ * Get a string by its id (NULL if there is no such string)
+ */
+const gchar* javacolumnreader_get_string(JavaColumnReader *reader,
+        guint32 id);
+
+/*
+ * Close a column file
+ */
+void javacolumnreader_free(JavaColumnReader *reader);
+
+#endif /* __JAVACOLUMNS_H__ */
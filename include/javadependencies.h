@@ -0,0 +1,76 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Extraction of the classes a class depends on
+ *
+ * The dependencies of a class are all classes named by its constant pool:
+ * class references, the descriptors of referenced and declared members and
+ * the generic signatures of the class and its members. They are collected
+ * from the constant pool and the member tables of the class without looking
+ * at its JavaField and JavaMethod objects. Array types count as their element
+ * type and primitive types and the class itself are left out.
+ */
+
+#ifndef __JAVADEPENDENCIES_H__
+#define __JAVADEPENDENCIES_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+/*
+ * Get the sorted fully qualified names of all classes a class depends on
+ * (free the result with g_strfreev())
+ */
+gchar** javaclass_get_dependencies(JavaClass *c);
+
+/*
+ * A set of dependency names shared by many classes
+ *
+ * Every name is stored only once no matter how many classes reference it and
+ * the results for a class are pointers to these shared strings, which makes
+ * it cheap to collect the dependencies of a whole code base. A set must only
+ * be used by one thread at a time.
+ */
+typedef struct _JavaDependencySet JavaDependencySet;
+
+/*
+ * Create a new empty dependency set
+ */
+JavaDependencySet* javadependencyset_new(void);
+
+/*
+ * Collect the dependencies of a class
+ *
+ * Returns a NULL terminated array of names that belong to the set, free
+ * only the array with g_free(). n_dependencies may be NULL.
+ */
+const gchar** javadependencyset_collect(JavaDependencySet *set, JavaClass *c,
+        guint *n_dependencies);
+
+/*
+ * Get the number of distinct names collected so far
+ */
+guint javadependencyset_get_name_number(JavaDependencySet *set);
+
+/*
+ * Free a dependency set and all its names
+ */
+void javadependencyset_free(JavaDependencySet *set);
+
+#endif /* __JAVADEPENDENCIES_H__ */
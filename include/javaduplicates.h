@@ -0,0 +1,119 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Detection of duplicate classes
+ *
+ * Classes are grouped by a hash of their bytes and optionally by a hash of a
+ * normalized form that doesn't depend on the order of the constant pool or
+ * on debug information: the names, descriptors and flags of the class and
+ * its members and the bytecode of the methods with every constant pool
+ * operand replaced by a hash of the constant it refers to. Exact duplicates
+ * are found before a class is parsed, so a scan can skip them.
+ */
+
+#ifndef __JAVADUPLICATES_H__
+#define __JAVADUPLICATES_H__
+
+#include <glib.h>
+
+#include "javaarchive.h"
+#include "javaclass.h"
+#include "javaclassparser.h"
+
+typedef struct _JavaDuplicateIndex JavaDuplicateIndex;
+
+/*
+ * Classes with the same hash
+ *
+ * size is the length of the class file for exact duplicates and the length
+ * of the normalized form otherwise.
+ */
+typedef struct _JavaDuplicateGroup
+{
+    guint64 hash;
+    guint32 size;
+    guint n_locations;
+    const gchar **locations;
+} JavaDuplicateGroup;
+
+/*
+ * Called by javaduplicates_scan_archive() for every class that is not an
+ * exact duplicate of a class seen before
+ */
+typedef void (*JavaDuplicateFunc)(const gchar *location, JavaClass *c,
+        gpointer user_data);
+
+/*
+ * Get the hash of the normalized form of a class, which needs the class to
+ * be parsed with its bytecode
+ */
+guint64 javaclass_get_normalized_hash(JavaClass *c);
+
+/*
+ * Create a new empty index, if normalize is TRUE
+ * javaduplicates_scan_archive() also groups the classes by their normalized
+ * hash
+ */
+JavaDuplicateIndex* javaduplicates_new(gboolean normalize);
+
+/*
+ * Add the bytes of a class found at location
+ *
+ * Returns TRUE if the same bytes were added before.
+ */
+gboolean javaduplicates_add_bytes(JavaDuplicateIndex *index,
+        const guchar *classbytes, guint32 length, const gchar *location);
+
+/*
+ * Add the normalized form of a class found at location
+ *
+ * Returns TRUE if a class with the same normalized form was added before.
+ */
+gboolean javaduplicates_add_class(JavaDuplicateIndex *index, JavaClass *c,
+        const gchar *location);
+
+/*
+ * Add all classes of an archive, parsing only those that are not exact
+ * duplicates
+ *
+ * Every parsed class is passed to func (which may be NULL) and the parser is
+ * reset afterwards. Exact duplicates are only added to the exact groups.
+ * Entries that fail javaclass_validate() are skipped.
+ * The location of a class is "<archive>!<entry>". Returns the number of
+ * classes that were parsed.
+ */
+guint javaduplicates_scan_archive(JavaDuplicateIndex *index,
+        JavaArchive *archive, JavaClassParser *parser, gboolean includecode,
+        JavaDuplicateFunc func, gpointer user_data);
+
+/*
+ * Get the groups of classes that were added more than once, largest group
+ * first
+ *
+ * Free only the array with g_free(), the groups belong to the index and are
+ * valid until the next class is added. n_groups may be NULL.
+ */
+const JavaDuplicateGroup** javaduplicates_get_groups(
+        JavaDuplicateIndex *index, gboolean normalized, guint *n_groups);
+
+/*
+ * Free an index
+ */
+void javaduplicates_free(JavaDuplicateIndex *index);
+
+#endif /* __JAVADUPLICATES_H__ */
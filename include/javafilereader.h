@@ -0,0 +1,70 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Batched reading of many small files
+ *
+ * On Linux the reader uses io_uring to keep up to queue_depth files in
+ * flight at once: the opens, statx calls, reads and closes of all of them
+ * are submitted together, so reading a directory of classes doesn't cost
+ * four blocking system calls per file. Where io_uring is not available (old
+ * kernels, seccomp filters or other systems) the files are read one after
+ * the other with blocking calls. If submitting to io_uring fails, the files it
+ * hasn't delivered are read with blocking calls and the reader stays
+ * blocking from then on. A reader must only be used by one thread at a time.
+ */
+
+#ifndef __JAVAFILEREADER_H__
+#define __JAVAFILEREADER_H__
+
+#include <glib.h>
+
+typedef struct _JavaFileReader JavaFileReader;
+
+/*
+ * Called for every file in the order the reads complete
+ *
+ * bytes holds the contents of the file (take a reference to keep it) or is
+ * NULL if the file couldn't be read, then error tells why.
+ */
+typedef void (*JavaFileFunc)(const gchar *filename, GBytes *bytes,
+        const GError *error, gpointer user_data);
+
+/*
+ * Create a reader that keeps up to queue_depth files in flight
+ */
+JavaFileReader* javafilereader_new(guint queue_depth);
+
+/*
+ * Does the reader use io_uring?
+ */
+gboolean javafilereader_is_async(JavaFileReader *reader);
+
+/*
+ * Read n_files files and pass each of them to func
+ *
+ * Returns the number of files that were read successfully.
+ */
+guint javafilereader_read(JavaFileReader *reader, const gchar **filenames,
+        guint n_files, JavaFileFunc func, gpointer user_data);
+
+/*
+ * Free a reader
+ */
+void javafilereader_free(JavaFileReader *reader);
+
+#endif /* __JAVAFILEREADER_H__ */
@@ -33,6 +33,7 @@ typedef struct _JavaMethod
     gchar **exceptions;
     guchar *code;
     guint32 codelen;
+    GBytes *_codebuf; // buffer code points into (NULL if code is a copy)
 } JavaMethod;
 
 /*
@@ -142,6 +143,14 @@ void javamethod_set_is_final(JavaMethod *method, gboolean value);
  */
 void javamethod_set_code(JavaMethod *method, guchar *code, guint32 codelen);
 
+/*
+ * Let the bytecode of the method point into a buffer instead of copying it
+ *
+ * The method keeps a reference on buffer until it is freed.
+ */
+void javamethod_set_code_view(JavaMethod *method, GBytes *buffer,
+        gsize offset, guint32 codelen);
+
 /*
  * Set the synchronized flag of the method
  */
@@ -0,0 +1,123 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * An index of classes by package
+ *
+ * Packages are kept in a tree that follows their dotted names, so every
+ * package name is stored once and the classes only keep their unqualified
+ * name and a reference to their package. Questions like "which classes are
+ * in com.acme or below" are answered by walking the subtree of a package
+ * instead of comparing the names of all classes.
+ *
+ * A tree can be read by many threads once all classes are added.
+ */
+
+#ifndef __JAVAPACKAGES_H__
+#define __JAVAPACKAGES_H__
+
+#include <glib.h>
+
+typedef struct _JavaPackageTree JavaPackageTree;
+typedef struct _JavaPackage JavaPackage;
+
+/*
+ * Called for each class of a package (or of a subtree of packages), data is
+ * what was passed to javapackagetree_add_class()
+ */
+typedef void (*JavaPackageClassFunc)(const JavaPackage *package,
+        const gchar *name, gpointer data, gpointer user_data);
+
+/*
+ * Called for each subpackage of a package
+ */
+typedef void (*JavaPackageFunc)(const JavaPackage *package,
+        gpointer user_data);
+
+/*
+ * Create a new empty tree
+ */
+JavaPackageTree* javapackagetree_new(void);
+
+/*
+ * Add a class by its fully qualified name (like java.lang.Object) and
+ * return the package it was added to
+ *
+ * The tree doesn't look for classes that were already added, adding a class
+ * twice lists it twice.
+ */
+const JavaPackage* javapackagetree_add_class(JavaPackageTree *tree,
+        const gchar *fqn, gpointer data);
+
+/*
+ * Find a package by its name, "" is the default package which is the root
+ * of the tree (returns NULL if no class was added to the package or below)
+ */
+const JavaPackage* javapackagetree_lookup(JavaPackageTree *tree,
+        const gchar *name);
+
+/*
+ * Get the number of packages in the tree (not counting the default package)
+ */
+guint javapackagetree_get_package_number(JavaPackageTree *tree);
+
+/*
+ * Get the fully qualified names of the classes of a package, with recursive
+ * set those of all its subpackages too (free the result with g_strfreev())
+ */
+gchar** javapackagetree_get_classes(JavaPackageTree *tree, const gchar *name,
+        gboolean recursive);
+
+/*
+ * Free a tree with all its packages
+ */
+void javapackagetree_free(JavaPackageTree *tree);
+
+/*
+ * Get the dotted name of a package ("" for the default package)
+ */
+const gchar* javapackage_get_name(const JavaPackage *package);
+
+/*
+ * Get the package a package is part of (NULL for the default package)
+ */
+const JavaPackage* javapackage_get_parent(const JavaPackage *package);
+
+/*
+ * Get the number of classes in a package, with recursive set including those
+ * of all its subpackages
+ */
+guint javapackage_get_class_number(const JavaPackage *package,
+        gboolean recursive);
+
+/*
+ * Call func for every class of a package, with recursive set for those of
+ * all its subpackages too
+ *
+ * The classes of a package are visited in the order they were added, the
+ * order of the subpackages is unspecified.
+ */
+void javapackage_foreach_class(const JavaPackage *package, gboolean recursive,
+        JavaPackageClassFunc func, gpointer user_data);
+
+/*
+ * Call func for every direct subpackage of a package
+ */
+void javapackage_foreach_subpackage(const JavaPackage *package,
+        JavaPackageFunc func, gpointer user_data);
+
+#endif /* __JAVAPACKAGES_H__ */
@@ -0,0 +1,112 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * A pipeline that reads, parses and consumes classes in parallel
+ *
+ * Reader threads read class files from directories and archives, parser
+ * workers turn them into JavaClass objects and the thread that runs the
+ * pipeline passes the classes to a consumer callback. The stages are
+ * connected by bounded lock-free queues and every worker parses with
+ * JavaClassParser contexts taken from a fixed pool, so the memory used
+ * stays the same no matter how many classes are read or how slow the
+ * consumer is: when a queue is full the stage before it waits.
+ *
+ * Every class is checked with javaclass_validate() before it is parsed, a
+ * corrupt class reaches the consumer as an error.
+ */
+
+#ifndef __JAVAPIPELINE_H__
+#define __JAVAPIPELINE_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+typedef struct _JavaPipeline JavaPipeline;
+
+/*
+ * Called in the thread that runs the pipeline for every class
+ *
+ * c is NULL if the class couldn't be read or parsed, then error tells why.
+ * The class belongs to the pipeline and is only valid during the call.
+ */
+typedef void (*JavaPipelineFunc)(const gchar *location, JavaClass *c,
+        const GError *error, gpointer user_data);
+
+/*
+ * Called in a parser thread for every class right after it was parsed
+ *
+ * worker is the number of the thread, from 0 to the number of parser
+ * threads - 1, so the callback can keep partial results per thread without
+ * locking. The class is only valid during the call.
+ */
+typedef void (*JavaPipelineWorkerFunc)(guint worker, const gchar *location,
+        JavaClass *c, gpointer user_data);
+
+typedef struct _JavaPipelineStats
+{
+    guint classes;   // classes parsed
+    guint errors;    // classes that couldn't be read or parsed
+    guint64 bytes;   // size of the parsed class files
+} JavaPipelineStats;
+
+/*
+ * Create a pipeline with n_readers reader threads, n_workers parser
+ * threads and queues that hold queue_size classes
+ */
+JavaPipeline* javapipeline_new(guint n_readers, guint n_workers,
+        guint queue_size);
+
+/*
+ * Keep the bytecode of the methods (off by default)
+ */
+void javapipeline_set_include_code(JavaPipeline *pipeline,
+        gboolean includecode);
+
+/*
+ * Let the parser threads pass every class they parsed to func before it
+ * goes to the consumer
+ */
+void javapipeline_set_worker_func(JavaPipeline *pipeline,
+        JavaPipelineWorkerFunc func, gpointer user_data);
+
+/*
+ * Get the number of parser threads
+ */
+guint javapipeline_get_worker_number(JavaPipeline *pipeline);
+
+/*
+ * Add a directory tree, an archive or a single class file
+ */
+void javapipeline_add_path(JavaPipeline *pipeline, const gchar *path);
+
+/*
+ * Run the pipeline over all the paths added and wait until every class was
+ * consumed
+ *
+ * Archives are located as "<archive>!<entry>". stats may be NULL.
+ */
+void javapipeline_run(JavaPipeline *pipeline, JavaPipelineFunc func,
+        gpointer user_data, JavaPipelineStats *stats);
+
+/*
+ * Free a pipeline
+ */
+void javapipeline_free(JavaPipeline *pipeline);
+
+#endif /* __JAVAPIPELINE_H__ */
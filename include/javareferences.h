@@ -0,0 +1,102 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Bloom filters of the symbols classes reference, for screening which
+ * classes of a large corpus may use a class, field or method
+ *
+ * Each class gets a blocked Bloom filter over the classes, fields and methods
+ * its constant pool refers to. A symbol sets 8 bits within a single 256 bit
+ * block of the filter, so checking a filter is one AND and compare of 32
+ * bytes. Filters are sized to the number of symbols of their class (256 to
+ * 8192 bits) and kept in one contiguous array per size, which a query scans
+ * with SIMD. Filters can have false positives but no false negatives: the
+ * candidates have to be checked with javareferences_contains() after parsing
+ * them again.
+ */
+
+#ifndef __JAVAREFERENCES_H__
+#define __JAVAREFERENCES_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+typedef struct _JavaReferenceIndex JavaReferenceIndex;
+
+/*
+ * Does a class reference a class or, if member isn't NULL, a field or method
+ * of it by that name?
+ *
+ * owner may be in the internal (java/lang/String) or the external
+ * (java.lang.String) form. This is the exact check for the candidates of a
+ * query.
+ */
+gboolean javareferences_contains(JavaClass *c, const gchar *owner,
+        const gchar *member);
+
+/*
+ * Create a new empty index
+ */
+JavaReferenceIndex* javareferenceindex_new(void);
+
+/*
+ * Load an index written by javareferenceindex_save()
+ */
+JavaReferenceIndex* javareferenceindex_load(const gchar *filename,
+        GError **error);
+
+/*
+ * Add the filter of a class found at location, returns the id of the class
+ * (ids count from 0 in the order the classes are added)
+ */
+guint32 javareferenceindex_add_class(JavaReferenceIndex *index,
+        JavaClass *c, const gchar *location);
+
+/*
+ * Get the number of classes in the index
+ */
+guint32 javareferenceindex_get_class_number(JavaReferenceIndex *index);
+
+/*
+ * Get the location a class was added with
+ */
+const gchar* javareferenceindex_get_location(JavaReferenceIndex *index,
+        guint32 id);
+
+/*
+ * Find the classes that may reference a class or, if member isn't NULL, a
+ * field or method of it by that name (in the same forms as for
+ * javareferences_contains())
+ *
+ * Returns the sorted ids of the candidates, free them with g_free().
+ */
+guint32* javareferenceindex_query(JavaReferenceIndex *index,
+        const gchar *owner, const gchar *member, guint *n_candidates);
+
+/*
+ * Write an index to a file
+ */
+gboolean javareferenceindex_save(JavaReferenceIndex *index,
+        const gchar *filename, GError **error);
+
+/*
+ * Free an index
+ */
+void javareferenceindex_free(JavaReferenceIndex *index);
+
+#endif /* __JAVAREFERENCES_H__ */
@@ -0,0 +1,77 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Search for substrings in the string literals of classes
+ *
+ * The search runs directly over the bytes of a class file: it walks the
+ * constant pool to find the CONSTANT_String entries and searches the UTF-8
+ * entries they point to without creating a JavaClass. All patterns are
+ * searched at once. Candidate positions are found with a vectorized scan for
+ * the first bytes of the patterns and a table of the first two bytes before
+ * the patterns are compared. A search can be used by many threads at once.
+ */
+
+#ifndef __JAVASTRINGSEARCH_H__
+#define __JAVASTRINGSEARCH_H__
+
+#include <glib.h>
+
+#include "javaarchive.h"
+
+typedef struct _JavaStringSearch JavaStringSearch;
+
+/*
+ * Called for every match
+ *
+ * location is the name of the class given to the scan function, cp_index
+ * the index of the CONSTANT_String entry (counting from 1 like the class file
+ * format and javap), offset the byte offset of the match in the string and
+ * pattern the index of the pattern that matched.
+ */
+typedef void (*JavaStringMatchFunc)(const gchar *location, guint16 cp_index,
+        guint32 offset, guint pattern, gpointer user_data);
+
+/*
+ * Create a search for a NULL terminated array of non-empty patterns
+ */
+JavaStringSearch* javastringsearch_new(const gchar **patterns);
+
+/*
+ * Search the string literals of a class
+ *
+ * Returns FALSE and sets error if the constant pool is malformed.
+ */
+gboolean javastringsearch_scan(JavaStringSearch *search,
+        const guchar *classbytes, guint32 length, const gchar *location,
+        JavaStringMatchFunc func, gpointer user_data, GError **error);
+
+/*
+ * Search the string literals of all classes in an archive
+ *
+ * The location passed to func is "<archive>!<entry>". Malformed classes are
+ * skipped, the number of classes scanned is returned.
+ */
+guint javastringsearch_scan_archive(JavaStringSearch *search,
+        JavaArchive *archive, JavaStringMatchFunc func, gpointer user_data);
+
+/*
+ * Free a search
+ */
+void javastringsearch_free(JavaStringSearch *search);
+
+#endif /* __JAVASTRINGSEARCH_H__ */
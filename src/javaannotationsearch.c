@@ -0,0 +1,311 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javaannotationsearch.h"
+#include "javaclassparser.h"
+#include "javaclassvalidator.h"
+#include "javaprivate.h"
+
+struct _JavaAnnotationSearch
+{
+    guint n_types;
+    gchar **types;
+    gsize *lengths;
+    GHashTable *index;            // type -> index of the type + 1
+    guint32 lengths_set[65536 / 32]; // bitset of the lengths of the types
+};
+
+/*
+ * Every thread parses the candidates with its own parser
+ */
+static void parser_free(gpointer data)
+{
+    javaclass_parser_free(data);
+}
+
+static GPrivate parser_key = G_PRIVATE_INIT(parser_free);
+
+static JavaClassParser* get_parser(void)
+{
+    JavaClassParser *parser = g_private_get(&parser_key);
+
+    if (parser == NULL) {
+        parser = javaclass_parser_new();
+        g_private_set(&parser_key, parser);
+    }
+
+    return parser;
+}
+
+JavaAnnotationSearch* javaannotationsearch_new(const gchar **types)
+{
+    JavaAnnotationSearch *search = NULL;
+    guint n = 0;
+
+    while (types[n] != NULL) {
+        g_return_val_if_fail(types[n][0] != '\0', NULL);
+        n++;
+    }
+
+    search = g_new0(JavaAnnotationSearch, 1);
+
+    search->n_types = n;
+    search->types = g_new(gchar*, n);
+    search->lengths = g_new(gsize, n);
+    search->index = g_hash_table_new(g_str_hash, g_str_equal);
+
+    for (guint i = 0; i < n; i++) {
+        search->types[i] = g_strdup(types[i]);
+        search->lengths[i] = MIN(strlen(types[i]), 65535);
+        search->lengths_set[search->lengths[i] / 32] |=
+            1U << (search->lengths[i] % 32);
+
+        if (!g_hash_table_contains(search->index, search->types[i])) {
+            g_hash_table_insert(search->index, search->types[i],
+                    GUINT_TO_POINTER(i + 1));
+        }
+    }
+
+    return search;
+}
+
+static guint16 read_u16(const guchar *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/*
+ * Is one of the types a UTF-8 entry of the constant pool?
+ */
+static gboolean prefilter(JavaAnnotationSearch *search,
+        const guchar *classbytes, guint32 length, GError **error)
+{
+    guint32 offset = 10;
+    guint16 count = 0;
+
+    if (length < 10 || read_u16(classbytes) != 0xCAFE ||
+            read_u16(classbytes + 2) != 0xBABE) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_TAG_UNKNOWN,
+                "Error parsing class file: File is not a valid CLASS file!\n");
+        return FALSE;
+    }
+
+    count = read_u16(classbytes + 8);
+
+    for (guint i = 1; i < count; i++) {
+        guint32 size = 0;
+        guint16 len = 0;
+
+        if (offset >= length) {
+            g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_TAG_UNKNOWN,
+                    "Error parsing class file: Truncated constant pool\n");
+            return FALSE;
+        }
+
+        switch (classbytes[offset]) {
+            case TAG_UTF8:
+                if (offset + 3 > length) break;
+                len = read_u16(classbytes + offset + 1);
+                size = 3 + len;
+                if (offset + size > length) break;
+
+                // most entries are ruled out by their length
+                if (!(search->lengths_set[len / 32] & (1U << (len % 32))))
+                    break;
+
+                for (guint j = 0; j < search->n_types; j++) {
+                    if (search->lengths[j] == len && memcmp(search->types[j],
+                                classbytes + offset + 3, len) == 0)
+                        return TRUE;
+                }
+                break;
+            case TAG_CLASS:
+            case TAG_STRING:
+            case TAG_METHODTYPE:
+            case TAG_MODULE:
+            case TAG_PACKAGE:
+                size = 3;
+                break;
+            case TAG_METHODHANDLE:
+                size = 4;
+                break;
+            case TAG_INTEGER:
+            case TAG_FLOAT:
+            case TAG_FIELDREF:
+            case TAG_METHODREF:
+            case TAG_INTERFACEMETHODREF:
+            case TAG_NAMEANDTYPE:
+            case TAG_DYNAMIC:
+            case TAG_INVOKEDYNAMIC:
+                size = 5;
+                break;
+            case TAG_LONG:
+            case TAG_DOUBLE:
+                // take two slots
+                size = 9;
+                i++;
+                break;
+            default:
+                g_set_error(error, JAVACLASS_GERROR,
+                        JAVACLASS_ERROR_TAG_UNKNOWN,
+                        "Error parsing class file: Unknown constant pool tag %d\n",
+                        classbytes[offset]);
+                return FALSE;
+        }
+
+        if (size == 0 || offset + size > length) {
+            g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_TAG_UNKNOWN,
+                    "Error parsing class file: Truncated constant pool\n");
+            return FALSE;
+        }
+
+        offset += size;
+    }
+
+    return FALSE;
+}
+
+/*
+ * Report the annotations out of a list of type descriptors that are searched
+ * for (the list is freed)
+ */
+static void report(JavaAnnotationSearch *search, const gchar **annotations,
+        const gchar *location, JavaClass *c, JavaField *field,
+        JavaMethod *method, JavaAnnotationMatchFunc func, gpointer user_data)
+{
+    if (annotations == NULL) return;
+
+    for (int i = 0; annotations[i]; i++) {
+        gpointer type = g_hash_table_lookup(search->index, annotations[i]);
+
+        if (type != NULL) {
+            func(location, c, field, method, GPOINTER_TO_UINT(type) - 1,
+                    user_data);
+        }
+    }
+
+    g_free(annotations);
+}
+
+gboolean javaannotationsearch_scan(JavaAnnotationSearch *search,
+        const guchar *classbytes, guint32 length, const gchar *location,
+        JavaAnnotationMatchFunc func, gpointer user_data, GError **error)
+{
+    GError *suberror = NULL;
+    JavaClassParser *parser = NULL;
+    JavaClass *c = NULL;
+    JavaField **fields = NULL;
+    JavaMethod **methods = NULL;
+    JavaClassValidation validation;
+
+    if (!prefilter(search, classbytes, length, &suberror)) {
+        if (suberror == NULL) return TRUE;
+
+        g_propagate_error(error, suberror);
+        return FALSE;
+    }
+
+    // the parser trusts its input, only the candidates need the full check
+    if (!javaclass_validate(classbytes, length, &validation)) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_CLASS,
+                "Error parsing class file: %s at offset %u\n",
+                validation.message, validation.offset);
+        return FALSE;
+    }
+
+    parser = get_parser();
+    c = javaclass_parser_parse(parser, (guchar*) classbytes, length, FALSE,
+            error);
+    if (c == NULL) {
+        javaclass_parser_reset(parser);
+        return FALSE;
+    }
+
+    report(search, javaclass_get_annotations(c), location, c, NULL, NULL,
+            func, user_data);
+
+    fields = javaclass_get_fields(c);
+    for (int i = 0; fields != NULL && fields[i]; i++) {
+        report(search, javaclass_get_field_annotations(c, fields[i]),
+                location, c, fields[i], NULL, func, user_data);
+    }
+
+    methods = javaclass_get_methods(c);
+    for (int i = 0; methods != NULL && methods[i]; i++) {
+        report(search, javaclass_get_method_annotations(c, methods[i]),
+                location, c, NULL, methods[i], func, user_data);
+    }
+
+    javaclass_parser_reset(parser);
+
+    return TRUE;
+}
+
+guint javaannotationsearch_scan_archive(JavaAnnotationSearch *search,
+        JavaArchive *archive, JavaAnnotationMatchFunc func,
+        gpointer user_data)
+{
+    GString *location = g_string_new(javaarchive_get_filename(archive));
+    gsize prefix = 0;
+    guint scanned = 0;
+
+    g_string_append_c(location, '!');
+    prefix = location->len;
+
+    for (guint i = 0; i < javaarchive_get_entry_count(archive); i++) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(archive, i);
+        GBytes *bytes = NULL;
+        gsize length = 0;
+        const guchar *data = NULL;
+
+        if (!javaarchive_entry_is_class(entry)) continue;
+
+        bytes = javaarchive_read_entry(archive, entry, NULL);
+        if (bytes == NULL) continue;
+
+        g_string_truncate(location, prefix);
+        g_string_append(location, entry->name);
+
+        data = g_bytes_get_data(bytes, &length);
+        if (javaannotationsearch_scan(search, data, length, location->str,
+                    func, user_data, NULL)) {
+            scanned++;
+        }
+
+        g_bytes_unref(bytes);
+    }
+
+    g_string_free(location, TRUE);
+
+    return scanned;
+}
+
+void javaannotationsearch_free(JavaAnnotationSearch *search)
+{
+    if (search != NULL) {
+        for (guint i = 0; i < search->n_types; i++) {
+            g_free(search->types[i]);
+        }
+
+        g_free(search->types);
+        g_free(search->lengths);
+        g_hash_table_destroy(search->index);
+        g_free(search);
+    }
+}
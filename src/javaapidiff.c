@@ -0,0 +1,432 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "javaapidiff.h"
+#include "javaclassparser.h"
+#include "javaclassvalidator.h"
+#include "javaprivate.h"
+
+#define HASH_SEED 0x41504944
+
+#define ACC_PUBLIC     0x0001
+#define ACC_PRIVATE    0x0002
+#define ACC_PROTECTED  0x0004
+#define ACC_STATIC     0x0008
+#define ACC_FINAL      0x0010
+#define ACC_INTERFACE  0x0200
+#define ACC_ABSTRACT   0x0400
+#define ACC_SYNTHETIC  0x1000
+#define ACC_ANNOTATION 0x2000
+#define ACC_ENUM       0x4000
+
+// access flags whose change can break the clients of a class or member
+#define CLASS_API_FLAGS (ACC_PUBLIC | ACC_FINAL | ACC_INTERFACE | \
+        ACC_ABSTRACT | ACC_ANNOTATION | ACC_ENUM)
+#define MEMBER_API_FLAGS (ACC_PUBLIC | ACC_PRIVATE | ACC_PROTECTED | \
+        ACC_STATIC | ACC_FINAL | ACC_ABSTRACT)
+
+/*
+ * A field, method or interface with the hash it is sorted by
+ */
+typedef struct _member_key
+{
+    guint64 hash;
+    const gchar *name;
+    const gchar *descriptor;
+    guint16 access_flags;
+    guint64 exceptions;     // order independent hash of the exceptions
+    gchar **exception_names;
+} member_key;
+
+typedef struct _diff_state
+{
+    JavaApiDiffFunc func;
+    gpointer user_data;
+    const gchar *class_name;
+    guint changes;
+} diff_state;
+
+static guint64 hash_string(const gchar *str, guint64 seed)
+{
+    return javahash_bytes(str, strlen(str), seed);
+}
+
+static gboolean is_api(guint16 access_flags)
+{
+    return (access_flags & (ACC_PUBLIC | ACC_PROTECTED)) &&
+        !(access_flags & ACC_SYNTHETIC);
+}
+
+static gint compare_keys(gconstpointer a, gconstpointer b)
+{
+    const member_key *ka = a;
+    const member_key *kb = b;
+    gint order = 0;
+
+    if (ka->hash != kb->hash) return ka->hash < kb->hash ? -1 : 1;
+
+    order = strcmp(ka->name, kb->name);
+    return order != 0 ? order : strcmp(ka->descriptor, kb->descriptor);
+}
+
+static void key_init(member_key *key, const gchar *name,
+        const gchar *descriptor, guint16 access_flags)
+{
+    key->name = name;
+    key->descriptor = descriptor;
+    key->hash = hash_string(descriptor, hash_string(name, HASH_SEED));
+    key->access_flags = access_flags;
+}
+
+static member_key* field_keys(JavaClass *c, guint *n)
+{
+    JavaField **fields = javaclass_get_fields(c);
+    member_key *keys = NULL;
+
+    *n = javaclass_get_field_number(c);
+    keys = g_new0(member_key, MAX(*n, 1));
+
+    for (guint i = 0; i < *n; i++) {
+        key_init(&keys[i], fields[i]->name, fields[i]->descriptor,
+                fields[i]->access_flags);
+    }
+
+    qsort(keys, *n, sizeof(member_key), compare_keys);
+
+    return keys;
+}
+
+static member_key* method_keys(JavaClass *c, guint *n)
+{
+    JavaMethod **methods = javaclass_get_methods(c);
+    member_key *keys = NULL;
+
+    *n = javaclass_get_method_number(c);
+    keys = g_new0(member_key, MAX(*n, 1));
+
+    for (guint i = 0; i < *n; i++) {
+        gchar **exceptions = methods[i]->exceptions;
+
+        key_init(&keys[i], methods[i]->name, methods[i]->descriptor,
+                methods[i]->access_flags);
+        keys[i].exception_names = exceptions;
+
+        // a sum doesn't depend on the order the exceptions are declared in
+        for (guint j = 0; exceptions != NULL && exceptions[j] != NULL; j++) {
+            keys[i].exceptions += hash_string(exceptions[j], HASH_SEED);
+        }
+    }
+
+    qsort(keys, *n, sizeof(member_key), compare_keys);
+
+    return keys;
+}
+
+static member_key* interface_keys(JavaClass *c, guint *n)
+{
+    gchar **interfaces = javaclass_get_interfaces(c);
+    member_key *keys = NULL;
+
+    *n = javaclass_get_interface_number(c);
+    keys = g_new0(member_key, MAX(*n, 1));
+
+    for (guint i = 0; i < *n; i++) {
+        key_init(&keys[i], interfaces[i], "", 0);
+    }
+
+    qsort(keys, *n, sizeof(member_key), compare_keys);
+
+    return keys;
+}
+
+static void report(diff_state *state, JavaApiChangeKind kind,
+        const member_key *key, guint16 old_access, guint16 new_access,
+        const gchar *old_value, const gchar *new_value)
+{
+    JavaApiChange change = {kind, state->class_name, NULL, NULL, old_value,
+        new_value, old_access, new_access};
+
+    if (key != NULL) {
+        change.name = key->name;
+        change.descriptor = key->descriptor[0] != '\0' ? key->descriptor :
+            NULL;
+    }
+
+    state->changes++;
+    if (state->func != NULL) state->func(&change, state->user_data);
+}
+
+static gchar* join_exceptions(gchar **exceptions)
+{
+    return exceptions != NULL ? g_strjoinv(",", exceptions) : g_strdup("");
+}
+
+/*
+ * Merge two sorted key arrays, the kinds are those of fields, methods or
+ * interfaces (which have no access flags, so access is ignored for them)
+ */
+static void compare_keys_sorted(diff_state *state, member_key *oldkeys,
+        guint n_old, member_key *newkeys, guint n_new,
+        JavaApiChangeKind added, JavaApiChangeKind removed,
+        JavaApiChangeKind access)
+{
+    gboolean members = added != JAVAAPIDIFF_INTERFACE_ADDED;
+
+    guint i = 0;
+    guint j = 0;
+
+    while (i < n_old || j < n_new) {
+        member_key *o = i < n_old ? &oldkeys[i] : NULL;
+        member_key *n = j < n_new ? &newkeys[j] : NULL;
+        gint order = o == NULL ? 1 : n == NULL ? -1 : compare_keys(o, n);
+
+        if (order < 0) {
+            if (!members || is_api(o->access_flags)) {
+                report(state, removed, o, o->access_flags, 0, NULL, NULL);
+            }
+            i++;
+            continue;
+        }
+
+        if (order > 0) {
+            if (!members || is_api(n->access_flags)) {
+                report(state, added, n, 0, n->access_flags, NULL, NULL);
+            }
+            j++;
+            continue;
+        }
+
+        if (members && (is_api(o->access_flags) ||
+                    is_api(n->access_flags))) {
+            if ((o->access_flags ^ n->access_flags) & MEMBER_API_FLAGS) {
+                report(state, access, o, o->access_flags, n->access_flags,
+                        NULL, NULL);
+            }
+
+            if (o->exceptions != n->exceptions) {
+                gchar *before = join_exceptions(o->exception_names);
+                gchar *after = join_exceptions(n->exception_names);
+
+                report(state, JAVAAPIDIFF_METHOD_EXCEPTIONS, o,
+                        o->access_flags, n->access_flags, before, after);
+                g_free(before);
+                g_free(after);
+            }
+        }
+
+        i++;
+        j++;
+    }
+}
+
+static void compare_classes(diff_state *state, JavaClass *oldc,
+        JavaClass *newc)
+{
+    const gchar *oldparent = javaclass_get_fq_parent(oldc);
+    const gchar *newparent = javaclass_get_fq_parent(newc);
+    member_key *oldkeys = NULL;
+    member_key *newkeys = NULL;
+    guint n_old = 0;
+    guint n_new = 0;
+
+    state->class_name = javaclass_get_fq_name(newc);
+
+    if ((oldc->access_flags ^ newc->access_flags) & CLASS_API_FLAGS) {
+        report(state, JAVAAPIDIFF_CLASS_ACCESS, NULL, oldc->access_flags,
+                newc->access_flags, NULL, NULL);
+    }
+
+    if (g_strcmp0(oldparent, newparent) != 0) {
+        report(state, JAVAAPIDIFF_SUPERCLASS, NULL, oldc->access_flags,
+                newc->access_flags, oldparent, newparent);
+    }
+
+    oldkeys = interface_keys(oldc, &n_old);
+    newkeys = interface_keys(newc, &n_new);
+    compare_keys_sorted(state, oldkeys, n_old, newkeys, n_new,
+            JAVAAPIDIFF_INTERFACE_ADDED, JAVAAPIDIFF_INTERFACE_REMOVED,
+            JAVAAPIDIFF_CLASS_ACCESS);
+    g_free(oldkeys);
+    g_free(newkeys);
+
+    oldkeys = field_keys(oldc, &n_old);
+    newkeys = field_keys(newc, &n_new);
+    compare_keys_sorted(state, oldkeys, n_old, newkeys, n_new,
+            JAVAAPIDIFF_FIELD_ADDED, JAVAAPIDIFF_FIELD_REMOVED,
+            JAVAAPIDIFF_FIELD_ACCESS);
+    g_free(oldkeys);
+    g_free(newkeys);
+
+    oldkeys = method_keys(oldc, &n_old);
+    newkeys = method_keys(newc, &n_new);
+    compare_keys_sorted(state, oldkeys, n_old, newkeys, n_new,
+            JAVAAPIDIFF_METHOD_ADDED, JAVAAPIDIFF_METHOD_REMOVED,
+            JAVAAPIDIFF_METHOD_ACCESS);
+    g_free(oldkeys);
+    g_free(newkeys);
+}
+
+guint javaapidiff_compare(JavaClass *oldc, JavaClass *newc,
+        JavaApiDiffFunc func, gpointer user_data)
+{
+    diff_state state = {func, user_data, NULL, 0};
+
+    compare_classes(&state, oldc, newc);
+
+    return state.changes;
+}
+
+/*
+ * Parse the class of an archive entry, the class needs bytes to stay alive
+ */
+static JavaClass* parse_entry(JavaClassParser *parser, JavaArchive *archive,
+        const JavaArchiveEntry *entry, GBytes **bytes, GError **error)
+{
+    JavaClass *c = NULL;
+    gsize length = 0;
+    guchar *data = NULL;
+    JavaClassValidation validation;
+
+    *bytes = javaarchive_read_entry(archive, entry, error);
+    if (*bytes == NULL) return NULL;
+
+    data = (guchar*) g_bytes_get_data(*bytes, &length);
+
+    // the parser trusts its input, a corrupt entry must not crash the diff
+    if (!javaclass_validate(data, length, &validation)) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_CLASS,
+                "Error parsing class file: %s at offset %u\n",
+                validation.message, validation.offset);
+    } else {
+        c = javaclass_parser_parse(parser, data, length, FALSE, error);
+    }
+
+    if (c == NULL) {
+        g_prefix_error(error, "%s!%s: ", javaarchive_get_filename(archive),
+                entry->name);
+    }
+
+    return c;
+}
+
+/*
+ * Report a class that is only in one of the archives if it is public
+ */
+static gboolean compare_single(diff_state *state, JavaClassParser *parser,
+        JavaArchive *archive, const JavaArchiveEntry *entry,
+        JavaApiChangeKind kind, GError **error)
+{
+    GBytes *bytes = NULL;
+    JavaClass *c = parse_entry(parser, archive, entry, &bytes, error);
+
+    if (c != NULL && c->access_flags & ACC_PUBLIC) {
+        state->class_name = javaclass_get_fq_name(c);
+        report(state, kind, NULL,
+                kind == JAVAAPIDIFF_CLASS_REMOVED ? c->access_flags : 0,
+                kind == JAVAAPIDIFF_CLASS_ADDED ? c->access_flags : 0,
+                NULL, NULL);
+    }
+
+    javaclass_parser_reset(parser);
+    if (bytes != NULL) g_bytes_unref(bytes);
+
+    return c != NULL;
+}
+
+static gboolean compare_pair(diff_state *state, JavaClassParser *parser,
+        JavaArchive *oldarchive, const JavaArchiveEntry *oldentry,
+        JavaArchive *newarchive, const JavaArchiveEntry *newentry,
+        GError **error)
+{
+    GBytes *oldbytes = NULL;
+    GBytes *newbytes = NULL;
+    JavaClass *oldc = NULL;
+    JavaClass *newc = NULL;
+
+    oldc = parse_entry(parser, oldarchive, oldentry, &oldbytes, error);
+    if (oldc != NULL) {
+        newc = parse_entry(parser, newarchive, newentry, &newbytes, error);
+    }
+
+    if (newc != NULL && ((oldc->access_flags | newc->access_flags) &
+                ACC_PUBLIC)) {
+        compare_classes(state, oldc, newc);
+    }
+
+    javaclass_parser_reset(parser);
+    if (oldbytes != NULL) g_bytes_unref(oldbytes);
+    if (newbytes != NULL) g_bytes_unref(newbytes);
+
+    return newc != NULL;
+}
+
+gint javaapidiff_compare_archives(JavaArchive *oldarchive,
+        JavaArchive *newarchive, JavaApiDiffFunc func, gpointer user_data,
+        GError **error)
+{
+    diff_state state = {func, user_data, NULL, 0};
+    JavaClassParser *parser = javaclass_parser_new();
+    GHashTable *oldentries = g_hash_table_new(g_str_hash, g_str_equal);
+    gboolean ok = TRUE;
+
+    for (guint i = 0; i < javaarchive_get_entry_count(oldarchive); i++) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(oldarchive, i);
+
+        if (javaarchive_entry_is_class(entry)) {
+            g_hash_table_insert(oldentries, (gpointer) entry->name,
+                    (gpointer) entry);
+        }
+    }
+
+    for (guint i = 0; ok && i < javaarchive_get_entry_count(newarchive);
+            i++) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(newarchive, i);
+        const JavaArchiveEntry *oldentry = NULL;
+
+        if (!javaarchive_entry_is_class(entry)) continue;
+
+        oldentry = g_hash_table_lookup(oldentries, entry->name);
+
+        if (oldentry == NULL) {
+            ok = compare_single(&state, parser, newarchive, entry,
+                    JAVAAPIDIFF_CLASS_ADDED, error);
+        } else {
+            g_hash_table_remove(oldentries, entry->name);
+            ok = compare_pair(&state, parser, oldarchive, oldentry,
+                    newarchive, entry, error);
+        }
+    }
+
+    // what is left was removed, reported in the order of the old archive
+    for (guint i = 0; ok && i < javaarchive_get_entry_count(oldarchive);
+            i++) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(oldarchive, i);
+
+        if (g_hash_table_lookup(oldentries, entry->name) == entry) {
+            ok = compare_single(&state, parser, oldarchive, entry,
+                    JAVAAPIDIFF_CLASS_REMOVED, error);
+        }
+    }
+
+    g_hash_table_destroy(oldentries);
+    javaclass_parser_free(parser);
+
+    return ok ? (gint) state.changes : -1;
+}
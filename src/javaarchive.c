@@ -0,0 +1,299 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include <zlib.h>
+
+#include "javaarchive.h"
+#include "javaclass.h"
+
+/*
+ * Signatures and sizes of the ZIP records we read
+ */
+#define ZIP_END_OF_CENTRAL_DIR_SIG  0x06054b50
+#define ZIP_CENTRAL_DIR_ENTRY_SIG   0x02014b50
+#define ZIP_LOCAL_HEADER_SIG        0x04034b50
+
+#define ZIP_END_OF_CENTRAL_DIR_SIZE 22
+#define ZIP_CENTRAL_DIR_ENTRY_SIZE  46
+#define ZIP_LOCAL_HEADER_SIZE       30
+#define ZIP_MAX_COMMENT_SIZE        65535
+
+#define ZIP_METHOD_STORED   0
+#define ZIP_METHOD_DEFLATED 8
+
+struct _JavaArchive
+{
+    gchar *filename;
+    GMappedFile *file;
+    GBytes *bytes;
+    const guchar *data;
+    gsize length;
+    guint entry_count;
+    JavaArchiveEntry *entries;
+    GStringChunk *names;
+};
+
+/*
+ * Read little endian integers (ZIP uses little endian unlike class files)
+ */
+static guint16 read_u16(const guchar *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static guint32 read_u32(const guchar *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+/*
+ * Find the end of central directory record by searching backwards over the
+ * optional archive comment
+ */
+static const guchar* find_end_of_central_dir(const guchar *data, gsize length)
+{
+    gsize min = 0;
+    gsize pos = 0;
+
+    if (length < ZIP_END_OF_CENTRAL_DIR_SIZE) return NULL;
+
+    pos = length - ZIP_END_OF_CENTRAL_DIR_SIZE;
+    if (pos > ZIP_MAX_COMMENT_SIZE) min = pos - ZIP_MAX_COMMENT_SIZE;
+
+    for (;;) {
+        if (read_u32(data + pos) == ZIP_END_OF_CENTRAL_DIR_SIG)
+            return data + pos;
+        if (pos == min) break;
+        pos--;
+    }
+
+    return NULL;
+}
+
+static gboolean read_central_dir(JavaArchive *archive, GError **error)
+{
+    const guchar *eocd = find_end_of_central_dir(archive->data,
+            archive->length);
+    const guchar *p = NULL;
+    guint32 dir_size = 0;
+    guint32 dir_offset = 0;
+
+    if (eocd == NULL) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+                "Error reading archive %s: No central directory found\n",
+                archive->filename);
+        return FALSE;
+    }
+
+    archive->entry_count = read_u16(eocd + 10);
+    dir_size = read_u32(eocd + 12);
+    dir_offset = read_u32(eocd + 16);
+
+    if (archive->entry_count == 0xFFFF || dir_offset == 0xFFFFFFFF) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+                "Error reading archive %s: ZIP64 archives are not supported\n",
+                archive->filename);
+        return FALSE;
+    }
+
+    if ((gsize) dir_offset + dir_size > archive->length) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+                "Error reading archive %s: Central directory out of bounds\n",
+                archive->filename);
+        return FALSE;
+    }
+
+    archive->entries = g_new(JavaArchiveEntry, archive->entry_count);
+    p = archive->data + dir_offset;
+
+    for (guint i = 0; i < archive->entry_count; i++) {
+        JavaArchiveEntry *entry = &archive->entries[i];
+        guint16 name_len = 0;
+
+        if (p + ZIP_CENTRAL_DIR_ENTRY_SIZE > archive->data + dir_offset + dir_size ||
+                read_u32(p) != ZIP_CENTRAL_DIR_ENTRY_SIG) {
+            g_set_error(error, JAVACLASS_GERROR,
+                    JAVACLASS_ERROR_INVALID_ARCHIVE,
+                    "Error reading archive %s: Corrupt central directory\n",
+                    archive->filename);
+            return FALSE;
+        }
+
+        name_len = read_u16(p + 28);
+        if (p + ZIP_CENTRAL_DIR_ENTRY_SIZE + name_len >
+                archive->data + dir_offset + dir_size) {
+            g_set_error(error, JAVACLASS_GERROR,
+                    JAVACLASS_ERROR_INVALID_ARCHIVE,
+                    "Error reading archive %s: Corrupt central directory\n",
+                    archive->filename);
+            return FALSE;
+        }
+
+        entry->method = read_u16(p + 10);
+        entry->compressed_size = read_u32(p + 20);
+        entry->size = read_u32(p + 24);
+        entry->offset = read_u32(p + 42);
+        entry->name = g_string_chunk_insert_len(archive->names,
+                (const gchar*) p + ZIP_CENTRAL_DIR_ENTRY_SIZE, name_len);
+
+        p += ZIP_CENTRAL_DIR_ENTRY_SIZE + name_len + read_u16(p + 30) +
+            read_u16(p + 32);
+    }
+
+    return TRUE;
+}
+
+JavaArchive* javaarchive_open(const gchar *filename, GError **error)
+{
+    JavaArchive *archive = NULL;
+    GMappedFile *file = NULL;
+
+    file = g_mapped_file_new(filename, FALSE, error);
+    if (file == NULL) return NULL;
+
+    archive = g_new(JavaArchive, 1);
+    archive->filename = g_strdup(filename);
+    archive->file = file;
+    archive->bytes = g_mapped_file_get_bytes(file);
+    archive->data = g_bytes_get_data(archive->bytes, &archive->length);
+    archive->entry_count = 0;
+    archive->entries = NULL;
+    archive->names = g_string_chunk_new(4096);
+
+    if (!read_central_dir(archive, error)) {
+        javaarchive_free(archive);
+        return NULL;
+    }
+
+    return archive;
+}
+
+const gchar* javaarchive_get_filename(JavaArchive *archive)
+{
+    return archive->filename;
+}
+
+guint javaarchive_get_entry_count(JavaArchive *archive)
+{
+    return archive->entry_count;
+}
+
+const JavaArchiveEntry* javaarchive_get_entry(JavaArchive *archive, guint i)
+{
+    g_return_val_if_fail(i < archive->entry_count, NULL);
+
+    return &archive->entries[i];
+}
+
+gboolean javaarchive_entry_is_class(const JavaArchiveEntry *entry)
+{
+    return g_str_has_suffix(entry->name, ".class");
+}
+
+/*
+ * Inflate a raw deflate stream of a known uncompressed size
+ */
+static GBytes* inflate_entry(JavaArchive *archive,
+        const JavaArchiveEntry *entry, const guchar *src, GError **error)
+{
+    z_stream stream;
+    guchar *dest = g_malloc(MAX(entry->size, 1));
+    int status;
+
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = (Bytef*) src;
+    stream.avail_in = entry->compressed_size;
+    stream.next_out = dest;
+    stream.avail_out = entry->size;
+
+    // negative window bits: ZIP entries have no zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        g_free(dest);
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+                "Error reading archive %s: Can't initialize zlib\n",
+                archive->filename);
+        return NULL;
+    }
+
+    status = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+
+    if (status != Z_STREAM_END || stream.total_out != entry->size) {
+        g_free(dest);
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+                "Error reading archive %s: Can't inflate %s\n",
+                archive->filename, entry->name);
+        return NULL;
+    }
+
+    return g_bytes_new_take(dest, entry->size);
+}
+
+GBytes* javaarchive_read_entry(JavaArchive *archive,
+        const JavaArchiveEntry *entry, GError **error)
+{
+    const guchar *header = archive->data + entry->offset;
+    gsize data_offset = 0;
+
+    if ((gsize) entry->offset + ZIP_LOCAL_HEADER_SIZE > archive->length ||
+            read_u32(header) != ZIP_LOCAL_HEADER_SIG) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+                "Error reading archive %s: Corrupt local header of %s\n",
+                archive->filename, entry->name);
+        return NULL;
+    }
+
+    // the sizes of name and extra field may differ from the central directory
+    data_offset = entry->offset + ZIP_LOCAL_HEADER_SIZE +
+        read_u16(header + 26) + read_u16(header + 28);
+
+    if (data_offset + entry->compressed_size > archive->length) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+                "Error reading archive %s: Entry %s out of bounds\n",
+                archive->filename, entry->name);
+        return NULL;
+    }
+
+    switch (entry->method) {
+        case ZIP_METHOD_STORED:
+            return g_bytes_new_from_bytes(archive->bytes, data_offset,
+                    entry->compressed_size);
+        case ZIP_METHOD_DEFLATED:
+            return inflate_entry(archive, entry, archive->data + data_offset,
+                    error);
+        default:
+            g_set_error(error, JAVACLASS_GERROR,
+                    JAVACLASS_ERROR_INVALID_ARCHIVE,
+                    "Error reading archive %s: Unsupported compression method %d of %s\n",
+                    archive->filename, entry->method, entry->name);
+            return NULL;
+    }
+}
+
+void javaarchive_free(JavaArchive *archive)
+{
+    if (archive != NULL) {
+        g_free(archive->filename);
+        g_free(archive->entries);
+        g_string_chunk_free(archive->names);
+        g_bytes_unref(archive->bytes);
+        g_mapped_file_unref(archive->file);
+        g_free(archive);
+    }
+}
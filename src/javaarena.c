@@ -0,0 +1,125 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "javaprivate.h"
+
+/*
+ * Alignment of all allocations (enough for gint64, gdouble and pointers)
+ */
+#define ARENA_ALIGNMENT 8
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~((gsize) ARENA_ALIGNMENT - 1))
+
+#define ARENA_MIN_BLOCK_SIZE 4096
+
+typedef struct _JavaArenaBlock
+{
+    struct _JavaArenaBlock *next; // the previously filled block
+    gsize size;
+    gsize used;
+} JavaArenaBlock;
+
+struct _JavaArena
+{
+    JavaArenaBlock *current;
+    gsize block_size;
+};
+
+/*
+ * Size of the block header rounded up so that the data following it is aligned
+ */
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(JavaArenaBlock))
+
+static JavaArenaBlock* block_new(gsize size, JavaArenaBlock *next)
+{
+    JavaArenaBlock *block = g_malloc(ARENA_HEADER_SIZE + size);
+
+    block->next = next;
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
+
+JavaArena* javaarena_new(gsize block_size)
+{
+    JavaArena *arena = g_new(JavaArena, 1);
+
+    arena->block_size = MAX(ARENA_ALIGN(block_size), ARENA_MIN_BLOCK_SIZE);
+    arena->current = block_new(arena->block_size, NULL);
+
+    return arena;
+}
+
+gpointer javaarena_alloc(JavaArena *arena, gsize size)
+{
+    JavaArenaBlock *block = arena->current;
+    gpointer mem = NULL;
+
+    if (size == 0) return NULL;
+
+    size = ARENA_ALIGN(size);
+
+    if (block->size - block->used < size) {
+        // grow geometrically so that a large class needs only a few blocks
+        arena->block_size = MAX(arena->block_size * 2, size);
+        block = block_new(arena->block_size, block);
+        arena->current = block;
+    }
+
+    mem = (guchar*) block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+
+    return mem;
+}
+
+void javaarena_reset(JavaArena *arena)
+{
+    JavaArenaBlock *block = arena->current;
+    JavaArenaBlock *next = NULL;
+    gsize total = 0;
+
+    if (block->next == NULL) {
+        block->used = 0;
+        return;
+    }
+
+    // merge all blocks into one that can hold everything we needed last time
+    while (block != NULL) {
+        next = block->next;
+        total += block->size;
+        g_free(block);
+        block = next;
+    }
+
+    arena->block_size = total;
+    arena->current = block_new(total, NULL);
+}
+
+void javaarena_free(JavaArena *arena)
+{
+    JavaArenaBlock *block = NULL;
+    JavaArenaBlock *next = NULL;
+
+    if (arena != NULL) {
+        for (block = arena->current; block != NULL; block = next) {
+            next = block->next;
+            g_free(block);
+        }
+
+        g_free(arena);
+    }
+}
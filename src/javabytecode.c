@@ -0,0 +1,212 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "javabytecode.h"
+
+/*
+ * Length and operand of every opcode, 0 for variable length instructions
+ */
+typedef struct _opcode_info
+{
+    const gchar *name;
+    guint8 length;
+    guint8 operand;
+} opcode_info;
+
+#define NONE JAVABYTECODE_OPERAND_NONE
+#define CONST JAVABYTECODE_OPERAND_CONSTANT
+#define LOCAL JAVABYTECODE_OPERAND_LOCAL
+#define BRANCH JAVABYTECODE_OPERAND_BRANCH
+#define IMM JAVABYTECODE_OPERAND_IMMEDIATE
+#define SWITCH JAVABYTECODE_OPERAND_SWITCH
+
+static const opcode_info opcodes[JAVABYTECODE_OPCODE_COUNT] = {
+    {"nop", 1, NONE}, {"aconst_null", 1, NONE}, {"iconst_m1", 1, NONE},
+    {"iconst_0", 1, NONE}, {"iconst_1", 1, NONE}, {"iconst_2", 1, NONE},
+    {"iconst_3", 1, NONE}, {"iconst_4", 1, NONE}, {"iconst_5", 1, NONE},
+    {"lconst_0", 1, NONE}, {"lconst_1", 1, NONE}, {"fconst_0", 1, NONE},
+    {"fconst_1", 1, NONE}, {"fconst_2", 1, NONE}, {"dconst_0", 1, NONE},
+    {"dconst_1", 1, NONE}, {"bipush", 2, IMM}, {"sipush", 3, IMM},
+    {"ldc", 2, CONST}, {"ldc_w", 3, CONST}, {"ldc2_w", 3, CONST},
+    {"iload", 2, LOCAL}, {"lload", 2, LOCAL}, {"fload", 2, LOCAL},
+    {"dload", 2, LOCAL}, {"aload", 2, LOCAL}, {"iload_0", 1, NONE},
+    {"iload_1", 1, NONE}, {"iload_2", 1, NONE}, {"iload_3", 1, NONE},
+    {"lload_0", 1, NONE}, {"lload_1", 1, NONE}, {"lload_2", 1, NONE},
+    {"lload_3", 1, NONE}, {"fload_0", 1, NONE}, {"fload_1", 1, NONE},
+    {"fload_2", 1, NONE}, {"fload_3", 1, NONE}, {"dload_0", 1, NONE},
+    {"dload_1", 1, NONE}, {"dload_2", 1, NONE}, {"dload_3", 1, NONE},
+    {"aload_0", 1, NONE}, {"aload_1", 1, NONE}, {"aload_2", 1, NONE},
+    {"aload_3", 1, NONE}, {"iaload", 1, NONE}, {"laload", 1, NONE},
+    {"faload", 1, NONE}, {"daload", 1, NONE}, {"aaload", 1, NONE},
+    {"baload", 1, NONE}, {"caload", 1, NONE}, {"saload", 1, NONE},
+    {"istore", 2, LOCAL}, {"lstore", 2, LOCAL}, {"fstore", 2, LOCAL},
+    {"dstore", 2, LOCAL}, {"astore", 2, LOCAL}, {"istore_0", 1, NONE},
+    {"istore_1", 1, NONE}, {"istore_2", 1, NONE}, {"istore_3", 1, NONE},
+    {"lstore_0", 1, NONE}, {"lstore_1", 1, NONE}, {"lstore_2", 1, NONE},
+    {"lstore_3", 1, NONE}, {"fstore_0", 1, NONE}, {"fstore_1", 1, NONE},
+    {"fstore_2", 1, NONE}, {"fstore_3", 1, NONE}, {"dstore_0", 1, NONE},
+    {"dstore_1", 1, NONE}, {"dstore_2", 1, NONE}, {"dstore_3", 1, NONE},
+    {"astore_0", 1, NONE}, {"astore_1", 1, NONE}, {"astore_2", 1, NONE},
+    {"astore_3", 1, NONE}, {"iastore", 1, NONE}, {"lastore", 1, NONE},
+    {"fastore", 1, NONE}, {"dastore", 1, NONE}, {"aastore", 1, NONE},
+    {"bastore", 1, NONE}, {"castore", 1, NONE}, {"sastore", 1, NONE},
+    {"pop", 1, NONE}, {"pop2", 1, NONE}, {"dup", 1, NONE},
+    {"dup_x1", 1, NONE}, {"dup_x2", 1, NONE}, {"dup2", 1, NONE},
+    {"dup2_x1", 1, NONE}, {"dup2_x2", 1, NONE}, {"swap", 1, NONE},
+    {"iadd", 1, NONE}, {"ladd", 1, NONE}, {"fadd", 1, NONE},
+    {"dadd", 1, NONE}, {"isub", 1, NONE}, {"lsub", 1, NONE},
+    {"fsub", 1, NONE}, {"dsub", 1, NONE}, {"imul", 1, NONE},
+    {"lmul", 1, NONE}, {"fmul", 1, NONE}, {"dmul", 1, NONE},
+    {"idiv", 1, NONE}, {"ldiv", 1, NONE}, {"fdiv", 1, NONE},
+    {"ddiv", 1, NONE}, {"irem", 1, NONE}, {"lrem", 1, NONE},
+    {"frem", 1, NONE}, {"drem", 1, NONE}, {"ineg", 1, NONE},
+    {"lneg", 1, NONE}, {"fneg", 1, NONE}, {"dneg", 1, NONE},
+    {"ishl", 1, NONE}, {"lshl", 1, NONE}, {"ishr", 1, NONE},
+    {"lshr", 1, NONE}, {"iushr", 1, NONE}, {"lushr", 1, NONE},
+    {"iand", 1, NONE}, {"land", 1, NONE}, {"ior", 1, NONE},
+    {"lor", 1, NONE}, {"ixor", 1, NONE}, {"lxor", 1, NONE},
+    {"iinc", 3, LOCAL}, {"i2l", 1, NONE}, {"i2f", 1, NONE},
+    {"i2d", 1, NONE}, {"l2i", 1, NONE}, {"l2f", 1, NONE},
+    {"l2d", 1, NONE}, {"f2i", 1, NONE}, {"f2l", 1, NONE},
+    {"f2d", 1, NONE}, {"d2i", 1, NONE}, {"d2l", 1, NONE},
+    {"d2f", 1, NONE}, {"i2b", 1, NONE}, {"i2c", 1, NONE},
+    {"i2s", 1, NONE}, {"lcmp", 1, NONE}, {"fcmpl", 1, NONE},
+    {"fcmpg", 1, NONE}, {"dcmpl", 1, NONE}, {"dcmpg", 1, NONE},
+    {"ifeq", 3, BRANCH}, {"ifne", 3, BRANCH}, {"iflt", 3, BRANCH},
+    {"ifge", 3, BRANCH}, {"ifgt", 3, BRANCH}, {"ifle", 3, BRANCH},
+    {"if_icmpeq", 3, BRANCH}, {"if_icmpne", 3, BRANCH},
+    {"if_icmplt", 3, BRANCH}, {"if_icmpge", 3, BRANCH},
+    {"if_icmpgt", 3, BRANCH}, {"if_icmple", 3, BRANCH},
+    {"if_acmpeq", 3, BRANCH}, {"if_acmpne", 3, BRANCH},
+    {"goto", 3, BRANCH}, {"jsr", 3, BRANCH}, {"ret", 2, LOCAL},
+    {"tableswitch", 0, SWITCH}, {"lookupswitch", 0, SWITCH},
+    {"ireturn", 1, NONE}, {"lreturn", 1, NONE}, {"freturn", 1, NONE},
+    {"dreturn", 1, NONE}, {"areturn", 1, NONE}, {"return", 1, NONE},
+    {"getstatic", 3, CONST}, {"putstatic", 3, CONST},
+    {"getfield", 3, CONST}, {"putfield", 3, CONST},
+    {"invokevirtual", 3, CONST}, {"invokespecial", 3, CONST},
+    {"invokestatic", 3, CONST}, {"invokeinterface", 5, CONST},
+    {"invokedynamic", 5, CONST}, {"new", 3, CONST},
+    {"newarray", 2, IMM}, {"anewarray", 3, CONST},
+    {"arraylength", 1, NONE}, {"athrow", 1, NONE},
+    {"checkcast", 3, CONST}, {"instanceof", 3, CONST},
+    {"monitorenter", 1, NONE}, {"monitorexit", 1, NONE},
+    {"wide", 0, LOCAL}, {"multianewarray", 4, CONST},
+    {"ifnull", 3, BRANCH}, {"ifnonnull", 3, BRANCH},
+    {"goto_w", 5, BRANCH}, {"jsr_w", 5, BRANCH}
+};
+
+#define OP_TABLESWITCH  170
+#define OP_LOOKUPSWITCH 171
+#define OP_IINC         132
+
+static guint32 read_u32(const guchar *p)
+{
+    return ((guint32) p[0] << 24) | ((guint32) p[1] << 16) |
+        ((guint32) p[2] << 8) | (guint32) p[3];
+}
+
+/*
+ * Length of a tableswitch or lookupswitch instruction, 0 if it is truncated
+ */
+static guint32 switch_length(const guchar *code, guint32 codelen,
+        guint32 offset, guint8 opcode)
+{
+    // the operands start at the next multiple of 4
+    guint32 pos = (offset + 4) & ~3U;
+    guint64 length = 0;
+
+    if (opcode == OP_TABLESWITCH) {
+        gint32 low = 0;
+        gint32 high = 0;
+
+        if ((guint64) pos + 12 > codelen) return 0;
+
+        low = (gint32) read_u32(code + pos + 4);
+        high = (gint32) read_u32(code + pos + 8);
+        if (high < low) return 0;
+
+        length = pos - offset + 12 + ((guint64) high - low + 1) * 4;
+    } else {
+        gint32 npairs = 0;
+
+        if ((guint64) pos + 8 > codelen) return 0;
+
+        npairs = (gint32) read_u32(code + pos + 4);
+        if (npairs < 0) return 0;
+
+        length = pos - offset + 8 + (guint64) npairs * 8;
+    }
+
+    return offset + length <= codelen ? (guint32) length : 0;
+}
+
+guint32 javabytecode_decode(const guchar *code, guint32 codelen,
+        guint32 offset, JavaInstruction *instruction)
+{
+    guint8 opcode = 0;
+    guint32 length = 0;
+
+    if (offset >= codelen) return 0;
+
+    opcode = code[offset];
+    if (opcode >= JAVABYTECODE_OPCODE_COUNT) return 0;
+
+    instruction->offset = offset;
+    instruction->opcode = opcode;
+    instruction->wide = FALSE;
+    instruction->operand = opcodes[opcode].operand;
+    instruction->cp_index = 0;
+
+    if (opcode == JAVABYTECODE_WIDE) {
+        if (offset + 1 >= codelen) return 0;
+
+        opcode = code[offset + 1];
+        if (opcode != OP_IINC && (opcode >= JAVABYTECODE_OPCODE_COUNT ||
+                    opcodes[opcode].operand != JAVABYTECODE_OPERAND_LOCAL ||
+                    opcode == JAVABYTECODE_WIDE)) {
+            return 0;
+        }
+
+        instruction->opcode = opcode;
+        instruction->wide = TRUE;
+        length = opcode == OP_IINC ? 6 : 4;
+    } else if (opcode == OP_TABLESWITCH || opcode == OP_LOOKUPSWITCH) {
+        length = switch_length(code, codelen, offset, opcode);
+        if (length == 0) return 0;
+    } else {
+        length = opcodes[opcode].length;
+    }
+
+    if (length > codelen - offset) return 0;
+
+    if (instruction->operand == JAVABYTECODE_OPERAND_CONSTANT) {
+        instruction->cp_index = opcode == JAVABYTECODE_LDC ? code[offset + 1] :
+            (code[offset + 1] << 8) | code[offset + 2];
+    }
+
+    instruction->length = length;
+
+    return length;
+}
+
+const gchar* javabytecode_get_opcode_name(guint8 opcode)
+{
+    if (opcode >= JAVABYTECODE_OPCODE_COUNT) return NULL;
+
+    return opcodes[opcode].name;
+}
@@ -24,23 +24,7 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include <unistd.h>
 
 #include "javaclass.h"
-
-#define MAX_MAJOR_VERSION 50
-
-/*
- * Tags used to classify entries in the constant pool
- */
-#define TAG_UTF8                1
-#define TAG_INTEGER             3
-#define TAG_FLOAT               4
-#define TAG_LONG                5
-#define TAG_DOUBLE              6
-#define TAG_CLASS               7
-#define TAG_STRING              8
-#define TAG_FIELDREF            9
-#define TAG_METHODREF          10
-#define TAG_INTERFACEMETHODREF 11
-#define TAG_NAMEANDTYPE        12
+#include "javaprivate.h"
 
 /*
  * Class access and property bitmasks
@@ -65,18 +49,59 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #define INVALID_INDEX 65535
 
+/*
+ * The parser is compiled into one variant per parse mode. The mode is a
+ * constant in each of them, so the compiler removes the branches for the
+ * other modes.
+ */
+#ifdef __GNUC__
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+typedef enum
+{
+    PARSE_HIERARCHY,    // class, parent and interfaces only
+    PARSE_METADATA,     // everything but the bytecode
+    PARSE_CODE          // everything
+} parse_mode;
+
+/*
+ * Constant pool indices of the names of the attributes we keep, so that each
+ * name is compared as a string only once per class
+ */
+typedef struct _attribute_names
+{
+    guint16 index[ATTRIBUTE_KIND_COUNT];
+} attribute_names;
+
 /*
  * Error codes
  */
 #define JAVACLASS_ERROR_READING_FILE 1
 
+/*
+ * Allocate memory for a part of a class. Classes created by a JavaClassParser
+ * take all their memory from the parser's arena.
+ */
+static gpointer class_alloc(JavaClass *c, gsize size)
+{
+    if (c->_arena != NULL) return javaarena_alloc(c->_arena, size);
+
+    return g_malloc(size);
+}
+
+#define class_new(c, struct_type, n_structs) \
+    ((struct_type*) class_alloc((c), sizeof(struct_type) * (n_structs)))
+
 /*
  * Return a string from the constant pool
  */
 static gchar* string_from_cp(JavaClass *c, guint16 i)
 {
-    g_assert(c->constant_pool[i].tag == TAG_UTF8);
-    return c->constant_pool[i].value.str;
+    g_assert(c->cp_tags[i] == TAG_UTF8);
+    return c->cp_strings + c->cp_values[i].offset;
 }
 
 /*
@@ -84,9 +109,25 @@ static gchar* string_from_cp(JavaClass *c, guint16 i)
  */
 static gchar* classname_from_cp(JavaClass *c, guint16 i)
 {
-    g_assert(c->constant_pool[i].tag == TAG_CLASS);
-    g_assert(c->constant_pool[c->constant_pool[i].value.index].tag == TAG_UTF8);
-    return c->constant_pool[c->constant_pool[i].value.index].value.str;
+    g_assert(c->cp_tags[i] == TAG_CLASS);
+    return string_from_cp(c, c->cp_values[i].index);
+}
+
+gchar* javaclass_cp_string(JavaClass *c, guint16 i)
+{
+    return string_from_cp(c, i);
+}
+
+gint javaclass_cp_find_tag(JavaClass *c, guint8 tag, gint start)
+{
+    guint8 *pos = NULL;
+
+    if (start >= c->constant_pool_count) return -1;
+
+    // memchr is vectorized by the C library
+    pos = memchr(c->cp_tags + start, tag, c->constant_pool_count - start);
+
+    return pos != NULL ? pos - c->cp_tags : -1;
 }
 
 /*
@@ -109,32 +150,90 @@ static void skip_bytes(guint32 *offset, guint32 num)
 }
 
 /*
- * Convert an classname in the internal format to the external format
+ * Return a copy of the name of a class from a constant pool index to the
+ * classref converted from the internal to the external format
  *
  * Internal format uses '/' as delimiter while external format uses '.'
  * So for example 'java/lang/Object' becomes 'java.lang.Object'
+ *
+ * The constant pool itself is never modified, so a class doesn't change
+ * after javaclass_new() returned.
  */
-static void classname_to_external_format(gchar *str)
+static gchar* external_classname(JavaClass *c, guint16 i)
 {
-    while (*str != 0) {
-        if (*str == '/') *str = '.';
-        str++;
+    gchar *internal = classname_from_cp(c, i);
+    gsize len = strlen(internal);
+    gchar *str = class_new(c, gchar, len + 1);
+
+    for (gsize j = 0; j <= len; j++) {
+        str[j] = internal[j] == '/' ? '.' : internal[j];
+    }
+
+    return str;
+}
+
+guint8 javaclass_attribute_kind(const gchar *name)
+{
+    static const struct {
+        const gchar *name;
+        guint8 kind;
+    } kinds[] = {
+        {"AnnotationDefault", ATTRIBUTE_ANNOTATION_DEFAULT},
+        {"BootstrapMethods", ATTRIBUTE_BOOTSTRAP_METHODS},
+        {"Code", ATTRIBUTE_CODE},
+        {"ConstantValue", ATTRIBUTE_CONSTANT_VALUE},
+        {"Deprecated", ATTRIBUTE_DEPRECATED},
+        {"EnclosingMethod", ATTRIBUTE_ENCLOSING_METHOD},
+        {"Exceptions", ATTRIBUTE_EXCEPTIONS},
+        {"InnerClasses", ATTRIBUTE_INNER_CLASSES},
+        {"MethodParameters", ATTRIBUTE_METHOD_PARAMETERS},
+        {"Module", ATTRIBUTE_MODULE},
+        {"ModuleMainClass", ATTRIBUTE_MODULE_MAIN_CLASS},
+        {"ModulePackages", ATTRIBUTE_MODULE_PACKAGES},
+        {"NestHost", ATTRIBUTE_NEST_HOST},
+        {"NestMembers", ATTRIBUTE_NEST_MEMBERS},
+        {"PermittedSubclasses", ATTRIBUTE_PERMITTED_SUBCLASSES},
+        {"Record", ATTRIBUTE_RECORD},
+        {"RuntimeInvisibleAnnotations", ATTRIBUTE_INVISIBLE_ANNOTATIONS},
+        {"RuntimeInvisibleParameterAnnotations",
+            ATTRIBUTE_INVISIBLE_PARAMETER_ANNOTATIONS},
+        {"RuntimeInvisibleTypeAnnotations",
+            ATTRIBUTE_INVISIBLE_TYPE_ANNOTATIONS},
+        {"RuntimeVisibleAnnotations", ATTRIBUTE_VISIBLE_ANNOTATIONS},
+        {"RuntimeVisibleParameterAnnotations",
+            ATTRIBUTE_VISIBLE_PARAMETER_ANNOTATIONS},
+        {"RuntimeVisibleTypeAnnotations", ATTRIBUTE_VISIBLE_TYPE_ANNOTATIONS},
+        {"Signature", ATTRIBUTE_SIGNATURE},
+        {"SourceFile", ATTRIBUTE_SOURCEFILE},
+        {"Synthetic", ATTRIBUTE_SYNTHETIC}
+    };
+
+    for (guint i = 0; i < G_N_ELEMENTS(kinds); i++) {
+        // the first letter rules out most names without a call
+        if (kinds[i].name[0] == name[0] && strcmp(kinds[i].name, name) == 0) {
+            return kinds[i].kind;
+        }
     }
+
+    return ATTRIBUTE_UNKNOWN;
 }
 
 /*
- * Find out if a given attribute name belongs to those we are interested in
+ * Find out which of the attributes we keep a name belongs to
  */
-static gboolean is_known_attribute(gchar *attribute)
+static guint8 attribute_kind(JavaClass *c, attribute_names *names,
+        guint16 name_index)
 {
-    gchar *known_attributes[] = {"Exceptions", "SourceFile", "Signature",
-        "Code", NULL};
+    guint8 kind = ATTRIBUTE_UNKNOWN;
 
-    for (int i = 0; known_attributes[i]; i++) {
-        if (g_strcmp0(attribute, known_attributes[i]) == 0) return TRUE;
+    for (guint8 i = 1; i < ATTRIBUTE_KIND_COUNT; i++) {
+        if (names->index[i] == name_index) return i;
     }
 
-    return FALSE;
+    kind = javaclass_attribute_kind(string_from_cp(c, name_index));
+    if (kind != ATTRIBUTE_UNKNOWN) names->index[kind] = name_index;
+
+    return kind;
 }
 
 /*
@@ -144,55 +243,53 @@ static void read_constant_pool(JavaClass *c, guchar *classbytes,
         guint32 *offset, GError **error)
 {
     guint16 slen = 0;
-    cp_info *cur = NULL;
-
-    for (int i = 0; i < c->constant_pool_count; i++) {
-        cur = &c->constant_pool[i];
-        copy_bytes(&cur->tag, classbytes, offset, 1);
-        switch (cur->tag) {
+    guint8 tag = 0;
+    cp_value *cur = NULL;
+    guint32 strings_size = 0;
+    guint32 pos = 0;
+    gint i = 0;
+
+    for (i = 0; i < c->constant_pool_count; i++) {
+        cur = &c->cp_values[i];
+        copy_bytes(&tag, classbytes, offset, 1);
+        c->cp_tags[i] = tag;
+
+        switch (tag) {
             case TAG_UTF8:
                 copy_bytes(&slen, classbytes, offset, 2);
                 GUINT16_CONV(slen);
 
-                // FIXME: Convert the string to real UTF-8
-                cur->value.str = (gchar*) g_malloc(slen + 1);
-                copy_bytes(cur->value.str, classbytes, offset, slen);
-                cur->value.str[slen] = '\0';
+                // remember where the string starts, it is copied once we
+                // know how much space all the strings need
+                cur->offset = *offset;
+                strings_size += slen + 1;
+                skip_bytes(offset, slen);
                 break;
             case TAG_INTEGER:
-                copy_bytes(&cur->value.i, classbytes, offset, 4);
-                GINT32_CONV(cur->value.i);
-                break;
+                // same as TAG_FLOAT, we only swap the bytes of the raw value
             case TAG_FLOAT:
-                copy_bytes(&cur->value.f, classbytes, offset, 4);
-                GINT32_CONV(cur->value.f);
+                copy_bytes(&cur->i, classbytes, offset, 4);
+                GINT32_CONV(cur->i);
                 break;
             case TAG_LONG:
-                copy_bytes(&cur->value.l, classbytes, offset, 8);
-                GINT64_CONV(cur->value.l);
-
-                // LONGs occupy two slots
-                i++;
-                cur = &c->constant_pool[i];
-                cur->tag = TAG_LONG;
-
-                break;
+                // same as TAG_DOUBLE
             case TAG_DOUBLE:
-                copy_bytes(&cur->value.d, classbytes, offset, 8);
-                GINT64_CONV(cur->value.d);
+                // LONGs and DOUBLEs occupy two slots
+                copy_bytes(&cur->word, classbytes, offset, 4);
+                GUINT32_CONV(cur->word);
 
-                // DOUBLEs occupy two slots
                 i++;
-                cur = &c->constant_pool[i];
-                cur->tag = TAG_DOUBLE;
-
+                cur = &c->cp_values[i];
+                c->cp_tags[i] = tag;
+                copy_bytes(&cur->word, classbytes, offset, 4);
+                GUINT32_CONV(cur->word);
                 break;
             case TAG_CLASS:
                 // same as TAG_STRING
             case TAG_STRING:
-                copy_bytes(&cur->value.index, classbytes, offset, 2);
-                GUINT16_CONV(cur->value.index);
-                cur->value.index--;
+                copy_bytes(&cur->index, classbytes, offset, 2);
+                GUINT16_CONV(cur->index);
+                cur->index--;
                 break;
             case TAG_FIELDREF:
                 // same as METHODREF, INTERFACEMETHODREF, and
@@ -203,30 +300,75 @@ static void read_constant_pool(JavaClass *c, guchar *classbytes,
             case TAG_INTERFACEMETHODREF:
                 // same as FIELDREF, METHODREF, NAMEANDTYPE
             case TAG_NAMEANDTYPE:
-                copy_bytes(&cur->value.indexpair[0], classbytes, offset, 2);
-                GUINT16_CONV(cur->value.indexpair[0]);
-                cur->value.indexpair[0]--;
+                copy_bytes(&cur->indexpair[0], classbytes, offset, 2);
+                GUINT16_CONV(cur->indexpair[0]);
+                cur->indexpair[0]--;
 
-                copy_bytes(&cur->value.indexpair[1], classbytes, offset, 2);
-                GUINT16_CONV(cur->value.indexpair[1]);
-                cur->value.indexpair[1]--;
+                copy_bytes(&cur->indexpair[1], classbytes, offset, 2);
+                GUINT16_CONV(cur->indexpair[1]);
+                cur->indexpair[1]--;
+                break;
+            case TAG_METHODHANDLE:
+                copy_bytes(&cur->handle.kind, classbytes, offset, 1);
+                copy_bytes(&cur->handle.index, classbytes, offset, 2);
+                GUINT16_CONV(cur->handle.index);
+                cur->handle.index--;
+                break;
+            case TAG_METHODTYPE:
+                // same as TAG_MODULE and TAG_PACKAGE
+            case TAG_MODULE:
+                // same as TAG_METHODTYPE and TAG_PACKAGE
+            case TAG_PACKAGE:
+                copy_bytes(&cur->index, classbytes, offset, 2);
+                GUINT16_CONV(cur->index);
+                cur->index--;
+                break;
+            case TAG_DYNAMIC:
+                // same as TAG_INVOKEDYNAMIC
+            case TAG_INVOKEDYNAMIC:
+                // the bootstrap method is an index into the BootstrapMethods
+                // attribute, not into the constant pool
+                copy_bytes(&cur->indexpair[0], classbytes, offset, 2);
+                GUINT16_CONV(cur->indexpair[0]);
+
+                copy_bytes(&cur->indexpair[1], classbytes, offset, 2);
+                GUINT16_CONV(cur->indexpair[1]);
+                cur->indexpair[1]--;
                 break;
             default:
                 g_set_error(error,
                         JAVACLASS_GERROR,
                         JAVACLASS_ERROR_TAG_UNKNOWN,
-                        "Error parsing class file: Unknown constant pool tag %d\n", cur->tag);
+                        "Error parsing class file: Unknown constant pool tag %d\n", tag);
                 return;
         }
     }
+
+    // copy all UTF-8 entries into one block of memory
+    // FIXME: Convert the strings to real UTF-8
+    c->cp_strings_size = strings_size;
+    c->cp_strings = class_new(c, gchar, strings_size);
+
+    for (i = javaclass_cp_find_tag(c, TAG_UTF8, 0); i >= 0;
+            i = javaclass_cp_find_tag(c, TAG_UTF8, i + 1)) {
+        cur = &c->cp_values[i];
+
+        memcpy(&slen, classbytes + cur->offset - 2, 2);
+        GUINT16_CONV(slen);
+
+        memcpy(c->cp_strings + pos, classbytes + cur->offset, slen);
+        c->cp_strings[pos + slen] = '\0';
+        cur->offset = pos;
+        pos += slen + 1;
+    }
 }
 
 /*
  * Read an attribute section of a Java class file
  */
-static void read_attributes(JavaClass *c, attribute_info *attributes,
-        guchar *classbytes, guint32 *offset, guint16 attributes_count,
-        GError **error)
+static ALWAYS_INLINE void read_attributes(JavaClass *c, attribute_names *names,
+        attribute_info *attributes, guchar *classbytes, guint32 *offset,
+        guint16 attributes_count, const parse_mode mode)
 {
     attribute_info *cur = NULL;
 
@@ -240,12 +382,26 @@ static void read_attributes(JavaClass *c, attribute_info *attributes,
         copy_bytes(&cur->attribute_length, classbytes, offset, 4);
         GUINT32_CONV(cur->attribute_length);
 
-        if (is_known_attribute(string_from_cp(c, cur->attribute_name_index))) {
-            cur->info = g_new(guchar, cur->attribute_length);
-            copy_bytes(cur->info, classbytes, offset, cur->attribute_length);
-        } else {
+        cur->_kind = attribute_kind(c, names, cur->attribute_name_index);
+
+        // the bytecode is only kept if it was asked for
+        if (mode != PARSE_CODE && cur->_kind == ATTRIBUTE_CODE) {
+            cur->_kind = ATTRIBUTE_UNKNOWN;
+        }
+
+        // unknown attributes are only kept by a full parse, which is what
+        // javaclass_write() needs to write them back
+        if ((mode != PARSE_CODE && cur->_kind == ATTRIBUTE_UNKNOWN) ||
+                cur->attribute_length == 0) {
             cur->info = NULL;
             skip_bytes(offset, cur->attribute_length);
+        } else if (c->_bytes != NULL) {
+            // borrowed attributes are views into the class buffer
+            cur->info = classbytes + *offset;
+            skip_bytes(offset, cur->attribute_length);
+        } else {
+            cur->info = class_new(c, guchar, cur->attribute_length);
+            copy_bytes(cur->info, classbytes, offset, cur->attribute_length);
         }
     }
 }
@@ -253,11 +409,10 @@ static void read_attributes(JavaClass *c, attribute_info *attributes,
 /*
  * Read the fields section of a Java class file
  */
-static void read_fields(JavaClass *c, guchar *classbytes, guint32 *offset,
-        GError **error)
+static ALWAYS_INLINE void read_fields(JavaClass *c, attribute_names *names,
+        guchar *classbytes, guint32 *offset, const parse_mode mode)
 {
     field_info *cur = NULL;
-    GError *suberror = NULL;
 
     for (int i = 0; i < c->fields_count; i++) {
         cur = &c->fields[i];
@@ -276,25 +431,19 @@ static void read_fields(JavaClass *c, guchar *classbytes, guint32 *offset,
         copy_bytes(&cur->attributes_count, classbytes, offset, 2);
         GUINT16_CONV(cur->attributes_count);
 
-        cur->attributes = g_new(attribute_info, cur->attributes_count);
-        read_attributes(c, cur->attributes, classbytes, offset,
-                cur->attributes_count, &suberror);
-
-        if (suberror != NULL) {
-            g_propagate_error(error, suberror);
-            return;
-        }
+        cur->attributes = class_new(c, attribute_info, cur->attributes_count);
+        read_attributes(c, names, cur->attributes, classbytes, offset,
+                cur->attributes_count, mode);
     }
 }
 
 /*
  * Read the method section of a Java class file
  */
-static void read_methods(JavaClass *c, guchar *classbytes,
-        guint32 *offset, GError **error)
+static ALWAYS_INLINE void read_methods(JavaClass *c, attribute_names *names,
+        guchar *classbytes, guint32 *offset, const parse_mode mode)
 {
     method_info *cur = NULL;
-    GError *suberror = NULL;
 
     for (int i = 0; i < c->methods_count; i++) {
         cur = &c->methods[i];
@@ -313,80 +462,200 @@ static void read_methods(JavaClass *c, guchar *classbytes,
         copy_bytes(&cur->attributes_count, classbytes, offset, 2);
         GUINT16_CONV(cur->attributes_count);
 
-        cur->attributes = g_new(attribute_info, cur->attributes_count);
-        read_attributes(c, cur->attributes, classbytes, offset,
-                cur->attributes_count, &suberror);
-
-        if (suberror != NULL) {
-            g_propagate_error(error, suberror);
-            return;
-        }
+        cur->attributes = class_new(c, attribute_info, cur->attributes_count);
+        read_attributes(c, names, cur->attributes, classbytes, offset,
+                cur->attributes_count, mode);
     }
 }
 
 /*
- * Extract the exceptions from the method attributes
+ * Extract the exceptions from an "Exceptions" attribute
  */
-static gchar** extract_exceptions(JavaClass *c, attribute_info* attributes,
-        guint16 count)
+static gchar** extract_exceptions(JavaClass *c, attribute_info *attribute)
 {
     gchar **exceptions = NULL;
+    guchar *info = attribute->info;
+    guint16 num_exceptions = 0;
+    guint16 curindex = 0;
+    guint32 offset = 0;
 
-    if (count <= 0) return NULL;
+    copy_bytes(&num_exceptions, info, &offset, 2);
+    GUINT16_CONV(num_exceptions);
 
-    // search for the exception attribute
-    for (int i = 0; i < count; i++) {
-        gchar *name = string_from_cp(c, attributes[i].attribute_name_index);
-        if (g_strcmp0("Exceptions", name) == 0) {
-            guchar *info = attributes[i].info;
-            guint16 num_exceptions = 0;
-            guint16 curindex = 0;
-            guint32 offset = 0;
+    if (num_exceptions <= 0) return NULL;
+
+    exceptions = class_new(c, gchar*, num_exceptions + 1);
+    exceptions[num_exceptions] = NULL; // NULL terminate array
 
-            copy_bytes(&num_exceptions, info, &offset, 2);
-            GUINT16_CONV(num_exceptions);
+    for (int i = 0; i < num_exceptions; i++) {
+        copy_bytes(&curindex, info, &offset, 2);
+        GUINT16_CONV(curindex);
+        curindex--;
 
-            if (num_exceptions <= 0) return NULL;
+        exceptions[i] = external_classname(c, curindex);
+    }
+
+    return exceptions;
+}
 
-            exceptions = g_new(gchar*, num_exceptions + 1);
-            exceptions[num_exceptions] = NULL; // NULL terminate array
+/*
+ * Return the string a "Signature" attribute refers to
+ */
+static gchar* signature_from_attribute(JavaClass *c, attribute_info *attribute)
+{
+    guint16 sig = 0;
 
-            for (int i = 0; i < num_exceptions; i++) {
-                copy_bytes(&curindex, info, &offset, 2);
-                GUINT16_CONV(curindex);
-                curindex--;
+    memcpy(&sig, attribute->info, 2);
+    GUINT16_CONV(sig);
+    sig--;
 
-                classname_to_external_format(classname_from_cp(c, curindex));
-                exceptions[i] = classname_from_cp(c, curindex);
-            }
+    return string_from_cp(c, sig);
+}
 
-            return exceptions;
+/*
+ * Create the JavaField object for a field of a class
+ */
+static JavaField* new_field(JavaClass *c, guint16 access_flags, gchar *name,
+        gchar *descriptor, gchar *signature)
+{
+    JavaField *field = NULL;
+
+    if (c->_arena == NULL)
+        return javafield_new(access_flags, name, descriptor, signature);
+
+    // the strings live in the arena as long as the field does, so there is
+    // no need to copy them
+    field = class_new(c, JavaField, 1);
+    field->access_flags = access_flags;
+    field->name = name;
+    field->descriptor = descriptor;
+    field->signature = signature;
+
+    return field;
+}
+
+/*
+ * Create the JavaMethod object for a method of a class
+ */
+static JavaMethod* new_method(JavaClass *c, guint16 access_flags, gchar *name,
+        gchar *descriptor, gchar *signature, gchar **exceptions,
+        guchar *code, guint32 codelen)
+{
+    JavaMethod *method = NULL;
+
+    if (c->_arena == NULL) {
+        method = javamethod_new(access_flags, (const gchar*) name,
+                (const gchar*) descriptor, (const gchar*) signature,
+                (const gchar**) exceptions);
+        g_strfreev(exceptions);
+
+        if (c->_bytes != NULL && code != NULL) {
+            const guchar *data = g_bytes_get_data(c->_bytes, NULL);
+            javamethod_set_code_view(method, c->_bytes, code - data, codelen);
+        } else {
+            javamethod_set_code(method, code, codelen);
         }
+
+        return method;
     }
 
-    return NULL;
+    // same as for fields: reference the data in the arena instead of copying
+    method = class_new(c, JavaMethod, 1);
+    method->access_flags = access_flags;
+    method->name = name;
+    method->descriptor = descriptor;
+    method->signature = signature;
+    method->exceptions = exceptions;
+    method->code = code;
+    method->codelen = code != NULL ? codelen : 0;
+    method->_codebuf = NULL;
+
+    return method;
 }
 
 JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecode, GError **error)
+{
+    return javaclass_new_full(NULL, NULL, classbytes, length,
+            includecode ? JAVACLASS_PARSE_CODE : 0, error);
+}
+
+JavaClass* javaclass_new_from_bytes(GBytes *bytes, guint flags, GError **error)
+{
+    gsize length = 0;
+    guchar *classbytes = (guchar*) g_bytes_get_data(bytes, &length);
+
+    if (!(flags & JAVACLASS_PARSE_BORROW_CODE)) bytes = NULL;
+
+    return javaclass_new_full(NULL, bytes, classbytes, length, flags, error);
+}
+
+JavaClass* javaclass_new_from_mapped_file(const gchar *filename, guint flags,
+        GError **error)
+{
+    GMappedFile *file = NULL;
+    GBytes *bytes = NULL;
+    JavaClass *retval = NULL;
+
+    file = g_mapped_file_new(filename, FALSE, error);
+    if (file == NULL) return NULL;
+
+    // the bytes keep the mapping alive as long as a method borrows from it
+    bytes = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+
+    retval = javaclass_new_from_bytes(bytes, flags, error);
+    g_bytes_unref(bytes);
+
+    return retval;
+}
+
+/*
+ * The parser, inlined into one function per parse mode
+ */
+static ALWAYS_INLINE JavaClass* parse_class(JavaArena *arena, GBytes *bytes,
+        guchar *classbytes, guint32 length, const parse_mode mode,
+        GError **error)
 {
     JavaClass *c = NULL;
     guint32 offset = 0;
     GError *suberror = NULL;
-    c = g_new(JavaClass, 1);
+    attribute_names names;
+
+    for (int i = 0; i < ATTRIBUTE_KIND_COUNT; i++) {
+        names.index[i] = INVALID_INDEX;
+    }
+
+    // borrowing needs a buffer that outlives the parser's arena
+    g_assert(arena == NULL || bytes == NULL);
+
+    if (arena != NULL) {
+        c = javaarena_alloc(arena, sizeof(JavaClass));
+    } else {
+        c = g_new(JavaClass, 1);
+    }
 
     // initialize all pointers in the JavaClass struct with NULL so that we
     // can tell which don't point to allocated memory in case of an error
-    c->constant_pool = NULL;
+    c->_arena        = arena;
+    c->_bytes        = bytes != NULL ? g_bytes_ref(bytes) : NULL;
+    c->cp_tags       = NULL;
+    c->cp_values     = NULL;
+    c->cp_strings    = NULL;
     c->interfaces    = NULL;
     c->fields        = NULL;
     c->methods       = NULL;
     c->attributes    = NULL;
+    c->_fq_name      = NULL;
+    c->_fq_parent    = NULL;
     c->_package      = NULL;
     c->_classname    = NULL;
     c->_interfaces   = NULL;
     c->_fields       = NULL;
     c->_methods      = NULL;
     c->_signature    = NULL;
+    c->_member_index = NULL;
+    c->_code_tables  = NULL;
+    c->_refcount     = 1;
 
     g_assert(sizeof(gfloat) == 4);
     g_assert(sizeof(gdouble) == 8);
@@ -429,7 +698,8 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
     c->constant_pool_count--;
 
     // allocate space for the constant pool
-    c->constant_pool = g_new(cp_info,  c->constant_pool_count);
+    c->cp_tags = class_new(c, guint8, c->constant_pool_count);
+    c->cp_values = class_new(c, cp_value, c->constant_pool_count);
 
     read_constant_pool(c, classbytes, &offset, &suberror);
 
@@ -447,7 +717,7 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
     copy_bytes(&c->this_class, classbytes, &offset, 2);
     GUINT16_CONV(c->this_class);
     c->this_class--;
-    classname_to_external_format(classname_from_cp(c, c->this_class));
+    c->_fq_name = external_classname(c, c->this_class);
 
     // read superclass index
     copy_bytes(&c->super_class, classbytes, &offset, 2);
@@ -455,7 +725,7 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
     c->super_class--;
     // Do we have a super class? java.lang.object doesn't have one!
     if (c->super_class != INVALID_INDEX) {
-        classname_to_external_format(classname_from_cp(c, c->super_class));
+        c->_fq_parent = external_classname(c, c->super_class);
     }
 
     // read the interfaces count
@@ -465,7 +735,7 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
     // read the interfaces list
     if (c->interfaces_count > 0) {
         guint16 len = c->interfaces_count * 2;
-        c->interfaces = g_new(guint16, len);
+        c->interfaces = class_new(c, guint16, c->interfaces_count);
         copy_bytes(c->interfaces, classbytes, &offset, len);
 
         for (int i = 0; i < c->interfaces_count; i++) {
@@ -474,57 +744,46 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
         }
     }
 
-    // read the fields count
-    copy_bytes(&c->fields_count, classbytes, &offset, 2);
-    GUINT16_CONV(c->fields_count);
-
-    // read the fields list
-    if (c->fields_count > 0) {
-        c->fields = g_new(field_info, c->fields_count);
-        read_fields(c, classbytes, &offset, &suberror);
-
-        if (suberror != NULL) {
-            g_propagate_error(error, suberror);
-            javaclass_free(c);
-            return NULL;
+    if (mode == PARSE_HIERARCHY) {
+        // the members and attributes are left out
+        c->fields_count = 0;
+        c->methods_count = 0;
+        c->attributes_count = 0;
+    } else {
+        // read the fields count
+        copy_bytes(&c->fields_count, classbytes, &offset, 2);
+        GUINT16_CONV(c->fields_count);
+
+        // read the fields list
+        if (c->fields_count > 0) {
+            c->fields = class_new(c, field_info, c->fields_count);
+            read_fields(c, &names, classbytes, &offset, mode);
         }
-    }
 
-    // read the methods count
-    copy_bytes(&c->methods_count, classbytes, &offset, 2);
-    GUINT16_CONV(c->methods_count);
+        // read the methods count
+        copy_bytes(&c->methods_count, classbytes, &offset, 2);
+        GUINT16_CONV(c->methods_count);
 
-    // read the methods list
-    if (c->methods_count > 0) {
-        c->methods = g_new(method_info, c->methods_count);
-        read_methods(c, classbytes, &offset, &suberror);
-
-        if (suberror != NULL) {
-            g_propagate_error(error, suberror);
-            javaclass_free(c);
-            return NULL;
+        // read the methods list
+        if (c->methods_count > 0) {
+            c->methods = class_new(c, method_info, c->methods_count);
+            read_methods(c, &names, classbytes, &offset, mode);
         }
-    }
 
-    // read the attributes count
-    copy_bytes(&c->attributes_count, classbytes, &offset, 2);
-    GUINT16_CONV(c->attributes_count);
+        // read the attributes count
+        copy_bytes(&c->attributes_count, classbytes, &offset, 2);
+        GUINT16_CONV(c->attributes_count);
 
-    // read the attributes list of the class
-    if (c->attributes_count > 0) {
-        c->attributes = g_new(attribute_info, c->attributes_count);
-        read_attributes(c, c->attributes, classbytes, &offset,
-                c->attributes_count, &suberror);
-
-        if (suberror != NULL) {
-            g_propagate_error(error, suberror);
-            javaclass_free(c);
-            return NULL;
+        // read the attributes list of the class
+        if (c->attributes_count > 0) {
+            c->attributes = class_new(c, attribute_info, c->attributes_count);
+            read_attributes(c, &names, c->attributes, classbytes, &offset,
+                    c->attributes_count, mode);
         }
-    }
 
-    // did we read to the end?
-    g_assert(offset == length);
+        // did we read to the end?
+        g_assert(offset == length);
+    }
 
     /*
      * Fill additional data structures that are returned by some of the getters
@@ -532,21 +791,35 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
      * more convenient access to information exposed by the getters
      */
 
-    c->_package = javaclass_extract_package(classname_from_cp(c, c->this_class));
-    c->_classname = javaclass_extract_classname(classname_from_cp(c, c->this_class));
+    {
+        gchar *pos = g_strrstr(c->_fq_name, ".");
+
+        // the classname is the tail of the fully qualified name, which is
+        // NULL for a trailing dot like in javaclass_extract_classname()
+        if (pos == NULL) {
+            c->_classname = c->_fq_name;
+        } else if (pos[1] != '\0') {
+            c->_classname = &pos[1];
+        }
+
+        if (pos != NULL) {
+            c->_package = class_new(c, gchar, pos - c->_fq_name + 1);
+            memcpy(c->_package, c->_fq_name, pos - c->_fq_name);
+            c->_package[pos - c->_fq_name] = '\0';
+        }
+    }
 
     if (c->interfaces_count > 0) {
-        c->_interfaces = g_new(gchar*, c->interfaces_count + 1);
+        c->_interfaces = class_new(c, gchar*, c->interfaces_count + 1);
         c->_interfaces[c->interfaces_count] = NULL; // NULL terminate the array
 
         for (int i = 0; i < c->interfaces_count; i++) {
-            classname_to_external_format(classname_from_cp(c, c->interfaces[i]));
-            c->_interfaces[i] = classname_from_cp(c, c->interfaces[i]);
+            c->_interfaces[i] = external_classname(c, c->interfaces[i]);
         }
     }
 
     if (c->fields_count > 0) {
-        c->_fields = g_new(JavaField*, c->fields_count + 1);
+        c->_fields = class_new(c, JavaField*, c->fields_count + 1);
         c->_fields[c->fields_count] = NULL; // NULL terminate the array
 
         for (int i = 0; i < c->fields_count; i++) {
@@ -557,26 +830,20 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
 
             // extract the "Signature" attribute if any
             for (int j = 0; j < c->fields[i].attributes_count; j++) {
-                guint16 name_index = 
-                    c->fields[i].attributes[j].attribute_name_index;
+                attribute_info *attr = &c->fields[i].attributes[j];
 
-                if (g_strcmp0("Signature", string_from_cp(c, name_index)) == 0) {
-                    guint16 sig = 0;
-                    memcpy(&sig, c->fields[i].attributes[j].info, 2);
-                    GUINT16_CONV(sig);
-                    sig--;
-
-                    signature = string_from_cp(c, sig);
+                if (attr->_kind == ATTRIBUTE_SIGNATURE) {
+                    signature = signature_from_attribute(c, attr);
                 }
             }
 
-            c->_fields[i] = javafield_new(access_flags, name,
+            c->_fields[i] = new_field(c, access_flags, name,
                     descriptor, signature);
         }
     }
 
     if (c->methods_count > 0) {
-        c->_methods = g_new(JavaMethod*, c->methods_count + 1);
+        c->_methods = class_new(c, JavaMethod*, c->methods_count + 1);
         c->_methods[c->methods_count] = NULL; // NULL terminate array
 
         for (int i = 0; i < c->methods_count; i++) {
@@ -585,59 +852,85 @@ JavaClass* javaclass_new(guchar *classbytes, guint32 length, gboolean includecod
             gchar *descriptor = string_from_cp(c, c->methods[i].descriptor_index);
             gchar *signature = NULL;
             gchar **exceptions = NULL;
-
-            exceptions = extract_exceptions(c, c->methods[i].attributes,
-                    c->methods[i].attributes_count);
             guint32 codelen = 0;
             guchar *code = NULL;
 
-            // extract the "Signature" attribute if any
+            // the kinds were determined while reading, so this is a switch
+            // instead of string comparisons
             for (int j = 0; j < c->methods[i].attributes_count; j++) {
-                guint16 name_index = 
-                    c->methods[i].attributes[j].attribute_name_index;
-
-                if (g_strcmp0("Signature", string_from_cp(c, name_index)) == 0) {
-                    guint16 sig = 0;
-                    memcpy(&sig, c->methods[i].attributes[j].info, 2);
-                    GUINT16_CONV(sig);
-                    sig--;
-
-                    signature = string_from_cp(c, sig);
-                } else if (includecode && g_strcmp0("Code", string_from_cp(c, name_index)) == 0) {
-                    // use pointer arithmetic to get the codelen and the
-                    // bytecode array from the "Code" attribute_info structure
-                    codelen = *((guint32*) (c->methods[i].attributes[j].info + 4));
-                    GUINT32_CONV(codelen);
-                    code = c->methods[i].attributes[j].info + 8;
+                attribute_info *attr = &c->methods[i].attributes[j];
+
+                switch (attr->_kind) {
+                    case ATTRIBUTE_SIGNATURE:
+                        signature = signature_from_attribute(c, attr);
+                        break;
+                    case ATTRIBUTE_EXCEPTIONS:
+                        exceptions = extract_exceptions(c, attr);
+                        break;
+                    case ATTRIBUTE_CODE:
+                        // use pointer arithmetic to get the codelen and the
+                        // bytecode array from the "Code" attribute_info
+                        // structure (borrowed attributes aren't aligned so
+                        // use memcpy)
+                        memcpy(&codelen, attr->info + 4, 4);
+                        GUINT32_CONV(codelen);
+                        code = attr->info + 8;
+                        break;
                 }
             }
 
-            c->_methods[i] = javamethod_new(access_flags, (const gchar*) name,
-                    (const gchar*) descriptor, (const gchar*) signature,
-                    (const gchar**) exceptions);
-            if (includecode) javamethod_set_code(c->_methods[i], code, codelen);
-
-            g_free(exceptions);
+            c->_methods[i] = new_method(c, access_flags, name, descriptor,
+                    signature, exceptions, code, codelen);
         }
     }
 
     // search the classes attributes
-    for (int i = 0; i < c->attributes_count; i++)
-    {
-        const guint16 name_index = c->attributes[i].attribute_name_index;
-        if (g_strcmp0("Signature", string_from_cp(c, name_index)) == 0) {
-            guint16 sig = 0;
-            memcpy(&sig, c->attributes[i].info, 2);
-            GUINT16_CONV(sig);
-            sig--;
-
-            c->_signature = string_from_cp(c, sig);
+    for (int i = 0; i < c->attributes_count; i++) {
+        if (c->attributes[i]._kind == ATTRIBUTE_SIGNATURE) {
+            c->_signature = signature_from_attribute(c, &c->attributes[i]);
         }
     }
 
     return c;
 }
 
+/*
+ * The specialized variants of the parser
+ */
+static JavaClass* parse_hierarchy(JavaArena *arena, GBytes *bytes,
+        guchar *classbytes, guint32 length, GError **error)
+{
+    return parse_class(arena, bytes, classbytes, length, PARSE_HIERARCHY,
+            error);
+}
+
+static JavaClass* parse_metadata(JavaArena *arena, GBytes *bytes,
+        guchar *classbytes, guint32 length, GError **error)
+{
+    return parse_class(arena, bytes, classbytes, length, PARSE_METADATA,
+            error);
+}
+
+static JavaClass* parse_code(JavaArena *arena, GBytes *bytes,
+        guchar *classbytes, guint32 length, GError **error)
+{
+    return parse_class(arena, bytes, classbytes, length, PARSE_CODE, error);
+}
+
+JavaClass* javaclass_new_full(JavaArena *arena, GBytes *bytes,
+        guchar *classbytes, guint32 length, guint flags, GError **error)
+{
+    if (flags & JAVACLASS_PARSE_HIERARCHY) {
+        return parse_hierarchy(arena, bytes, classbytes, length, error);
+    }
+
+    if (flags & (JAVACLASS_PARSE_CODE | JAVACLASS_PARSE_BORROW_CODE)) {
+        return parse_code(arena, bytes, classbytes, length, error);
+    }
+
+    return parse_metadata(arena, bytes, classbytes, length, error);
+}
+
 JavaClass* javaclass_new_from_file(gchar *filename, gboolean includecode, GError **error)
 {
     struct stat buffer;
@@ -684,14 +977,12 @@ const gchar* javaclass_get_package(JavaClass *c)
 
 const gchar* javaclass_get_fq_name(JavaClass *c)
 {
-    return classname_from_cp(c, c->this_class);
+    return c->_fq_name;
 }
 
 const gchar* javaclass_get_fq_parent(JavaClass *c)
 {
-    if (c->super_class == INVALID_INDEX) return NULL;
-
-    return classname_from_cp(c, c->super_class);
+    return c->_fq_parent;
 }
 
 guint16 javaclass_get_interface_number(JavaClass *c)
@@ -737,6 +1028,44 @@ guint16 javaclass_get_minor_version_number(JavaClass *c)
 const gchar* javaclass_get_version_name(JavaClass *c)
 {
     switch(c->major_version) {
+        case 69:
+            return "Java SE 25";
+        case 68:
+            return "Java SE 24";
+        case 67:
+            return "Java SE 23";
+        case 66:
+            return "Java SE 22";
+        case 65:
+            return "Java SE 21";
+        case 64:
+            return "Java SE 20";
+        case 63:
+            return "Java SE 19";
+        case 62:
+            return "Java SE 18";
+        case 61:
+            return "Java SE 17";
+        case 60:
+            return "Java SE 16";
+        case 59:
+            return "Java SE 15";
+        case 58:
+            return "Java SE 14";
+        case 57:
+            return "Java SE 13";
+        case 56:
+            return "Java SE 12";
+        case 55:
+            return "Java SE 11";
+        case 54:
+            return "Java SE 10";
+        case 53:
+            return "Java SE 9";
+        case 52:
+            return "Java SE 8";
+        case 51:
+            return "Java SE 7";
         case 50:
             return "J2SE 6.0";
         case 49:
@@ -789,6 +1118,715 @@ const gchar* javaclass_get_signature(JavaClass *c)
     return c->_signature;
 }
 
+/*
+ * Open addressing hash tables for looking up fields by name and methods by
+ * name and descriptor. Each slot holds the hash of the key and the index of
+ * the member + 1 (0 marks an empty slot).
+ */
+typedef struct _member_table
+{
+    guint32 mask;
+    guint32 *hashes;
+    guint16 *slots;
+} member_table;
+
+typedef struct _member_index
+{
+    member_table fields;
+    member_table methods;
+} member_index;
+
+/*
+ * FNV-1a hash of a member name and (optionally) its descriptor
+ */
+static guint32 hash_member(const gchar *name, const gchar *descriptor)
+{
+    guint32 hash = 2166136261U;
+
+    for (const guchar *p = (const guchar*) name; *p; p++) {
+        hash = (hash ^ *p) * 16777619U;
+    }
+
+    if (descriptor != NULL) {
+        hash = (hash ^ '(') * 16777619U;
+
+        for (const guchar *p = (const guchar*) descriptor; *p; p++) {
+            hash = (hash ^ *p) * 16777619U;
+        }
+    }
+
+    return hash;
+}
+
+/*
+ * Allocate the slots of a table with room for count members
+ */
+static void member_table_init(JavaClass *c, member_table *table, guint16 count)
+{
+    guint32 size = 4;
+
+    // keep the load factor at or below 50%
+    while (size < (guint32) count * 2) size *= 2;
+
+    table->mask = size - 1;
+    table->hashes = class_new(c, guint32, size);
+    table->slots = class_new(c, guint16, size);
+    memset(table->slots, 0, size * sizeof(guint16));
+}
+
+static void member_table_insert(member_table *table, guint32 hash,
+        guint16 member)
+{
+    guint32 pos = hash & table->mask;
+
+    while (table->slots[pos] != 0) pos = (pos + 1) & table->mask;
+
+    table->hashes[pos] = hash;
+    table->slots[pos] = member + 1;
+}
+
+static member_index* build_member_index(JavaClass *c)
+{
+    member_index *index = class_new(c, member_index, 1);
+
+    member_table_init(c, &index->fields, c->fields_count);
+    for (int i = 0; i < c->fields_count; i++) {
+        gchar *name = string_from_cp(c, c->fields[i].name_index);
+        member_table_insert(&index->fields, hash_member(name, NULL), i);
+    }
+
+    member_table_init(c, &index->methods, c->methods_count);
+    for (int i = 0; i < c->methods_count; i++) {
+        gchar *name = string_from_cp(c, c->methods[i].name_index);
+        gchar *descriptor = string_from_cp(c, c->methods[i].descriptor_index);
+        member_table_insert(&index->methods, hash_member(name, descriptor), i);
+    }
+
+    return index;
+}
+
+/*
+ * Return the member index of a class, building it on first use
+ */
+static member_index* get_member_index(JavaClass *c)
+{
+    if (g_once_init_enter(&c->_member_index)) {
+        g_once_init_leave(&c->_member_index, build_member_index(c));
+    }
+
+    return c->_member_index;
+}
+
+JavaField* javaclass_find_field(JavaClass *c, const gchar *name)
+{
+    member_table *table = NULL;
+    guint32 hash = 0;
+    guint32 pos = 0;
+
+    g_return_val_if_fail(name != NULL, NULL);
+
+    if (c->fields_count == 0) return NULL;
+
+    table = &get_member_index(c)->fields;
+    hash = hash_member(name, NULL);
+
+    for (pos = hash & table->mask; table->slots[pos] != 0;
+            pos = (pos + 1) & table->mask) {
+        guint16 i = table->slots[pos] - 1;
+
+        if (table->hashes[pos] == hash &&
+                strcmp(name, string_from_cp(c, c->fields[i].name_index)) == 0)
+            return c->_fields[i];
+    }
+
+    return NULL;
+}
+
+JavaMethod* javaclass_find_method(JavaClass *c, const gchar *name,
+        const gchar *descriptor)
+{
+    member_table *table = NULL;
+    guint32 hash = 0;
+    guint32 pos = 0;
+
+    g_return_val_if_fail(name != NULL && descriptor != NULL, NULL);
+
+    if (c->methods_count == 0) return NULL;
+
+    table = &get_member_index(c)->methods;
+    hash = hash_member(name, descriptor);
+
+    for (pos = hash & table->mask; table->slots[pos] != 0;
+            pos = (pos + 1) & table->mask) {
+        guint16 i = table->slots[pos] - 1;
+
+        if (table->hashes[pos] == hash &&
+                strcmp(name, string_from_cp(c, c->methods[i].name_index)) == 0 &&
+                strcmp(descriptor, string_from_cp(c,
+                        c->methods[i].descriptor_index)) == 0)
+            return c->_methods[i];
+    }
+
+    return NULL;
+}
+
+/*
+ * The decoded tables of the "Code" attribute of a method
+ */
+typedef struct _code_tables
+{
+    guint n_handlers;
+    guint n_lines;
+    guint n_locals;
+    JavaExceptionHandler *handlers;
+    JavaLineNumber *lines;
+    JavaLocalVariable *locals;
+} code_tables;
+
+// shared by all methods without any of the tables
+static code_tables no_code_tables;
+
+static guint16 read_u16(const guchar *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static guint32 read_u32(const guchar *p)
+{
+    return ((guint32) p[0] << 24) | ((guint32) p[1] << 16) |
+        ((guint32) p[2] << 8) | (guint32) p[3];
+}
+
+/*
+ * Is i (as stored in the class file) a valid index to a constant of tag?
+ */
+static gboolean is_cp_index(JavaClass *c, guint16 i, guint8 tag)
+{
+    return i > 0 && i <= c->constant_pool_count && c->cp_tags[i - 1] == tag;
+}
+
+/*
+ * Decode the entries of the nested attribute called name, if entries is
+ * NULL only count them. Each entry is size bytes long.
+ */
+static guint decode_nested_tables(JavaClass *c, const guchar *p,
+        guint32 length, guint32 offset, const gchar *name, guint32 size,
+        gpointer entries)
+{
+    guint16 count = 0;
+    guint n = 0;
+
+    if (length - offset < 2) return 0;
+    count = read_u16(p + offset);
+    offset += 2;
+
+    for (guint16 i = 0; i < count && length - offset >= 6; i++) {
+        guint16 name_index = read_u16(p + offset);
+        guint32 attribute_length = read_u32(p + offset + 2);
+        guint16 table_length = 0;
+        const guchar *table = p + offset + 8;
+
+        offset += 6;
+        if (attribute_length > length - offset) break;
+
+        if (attribute_length < 2 || !is_cp_index(c, name_index, TAG_UTF8) ||
+                strcmp(string_from_cp(c, name_index - 1), name) != 0) {
+            offset += attribute_length;
+            continue;
+        }
+
+        table_length = read_u16(p + offset);
+        offset += attribute_length;
+        if ((guint32) table_length * size > attribute_length - 2) continue;
+
+        for (guint16 j = 0; j < table_length; j++, table += size) {
+            if (entries == NULL) {
+                n++;
+            } else if (size == 4) {
+                JavaLineNumber *line = &((JavaLineNumber*) entries)[n++];
+
+                line->start_pc = read_u16(table);
+                line->line_number = read_u16(table + 2);
+            } else {
+                JavaLocalVariable *local = &((JavaLocalVariable*) entries)[n];
+                guint16 name_index = read_u16(table + 4);
+                guint16 descriptor_index = read_u16(table + 6);
+
+                if (!is_cp_index(c, name_index, TAG_UTF8) ||
+                        !is_cp_index(c, descriptor_index, TAG_UTF8))
+                    continue;
+
+                local->start_pc = read_u16(table);
+                local->length = read_u16(table + 2);
+                local->name = string_from_cp(c, name_index - 1);
+                local->descriptor = string_from_cp(c, descriptor_index - 1);
+                local->index = read_u16(table + 8);
+                n++;
+            }
+        }
+    }
+
+    return n;
+}
+
+/*
+ * Decode the tables of the "Code" attribute of method i
+ *
+ * The bytes of the attribute weren't checked when the class was parsed, so
+ * anything that doesn't fit into the attribute ends the decoding.
+ */
+static code_tables* decode_code_tables(JavaClass *c, guint16 i)
+{
+    attribute_info *code = NULL;
+    code_tables *tables = NULL;
+    const guchar *p = NULL;
+    guint32 length = 0;
+    guint32 offset = 0;
+    guint16 n_handlers = 0;
+
+    for (int j = 0; j < c->methods[i].attributes_count; j++) {
+        if (c->methods[i].attributes[j]._kind == ATTRIBUTE_CODE) {
+            code = &c->methods[i].attributes[j];
+        }
+    }
+
+    if (code == NULL || code->info == NULL || code->attribute_length < 12) {
+        return &no_code_tables;
+    }
+
+    p = code->info;
+    length = code->attribute_length;
+    offset = read_u32(p + 4);
+    if (offset > length - 12) return &no_code_tables;
+    offset += 8;
+
+    n_handlers = read_u16(p + offset);
+    offset += 2;
+    if ((guint32) n_handlers * 8 > length - offset - 2) {
+        return &no_code_tables;
+    }
+
+    tables = class_new(c, code_tables, 1);
+    memset(tables, 0, sizeof(code_tables));
+
+    if (n_handlers > 0) {
+        tables->handlers = class_new(c, JavaExceptionHandler, n_handlers);
+    }
+
+    for (guint16 j = 0; j < n_handlers; j++, offset += 8) {
+        JavaExceptionHandler *handler = &tables->handlers[j];
+        guint16 catch_type = read_u16(p + offset + 6);
+
+        handler->start_pc = read_u16(p + offset);
+        handler->end_pc = read_u16(p + offset + 2);
+        handler->handler_pc = read_u16(p + offset + 4);
+        handler->catch_type = is_cp_index(c, catch_type, TAG_CLASS) ?
+            external_classname(c, catch_type - 1) : NULL;
+    }
+
+    tables->n_handlers = n_handlers;
+
+    // count the entries first so that each table is a single allocation
+    tables->n_lines = decode_nested_tables(c, p, length, offset,
+            "LineNumberTable", 4, NULL);
+    tables->n_locals = decode_nested_tables(c, p, length, offset,
+            "LocalVariableTable", 10, NULL);
+
+    if (tables->n_lines > 0) {
+        tables->lines = class_new(c, JavaLineNumber, tables->n_lines);
+        decode_nested_tables(c, p, length, offset, "LineNumberTable", 4,
+                tables->lines);
+
+        // there may be several tables in any order, the entries are
+        // usually sorted already
+        for (guint j = 1; j < tables->n_lines; j++) {
+            JavaLineNumber line = tables->lines[j];
+            guint k = j;
+
+            while (k > 0 && tables->lines[k - 1].start_pc > line.start_pc) {
+                tables->lines[k] = tables->lines[k - 1];
+                k--;
+            }
+
+            tables->lines[k] = line;
+        }
+    }
+
+    if (tables->n_locals > 0) {
+        tables->locals = class_new(c, JavaLocalVariable, tables->n_locals);
+        tables->n_locals = decode_nested_tables(c, p, length, offset,
+                "LocalVariableTable", 10, tables->locals);
+    }
+
+    return tables;
+}
+
+/*
+ * Find the position of a field or method in the array of a class (or -1)
+ */
+static gint find_member(gpointer *members, guint16 count, gconstpointer member)
+{
+    for (gint i = 0; i < count; i++) {
+        if (members[i] == member) return i;
+    }
+
+    return -1;
+}
+
+/*
+ * Return the tables of a method of the class, decoding them on first use
+ */
+static code_tables* get_code_tables(JavaClass *c, JavaMethod *method)
+{
+    gpointer *slots = NULL;
+    gint i = find_member((gpointer*) c->_methods, c->methods_count, method);
+
+    g_return_val_if_fail(i >= 0, &no_code_tables);
+
+    if (g_once_init_enter(&c->_code_tables)) {
+        slots = class_new(c, gpointer, c->methods_count);
+        memset(slots, 0, c->methods_count * sizeof(gpointer));
+        g_once_init_leave(&c->_code_tables, slots);
+    }
+
+    slots = c->_code_tables;
+
+    if (g_once_init_enter(&slots[i])) {
+        g_once_init_leave(&slots[i], decode_code_tables(c, i));
+    }
+
+    return slots[i];
+}
+
+const JavaExceptionHandler* javaclass_get_exception_handlers(JavaClass *c,
+        JavaMethod *method, guint *count)
+{
+    code_tables *tables = get_code_tables(c, method);
+
+    *count = tables->n_handlers;
+    return tables->handlers;
+}
+
+const JavaLineNumber* javaclass_get_line_numbers(JavaClass *c,
+        JavaMethod *method, guint *count)
+{
+    code_tables *tables = get_code_tables(c, method);
+
+    *count = tables->n_lines;
+    return tables->lines;
+}
+
+const JavaLocalVariable* javaclass_get_local_variables(JavaClass *c,
+        JavaMethod *method, guint *count)
+{
+    code_tables *tables = get_code_tables(c, method);
+
+    *count = tables->n_locals;
+    return tables->locals;
+}
+
+gint javaclass_get_line_number(JavaClass *c, JavaMethod *method, guint32 pc)
+{
+    code_tables *tables = get_code_tables(c, method);
+    guint low = 0;
+    guint high = tables->n_lines;
+
+    // find the last entry that starts at or before pc
+    while (low < high) {
+        guint mid = low + (high - low) / 2;
+
+        if (tables->lines[mid].start_pc <= pc) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low > 0 ? tables->lines[low - 1].line_number : -1;
+}
+
+static gboolean skip_annotation(const guchar *p, guint32 length,
+        guint32 *offset, guint depth);
+
+/*
+ * Skip the element_value of an annotation at offset, returns FALSE if it
+ * doesn't fit into the attribute
+ */
+static gboolean skip_element_value(const guchar *p, guint32 length,
+        guint32 *offset, guint depth)
+{
+    guint16 count = 0;
+
+    if (depth > 64 || length - *offset < 1) return FALSE;
+
+    switch (p[(*offset)++]) {
+        case 'B': case 'C': case 'D': case 'F': case 'I': case 'J':
+        case 'S': case 'Z': case 's': case 'c':
+            if (length - *offset < 2) return FALSE;
+            *offset += 2;
+            return TRUE;
+        case 'e':
+            if (length - *offset < 4) return FALSE;
+            *offset += 4;
+            return TRUE;
+        case '@':
+            return skip_annotation(p, length, offset, depth + 1);
+        case '[':
+            if (length - *offset < 2) return FALSE;
+            count = read_u16(p + *offset);
+            *offset += 2;
+
+            for (guint16 i = 0; i < count; i++) {
+                if (!skip_element_value(p, length, offset, depth + 1))
+                    return FALSE;
+            }
+
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/*
+ * Skip an annotation at offset, returns FALSE if it doesn't fit into the
+ * attribute
+ */
+static gboolean skip_annotation(const guchar *p, guint32 length,
+        guint32 *offset, guint depth)
+{
+    guint16 count = 0;
+
+    if (length - *offset < 4) return FALSE;
+    count = read_u16(p + *offset + 2);
+    *offset += 4;
+
+    for (guint16 i = 0; i < count; i++) {
+        if (length - *offset < 2) return FALSE;
+        *offset += 2;
+
+        if (!skip_element_value(p, length, offset, depth)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Get the type descriptors of the visible and invisible annotations in an
+ * attribute table
+ */
+static const gchar** collect_annotations(JavaClass *c,
+        attribute_info *attributes, guint16 attributes_count)
+{
+    GPtrArray *result = NULL;
+
+    for (int i = 0; i < attributes_count; i++) {
+        attribute_info *attr = &attributes[i];
+        guint32 offset = 2;
+        guint16 count = 0;
+
+        if (attr->info == NULL || attr->attribute_length < 2) continue;
+        if (attr->_kind != ATTRIBUTE_VISIBLE_ANNOTATIONS &&
+                attr->_kind != ATTRIBUTE_INVISIBLE_ANNOTATIONS)
+            continue;
+
+        count = read_u16(attr->info);
+
+        for (guint16 j = 0; j < count; j++) {
+            guint16 type = 0;
+
+            if (attr->attribute_length - offset < 4) break;
+            type = read_u16(attr->info + offset);
+
+            if (!is_cp_index(c, type, TAG_UTF8)) break;
+
+            if (result == NULL) result = g_ptr_array_new();
+            g_ptr_array_add(result, string_from_cp(c, type - 1));
+
+            if (!skip_annotation(attr->info, attr->attribute_length, &offset,
+                        0))
+                break;
+        }
+    }
+
+    if (result == NULL) return NULL;
+
+    g_ptr_array_add(result, NULL);
+
+    return (const gchar**) g_ptr_array_free(result, FALSE);
+}
+
+const gchar** javaclass_get_annotations(JavaClass *c)
+{
+    return collect_annotations(c, c->attributes, c->attributes_count);
+}
+
+const gchar** javaclass_get_field_annotations(JavaClass *c, JavaField *field)
+{
+    gint i = find_member((gpointer*) c->_fields, c->fields_count, field);
+
+    g_return_val_if_fail(i >= 0, NULL);
+
+    return collect_annotations(c, c->fields[i].attributes,
+            c->fields[i].attributes_count);
+}
+
+const gchar** javaclass_get_method_annotations(JavaClass *c,
+        JavaMethod *method)
+{
+    gint i = find_member((gpointer*) c->_methods, c->methods_count, method);
+
+    g_return_val_if_fail(i >= 0, NULL);
+
+    return collect_annotations(c, c->methods[i].attributes,
+            c->methods[i].attributes_count);
+}
+
+/*
+ * Bytes used by a string or 0 for NULL
+ */
+static gsize string_size(const gchar *str)
+{
+    return str != NULL ? strlen(str) + 1 : 0;
+}
+
+/*
+ * Bytes used by the attribute table and the retained payloads of an
+ * attribute section
+ */
+static void attributes_size(JavaClass *c, attribute_info *attributes,
+        guint16 count, JavaClassMemoryUsage *u)
+{
+    u->members += count * sizeof(attribute_info);
+
+    // borrowed payloads belong to the class buffer
+    if (c->_bytes != NULL) return;
+
+    for (int i = 0; i < count; i++) {
+        if (attributes[i].info != NULL)
+            u->attributes += attributes[i].attribute_length;
+    }
+}
+
+gsize javaclass_get_memory_usage(JavaClass *c, JavaClassMemoryUsage *usage)
+{
+    JavaClassMemoryUsage u;
+    member_index *index = g_atomic_pointer_get(&c->_member_index);
+    code_tables **tables = g_atomic_pointer_get(&c->_code_tables);
+    // objects of parser classes reference the strings and bytecode of the
+    // class instead of owning copies
+    gboolean copies = c->_arena == NULL;
+
+    memset(&u, 0, sizeof(u));
+
+    u.object = sizeof(JavaClass);
+    u.constant_pool = c->constant_pool_count *
+        (sizeof(guint8) + sizeof(cp_value));
+    u.strings = c->cp_strings_size;
+
+    u.members = c->interfaces_count * sizeof(guint16) +
+        c->fields_count * sizeof(field_info) +
+        c->methods_count * sizeof(method_info);
+
+    for (int i = 0; i < c->fields_count; i++) {
+        attributes_size(c, c->fields[i].attributes,
+                c->fields[i].attributes_count, &u);
+    }
+
+    for (int i = 0; i < c->methods_count; i++) {
+        attributes_size(c, c->methods[i].attributes,
+                c->methods[i].attributes_count, &u);
+    }
+
+    attributes_size(c, c->attributes, c->attributes_count, &u);
+
+    u.names = string_size(c->_fq_name) + string_size(c->_fq_parent) +
+        string_size(c->_package);
+
+    if (c->_interfaces != NULL) {
+        u.names += (c->interfaces_count + 1) * sizeof(gchar*);
+        for (int i = 0; c->_interfaces[i]; i++) {
+            u.names += string_size(c->_interfaces[i]);
+        }
+    }
+
+    if (c->_fields != NULL) {
+        u.fields = (c->fields_count + 1) * sizeof(JavaField*);
+
+        for (int i = 0; c->_fields[i]; i++) {
+            JavaField *field = c->_fields[i];
+
+            u.fields += sizeof(JavaField);
+            if (copies) {
+                u.fields += string_size(field->name) +
+                    string_size(field->descriptor) +
+                    string_size(field->signature);
+            }
+        }
+    }
+
+    if (c->_methods != NULL) {
+        u.methods = (c->methods_count + 1) * sizeof(JavaMethod*);
+
+        for (int i = 0; c->_methods[i]; i++) {
+            JavaMethod *method = c->_methods[i];
+
+            u.methods += sizeof(JavaMethod);
+            if (copies) {
+                u.methods += string_size(method->name) +
+                    string_size(method->descriptor) +
+                    string_size(method->signature);
+            }
+
+            if (method->exceptions != NULL) {
+                int j = 0;
+                for (j = 0; method->exceptions[j]; j++) {
+                    u.methods += string_size(method->exceptions[j]);
+                }
+                u.methods += (j + 1) * sizeof(gchar*);
+            }
+
+            if (method->_codebuf != NULL) {
+                u.borrowed_code += method->codelen;
+            } else if (copies) {
+                u.code += method->codelen;
+            }
+        }
+    }
+
+    if (index != NULL) {
+        u.index = sizeof(member_index) +
+            (index->fields.mask + 1) * (sizeof(guint32) + sizeof(guint16)) +
+            (index->methods.mask + 1) * (sizeof(guint32) + sizeof(guint16));
+    }
+
+    if (tables != NULL) {
+        u.code_tables = c->methods_count * sizeof(gpointer);
+
+        for (int i = 0; i < c->methods_count; i++) {
+            code_tables *t = g_atomic_pointer_get(&tables[i]);
+
+            if (t == NULL || t == &no_code_tables) continue;
+
+            u.code_tables += sizeof(code_tables) +
+                t->n_handlers * sizeof(JavaExceptionHandler) +
+                t->n_lines * sizeof(JavaLineNumber) +
+                t->n_locals * sizeof(JavaLocalVariable);
+
+            for (guint j = 0; j < t->n_handlers; j++) {
+                u.code_tables += string_size(t->handlers[j].catch_type);
+            }
+        }
+    }
+
+    u.total = u.object + u.constant_pool + u.strings + u.members +
+        u.attributes + u.code + u.names + u.fields + u.methods + u.index +
+        u.code_tables;
+
+    if (usage != NULL) *usage = u;
+
+    return u.total;
+}
+
 gchar* javaclass_extract_classname(const gchar *fqn)
 {
     if (fqn == NULL) return NULL;
@@ -812,23 +1850,29 @@ gchar* javaclass_extract_package(const gchar *fqn)
     return g_strndup(fqn, pos - fqn);
 }
 
-void javaclass_free(JavaClass *c)
+JavaClass* javaclass_ref(JavaClass *c)
 {
-    if (c != NULL) {
-        if (c->constant_pool != NULL) {
-            for (int i = 0; i < c->constant_pool_count; i++) {
-                if (c->constant_pool[i].tag == TAG_UTF8)
-                    g_free(c->constant_pool[i].value.str);
-            }
-        }
+    // classes of a JavaClassParser live as long as the parser's arena
+    if (c->_arena == NULL) g_atomic_int_inc(&c->_refcount);
+
+    return c;
+}
 
-        g_free(c->constant_pool);
+void javaclass_unref(JavaClass *c)
+{
+    // classes of a JavaClassParser are released with the parser's arena
+    if (c != NULL && c->_arena == NULL &&
+            g_atomic_int_dec_and_test(&c->_refcount)) {
+        g_free(c->cp_tags);
+        g_free(c->cp_values);
+        g_free(c->cp_strings);
         g_free(c->interfaces);
 
         if (c->fields != NULL) {
             for (int i = 0; i < c->fields_count; i++) {
                 for (int j = 0; j < c->fields[i].attributes_count; j++) {
-                    g_free(c->fields[i].attributes[j].info);
+                    if (c->_bytes == NULL)
+                        g_free(c->fields[i].attributes[j].info);
                 }
 
                 g_free(c->fields[i].attributes);
@@ -841,7 +1885,8 @@ void javaclass_free(JavaClass *c)
             for (int i = 0; i < c->methods_count; i++) {
                 for (int j = 0; j < c->methods[i].attributes_count; j++)
                 {
-                    g_free(c->methods[i].attributes[j].info);
+                    if (c->_bytes == NULL)
+                        g_free(c->methods[i].attributes[j].info);
                 }
 
                 g_free(c->methods[i].attributes);
@@ -852,7 +1897,8 @@ void javaclass_free(JavaClass *c)
 
         if (c->attributes != NULL) {
             for (int i = 0; i < c->attributes_count; i++) {
-                g_free(c->attributes[i].info);
+                if (c->_bytes == NULL)
+                    g_free(c->attributes[i].info);
             }
         }
 
@@ -873,9 +1919,46 @@ void javaclass_free(JavaClass *c)
         }
 
         g_free(c->attributes);
+        g_free(c->_fq_name);
+        g_free(c->_fq_parent);
         g_free(c->_package);
-        g_free(c->_classname);
-        g_free(c->_interfaces);
+        g_strfreev(c->_interfaces);
+
+        if (c->_member_index != NULL) {
+            member_index *index = c->_member_index;
+            g_free(index->fields.hashes);
+            g_free(index->fields.slots);
+            g_free(index->methods.hashes);
+            g_free(index->methods.slots);
+            g_free(index);
+        }
+
+        if (c->_code_tables != NULL) {
+            code_tables **slots = c->_code_tables;
+
+            for (int i = 0; i < c->methods_count; i++) {
+                if (slots[i] == NULL || slots[i] == &no_code_tables) continue;
+
+                for (guint j = 0; j < slots[i]->n_handlers; j++) {
+                    g_free((gchar*) slots[i]->handlers[j].catch_type);
+                }
+
+                g_free(slots[i]->handlers);
+                g_free(slots[i]->lines);
+                g_free(slots[i]->locals);
+                g_free(slots[i]);
+            }
+
+            g_free(slots);
+        }
+
+        if (c->_bytes != NULL) g_bytes_unref(c->_bytes);
+
         g_free(c);
     }
 }
+
+void javaclass_free(JavaClass *c)
+{
+    javaclass_unref(c);
+}
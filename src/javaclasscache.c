@@ -0,0 +1,396 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javaclasscache.h"
+#include "javaprivate.h"
+
+#define HASH_SEED 0x43414348
+
+// share of the budget for the window and of the main area for protected
+#define WINDOW_PERCENT 1
+#define PROTECTED_PERCENT 80
+
+// the frequency sketch has a row of counters for each of its hashes and
+// about one counter per class that fits into the budget
+#define SKETCH_DEPTH 4
+#define SKETCH_MIN_WIDTH 1024
+#define TYPICAL_CLASS_SIZE 4096
+#define MAX_FREQUENCY 15
+
+enum
+{
+    REGION_WINDOW,      // recently added classes
+    REGION_PROBATION,   // admitted but not used again since
+    REGION_PROTECTED,   // used again while in probation
+    REGION_COUNT
+};
+
+typedef struct _cache_entry
+{
+    GList link;         // in the queue of its region, data is the entry
+    gchar *key;
+    guint64 hash;
+    JavaClass *c;
+    gsize size;
+    guint8 region;
+} cache_entry;
+
+struct _JavaClassCache
+{
+    GMutex lock;
+    GHashTable *entries;              // key -> cache_entry
+    GQueue regions[REGION_COUNT];     // most recently used first
+    gsize sizes[REGION_COUNT];
+    gsize window_budget;
+    gsize main_budget;
+    gsize protected_budget;
+
+    guint8 *sketch;                   // SKETCH_DEPTH rows of counters
+    guint32 sketch_mask;
+    guint32 additions;                // since the counters were last halved
+    guint32 sample_size;
+
+    JavaClassCacheStats stats;
+};
+
+JavaClassCache* javaclasscache_new(gsize budget)
+{
+    JavaClassCache *cache = g_new0(JavaClassCache, 1);
+    guint32 width = SKETCH_MIN_WIDTH;
+
+    g_mutex_init(&cache->lock);
+    cache->entries = g_hash_table_new(g_str_hash, g_str_equal);
+
+    for (int i = 0; i < REGION_COUNT; i++) g_queue_init(&cache->regions[i]);
+
+    cache->window_budget = budget / 100 * WINDOW_PERCENT;
+    cache->main_budget = budget - cache->window_budget;
+    cache->protected_budget = cache->main_budget / 100 * PROTECTED_PERCENT;
+
+    while (width < budget / TYPICAL_CLASS_SIZE && width < (1U << 24)) {
+        width *= 2;
+    }
+
+    cache->sketch = g_new0(guint8, (gsize) width * SKETCH_DEPTH);
+    cache->sketch_mask = width - 1;
+    cache->sample_size = width * 10;
+
+    return cache;
+}
+
+/*
+ * Frequency sketch: a count-min sketch of small counters that are all halved
+ * after sample_size additions, so the counts follow changes in popularity
+ */
+
+static guint32 sketch_slot(JavaClassCache *cache, guint64 hash, int row)
+{
+    guint32 low = (guint32) hash;
+    guint32 high = (guint32) (hash >> 32) | 1;
+
+    return row * (cache->sketch_mask + 1) +
+        ((low + row * high) & cache->sketch_mask);
+}
+
+static void sketch_increment(JavaClassCache *cache, guint64 hash)
+{
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        guint8 *counter = &cache->sketch[sketch_slot(cache, hash, row)];
+        if (*counter < MAX_FREQUENCY) (*counter)++;
+    }
+
+    if (++cache->additions >= cache->sample_size) {
+        gsize n = (gsize) (cache->sketch_mask + 1) * SKETCH_DEPTH;
+
+        for (gsize i = 0; i < n; i++) cache->sketch[i] >>= 1;
+        cache->additions /= 2;
+    }
+}
+
+static guint8 sketch_frequency(JavaClassCache *cache, guint64 hash)
+{
+    guint8 frequency = MAX_FREQUENCY;
+
+    for (int row = 0; row < SKETCH_DEPTH; row++) {
+        frequency = MIN(frequency,
+                cache->sketch[sketch_slot(cache, hash, row)]);
+    }
+
+    return frequency;
+}
+
+/*
+ * Regions
+ */
+
+static void region_push(JavaClassCache *cache, cache_entry *entry,
+        guint8 region)
+{
+    entry->region = region;
+    g_queue_push_head_link(&cache->regions[region], &entry->link);
+    cache->sizes[region] += entry->size;
+}
+
+static void region_unlink(JavaClassCache *cache, cache_entry *entry)
+{
+    g_queue_unlink(&cache->regions[entry->region], &entry->link);
+    cache->sizes[entry->region] -= entry->size;
+}
+
+/*
+ * Take an entry out of the cache, its class is added to released so that
+ * the reference is dropped after the lock is released
+ */
+static void drop_entry(JavaClassCache *cache, cache_entry *entry,
+        GPtrArray *released)
+{
+    region_unlink(cache, entry);
+    g_hash_table_remove(cache->entries, entry->key);
+    g_ptr_array_add(released, entry->c);
+    g_free(entry->key);
+    g_free(entry);
+}
+
+static void release_classes(GPtrArray *released)
+{
+    for (guint i = 0; i < released->len; i++) {
+        javaclass_unref(g_ptr_array_index(released, i));
+    }
+
+    g_ptr_array_free(released, TRUE);
+}
+
+/*
+ * A class was used again
+ */
+static void touch_entry(JavaClassCache *cache, cache_entry *entry)
+{
+    region_unlink(cache, entry);
+
+    if (entry->region == REGION_WINDOW) {
+        region_push(cache, entry, REGION_WINDOW);
+        return;
+    }
+
+    region_push(cache, entry, REGION_PROTECTED);
+
+    // demote the least recently used protected classes
+    while (cache->sizes[REGION_PROTECTED] > cache->protected_budget) {
+        cache_entry *tail = g_queue_peek_tail(&cache->regions[REGION_PROTECTED]);
+
+        if (tail == entry) break;
+
+        region_unlink(cache, tail);
+        region_push(cache, tail, REGION_PROBATION);
+    }
+}
+
+/*
+ * Move a class from the window into the main area if it is used more often
+ * than the classes it pushes out, otherwise drop it
+ */
+static void admit_entry(JavaClassCache *cache, cache_entry *candidate,
+        GPtrArray *released)
+{
+    guint8 frequency = sketch_frequency(cache, candidate->hash);
+    gsize used = cache->sizes[REGION_PROBATION] +
+        cache->sizes[REGION_PROTECTED];
+    gsize freed = 0;
+    GList *victim = NULL;
+
+    region_unlink(cache, candidate);
+
+    // check all the victims before any of them is evicted, least recently
+    // used of probation first and then of protected
+    for (int region = REGION_PROBATION; region <= REGION_PROTECTED; region++) {
+        for (victim = cache->regions[region].tail;
+                victim != NULL && used - freed + candidate->size >
+                cache->main_budget; victim = victim->prev) {
+            cache_entry *entry = victim->data;
+
+            if (sketch_frequency(cache, entry->hash) >= frequency) {
+                region_push(cache, candidate, REGION_WINDOW);
+                drop_entry(cache, candidate, released);
+                cache->stats.rejections++;
+                return;
+            }
+
+            freed += entry->size;
+        }
+    }
+
+    while (used + candidate->size > cache->main_budget) {
+        GQueue *queue = cache->regions[REGION_PROBATION].length > 0 ?
+            &cache->regions[REGION_PROBATION] :
+            &cache->regions[REGION_PROTECTED];
+        cache_entry *entry = g_queue_peek_tail(queue);
+
+        used -= entry->size;
+        drop_entry(cache, entry, released);
+        cache->stats.evictions++;
+    }
+
+    region_push(cache, candidate, REGION_PROBATION);
+}
+
+JavaClass* javaclasscache_lookup(JavaClassCache *cache, const gchar *key)
+{
+    guint64 hash = javahash_bytes(key, strlen(key), HASH_SEED);
+    cache_entry *entry = NULL;
+    JavaClass *c = NULL;
+
+    g_mutex_lock(&cache->lock);
+
+    sketch_increment(cache, hash);
+    entry = g_hash_table_lookup(cache->entries, key);
+
+    if (entry != NULL) {
+        cache->stats.hits++;
+        touch_entry(cache, entry);
+        c = javaclass_ref(entry->c);
+    } else {
+        cache->stats.misses++;
+    }
+
+    g_mutex_unlock(&cache->lock);
+
+    return c;
+}
+
+void javaclasscache_insert(JavaClassCache *cache, const gchar *key,
+        JavaClass *c)
+{
+    GPtrArray *released = NULL;
+    cache_entry *entry = NULL;
+    gsize size = 0;
+
+    g_return_if_fail(c->_arena == NULL);
+
+    // measured outside of the lock, this walks all members of the class
+    size = javaclass_get_memory_usage(c, NULL) + sizeof(cache_entry) +
+        strlen(key) + 1;
+
+    released = g_ptr_array_new();
+    g_mutex_lock(&cache->lock);
+
+    if (g_hash_table_contains(cache->entries, key)) {
+        g_mutex_unlock(&cache->lock);
+        g_ptr_array_free(released, TRUE);
+        return;
+    }
+
+    if (size > cache->main_budget) {
+        cache->stats.rejections++;
+        g_mutex_unlock(&cache->lock);
+        g_ptr_array_free(released, TRUE);
+        return;
+    }
+
+    entry = g_new0(cache_entry, 1);
+    entry->link.data = entry;
+    entry->key = g_strdup(key);
+    entry->hash = javahash_bytes(key, strlen(key), HASH_SEED);
+    entry->c = javaclass_ref(c);
+    entry->size = size;
+
+    g_hash_table_insert(cache->entries, entry->key, entry);
+    region_push(cache, entry, REGION_WINDOW);
+
+    while (cache->sizes[REGION_WINDOW] > cache->window_budget) {
+        admit_entry(cache, g_queue_peek_tail(&cache->regions[REGION_WINDOW]),
+                released);
+    }
+
+    g_mutex_unlock(&cache->lock);
+
+    release_classes(released);
+}
+
+JavaClass* javaclasscache_parse(JavaClassCache *cache, GBytes *bytes,
+        guint flags, GError **error)
+{
+    gsize length = 0;
+    gconstpointer data = g_bytes_get_data(bytes, &length);
+    gchar *key = NULL;
+    JavaClass *c = NULL;
+
+    // '#' doesn't occur in class names
+    key = g_strdup_printf("#%016" G_GINT64_MODIFIER "x-%" G_GSIZE_FORMAT
+            "-%u", javahash_bytes(data, length, HASH_SEED), length, flags);
+
+    c = javaclasscache_lookup(cache, key);
+
+    if (c == NULL) {
+        c = javaclass_new_from_bytes(bytes, flags, error);
+        if (c != NULL) javaclasscache_insert(cache, key, c);
+    }
+
+    g_free(key);
+
+    return c;
+}
+
+void javaclasscache_remove(JavaClassCache *cache, const gchar *key)
+{
+    GPtrArray *released = g_ptr_array_new();
+    cache_entry *entry = NULL;
+
+    g_mutex_lock(&cache->lock);
+
+    entry = g_hash_table_lookup(cache->entries, key);
+    if (entry != NULL) drop_entry(cache, entry, released);
+
+    g_mutex_unlock(&cache->lock);
+
+    release_classes(released);
+}
+
+void javaclasscache_get_stats(JavaClassCache *cache,
+        JavaClassCacheStats *stats)
+{
+    g_mutex_lock(&cache->lock);
+
+    *stats = cache->stats;
+    stats->classes = g_hash_table_size(cache->entries);
+    stats->size = cache->sizes[REGION_WINDOW] +
+        cache->sizes[REGION_PROBATION] + cache->sizes[REGION_PROTECTED];
+
+    g_mutex_unlock(&cache->lock);
+}
+
+void javaclasscache_free(JavaClassCache *cache)
+{
+    if (cache != NULL) {
+        GPtrArray *released = g_ptr_array_new();
+
+        for (int i = 0; i < REGION_COUNT; i++) {
+            cache_entry *entry = NULL;
+
+            while ((entry = g_queue_peek_head(&cache->regions[i])) != NULL) {
+                drop_entry(cache, entry, released);
+            }
+        }
+
+        release_classes(released);
+        g_hash_table_destroy(cache->entries);
+        g_free(cache->sketch);
+        g_mutex_clear(&cache->lock);
+        g_free(cache);
+    }
+}
@@ -0,0 +1,139 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "javaclassparser.h"
+#include "javaprivate.h"
+
+/*
+ * Initial sizes of the scratch memory, big enough for most classes
+ */
+#define PARSER_ARENA_SIZE  (64 * 1024)
+#define PARSER_BUFFER_SIZE (16 * 1024)
+
+struct _JavaClassParser
+{
+    JavaArena *arena;
+    guchar *buffer;
+    gsize buffer_size;
+};
+
+JavaClassParser* javaclass_parser_new(void)
+{
+    JavaClassParser *parser = g_new(JavaClassParser, 1);
+
+    parser->arena = javaarena_new(PARSER_ARENA_SIZE);
+    parser->buffer = g_new(guchar, PARSER_BUFFER_SIZE);
+    parser->buffer_size = PARSER_BUFFER_SIZE;
+
+    return parser;
+}
+
+JavaClass* javaclass_parser_parse(JavaClassParser *parser, guchar *classbytes,
+        guint32 length, gboolean includecode, GError **error)
+{
+    return javaclass_new_full(parser->arena, NULL, classbytes, length,
+            includecode ? JAVACLASS_PARSE_CODE : 0, error);
+}
+
+/*
+ * Read a whole file into the read buffer of the parser (growing it if needed)
+ */
+static gboolean read_file(JavaClassParser *parser, const gchar *filename,
+        gsize *length, GError **error)
+{
+    struct stat st;
+    gsize nbytes = 0;
+    ssize_t n = 0;
+    int fd = -1;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                "Error opening class file %s: %s\n", filename,
+                g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                "Error reading class file %s: %s\n", filename,
+                g_strerror(saved_errno));
+        close(fd);
+        return FALSE;
+    }
+
+    if ((gsize) st.st_size > parser->buffer_size) {
+        g_free(parser->buffer);
+        parser->buffer_size = st.st_size;
+        parser->buffer = g_new(guchar, parser->buffer_size);
+    }
+
+    while (nbytes < (gsize) st.st_size) {
+        n = read(fd, parser->buffer + nbytes, st.st_size - nbytes);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        nbytes += n;
+    }
+
+    close(fd);
+
+    if (nbytes != (gsize) st.st_size) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_IO,
+                "ERROR: Read error! Requested %zd bytes but got %zd!\n",
+                (gsize) st.st_size, nbytes);
+        return FALSE;
+    }
+
+    *length = nbytes;
+
+    return TRUE;
+}
+
+JavaClass* javaclass_parser_parse_file(JavaClassParser *parser,
+        const gchar *filename, gboolean includecode, GError **error)
+{
+    gsize length = 0;
+
+    if (!read_file(parser, filename, &length, error)) return NULL;
+
+    return javaclass_parser_parse(parser, parser->buffer, length, includecode,
+            error);
+}
+
+void javaclass_parser_reset(JavaClassParser *parser)
+{
+    javaarena_reset(parser->arena);
+}
+
+void javaclass_parser_free(JavaClassParser *parser)
+{
+    if (parser != NULL) {
+        javaarena_free(parser->arena);
+        g_free(parser->buffer);
+        g_free(parser);
+    }
+}
@@ -0,0 +1,450 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javaarchive.h"
+#include "javaclasspath.h"
+#include "javapackages.h"
+
+/*
+ * A JAR file or a directory on the classpath
+ */
+typedef struct _classpath_element
+{
+    gchar *path;
+    JavaArchive *archive; // NULL for directories
+} classpath_element;
+
+/*
+ * Where a class can be found
+ */
+typedef struct _class_location
+{
+    guint element;
+    guint entry;          // index of the archive entry (unused for directories)
+} class_location;
+
+/*
+ * A parsed class in the LRU cache
+ */
+typedef struct _cache_entry
+{
+    const gchar *fqn;
+    JavaClass *c;
+} cache_entry;
+
+struct _JavaClassPath
+{
+    guint flags;
+    GPtrArray *elements;
+    GArray *locations;
+    GHashTable *index;    // fqn -> index of the location + 1
+    GStringChunk *names;  // the fqns used as keys
+    JavaPackageTree *packages;
+
+    GMutex lock;          // protects the cache
+    guint cache_size;
+    GHashTable *cache;    // fqn -> link in lru
+    GQueue lru;           // most recently used entry first
+};
+
+JavaClassPath* javaclasspath_new(guint cache_size, guint flags)
+{
+    JavaClassPath *cp = g_new(JavaClassPath, 1);
+
+    cp->flags = flags;
+    cp->elements = g_ptr_array_new();
+    cp->locations = g_array_new(FALSE, FALSE, sizeof(class_location));
+    cp->index = g_hash_table_new(g_str_hash, g_str_equal);
+    cp->names = g_string_chunk_new(64 * 1024);
+    cp->packages = javapackagetree_new();
+    g_mutex_init(&cp->lock);
+    cp->cache_size = MAX(cache_size, 1);
+    cp->cache = g_hash_table_new(g_str_hash, g_str_equal);
+    g_queue_init(&cp->lru);
+
+    return cp;
+}
+
+/*
+ * Register a class under its path relative to the classpath element (like
+ * "java/lang/Object.class")
+ */
+static void index_class(JavaClassPath *cp, const gchar *relpath, guint len,
+        guint element, guint entry)
+{
+    class_location location;
+    gchar *fqn = NULL;
+
+    // multi-release versions and module descriptors aren't regular classes
+    if (g_str_has_prefix(relpath, "META-INF/")) return;
+    if (strcmp(relpath, "module-info.class") == 0) return;
+
+    fqn = g_string_chunk_insert_len(cp->names, relpath, len - strlen(".class"));
+    for (gchar *p = fqn; *p; p++) {
+        if (*p == '/') *p = '.';
+    }
+
+    if (g_hash_table_contains(cp->index, fqn)) return;
+
+    location.element = element;
+    location.entry = entry;
+    g_array_append_val(cp->locations, location);
+
+    g_hash_table_insert(cp->index, fqn,
+            GUINT_TO_POINTER(cp->locations->len));
+    javapackagetree_add_class(cp->packages, fqn,
+            GUINT_TO_POINTER(cp->locations->len));
+}
+
+/*
+ * Index all classes in a directory tree
+ */
+static void index_directory(JavaClassPath *cp, guint element,
+        const gchar *root, const gchar *relpath)
+{
+    gchar *dirname = relpath != NULL ? g_build_filename(root, relpath, NULL) :
+        g_strdup(root);
+    GDir *dir = g_dir_open(dirname, 0, NULL);
+    const gchar *name = NULL;
+
+    if (dir == NULL) {
+        g_free(dirname);
+        return;
+    }
+
+    while ((name = g_dir_read_name(dir)) != NULL) {
+        // class names use '/' no matter what the platform uses
+        gchar *child = relpath != NULL ?
+            g_strconcat(relpath, "/", name, NULL) : g_strdup(name);
+
+        if (g_str_has_suffix(name, ".class")) {
+            index_class(cp, child, strlen(child), element, 0);
+        } else {
+            gchar *path = g_build_filename(dirname, name, NULL);
+            if (g_file_test(path, G_FILE_TEST_IS_DIR))
+                index_directory(cp, element, root, child);
+            g_free(path);
+        }
+
+        g_free(child);
+    }
+
+    g_dir_close(dir);
+    g_free(dirname);
+}
+
+gboolean javaclasspath_add(JavaClassPath *cp, const gchar *path,
+        GError **error)
+{
+    classpath_element *element = NULL;
+    JavaArchive *archive = NULL;
+    guint index = cp->elements->len;
+
+    if (!g_file_test(path, G_FILE_TEST_IS_DIR)) {
+        archive = javaarchive_open(path, error);
+        if (archive == NULL) return FALSE;
+    }
+
+    element = g_new(classpath_element, 1);
+    element->path = g_strdup(path);
+    element->archive = archive;
+    g_ptr_array_add(cp->elements, element);
+
+    if (archive == NULL) {
+        index_directory(cp, index, path, NULL);
+        return TRUE;
+    }
+
+    for (guint i = 0; i < javaarchive_get_entry_count(archive); i++) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(archive, i);
+
+        if (javaarchive_entry_is_class(entry))
+            index_class(cp, entry->name, strlen(entry->name), index, i);
+    }
+
+    return TRUE;
+}
+
+gboolean javaclasspath_add_path_list(JavaClassPath *cp, const gchar *paths,
+        GError **error)
+{
+    gchar **elements = g_strsplit(paths, G_SEARCHPATH_SEPARATOR_S, -1);
+    gboolean retval = TRUE;
+
+    for (int i = 0; elements[i] && retval; i++) {
+        if (elements[i][0] == '\0') continue;
+        retval = javaclasspath_add(cp, elements[i], error);
+    }
+
+    g_strfreev(elements);
+
+    return retval;
+}
+
+guint javaclasspath_get_class_number(JavaClassPath *cp)
+{
+    return g_hash_table_size(cp->index);
+}
+
+JavaPackageTree* javaclasspath_get_packages(JavaClassPath *cp)
+{
+    return cp->packages;
+}
+
+gboolean javaclasspath_contains(JavaClassPath *cp, const gchar *fqn)
+{
+    return g_hash_table_contains(cp->index, fqn);
+}
+
+/*
+ * Parse a class from its location on the classpath
+ */
+static JavaClass* load_class(JavaClassPath *cp, const gchar *fqn,
+        class_location *location, GError **error)
+{
+    classpath_element *element = g_ptr_array_index(cp->elements,
+            location->element);
+    JavaClass *c = NULL;
+
+    if (element->archive != NULL) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(
+                element->archive, location->entry);
+        GBytes *bytes = javaarchive_read_entry(element->archive, entry, error);
+
+        if (bytes == NULL) return NULL;
+
+        c = javaclass_new_from_bytes(bytes, cp->flags, error);
+        g_bytes_unref(bytes);
+    } else {
+        gchar *relpath = g_strconcat(fqn, ".class", NULL);
+        gchar *filename = NULL;
+
+        for (gchar *p = relpath; *p && p < relpath + strlen(fqn); p++) {
+            if (*p == '.') *p = G_DIR_SEPARATOR;
+        }
+
+        filename = g_build_filename(element->path, relpath, NULL);
+        c = javaclass_new_from_mapped_file(filename, cp->flags, error);
+
+        g_free(filename);
+        g_free(relpath);
+    }
+
+    return c;
+}
+
+JavaClass* javaclasspath_get_class(JavaClassPath *cp, const gchar *fqn,
+        GError **error)
+{
+    GList *link = NULL;
+    cache_entry *entry = NULL;
+    gpointer key = NULL;
+    gpointer value = NULL;
+    JavaClass *c = NULL;
+    JavaClass *evicted = NULL;
+
+    if (!g_hash_table_lookup_extended(cp->index, fqn, &key, &value)) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_CLASS_NOT_FOUND,
+                "Class %s not found on the classpath\n", fqn);
+        return NULL;
+    }
+
+    g_mutex_lock(&cp->lock);
+    link = g_hash_table_lookup(cp->cache, key);
+
+    if (link != NULL) {
+        g_queue_unlink(&cp->lru, link);
+        g_queue_push_head_link(&cp->lru, link);
+        c = javaclass_ref(((cache_entry*) link->data)->c);
+        g_mutex_unlock(&cp->lock);
+
+        return c;
+    }
+
+    g_mutex_unlock(&cp->lock);
+
+    // parse without holding the lock, classes are immutable so it doesn't
+    // matter if another thread parses the same class at the same time
+    c = load_class(cp, fqn, &g_array_index(cp->locations, class_location,
+                GPOINTER_TO_UINT(value) - 1), error);
+    if (c == NULL) return NULL;
+
+    g_mutex_lock(&cp->lock);
+
+    if (g_hash_table_contains(cp->cache, key)) {
+        g_mutex_unlock(&cp->lock);
+        return c;
+    }
+
+    // make room for the new class
+    if (cp->lru.length >= cp->cache_size) {
+        link = g_queue_peek_tail_link(&cp->lru);
+        entry = link->data;
+
+        g_queue_unlink(&cp->lru, link);
+        g_hash_table_remove(cp->cache, entry->fqn);
+        evicted = entry->c;
+        g_free(entry);
+        g_list_free_1(link);
+    }
+
+    entry = g_new(cache_entry, 1);
+    entry->fqn = key;
+    entry->c = javaclass_ref(c);
+
+    g_queue_push_head(&cp->lru, entry);
+    g_hash_table_insert(cp->cache, key, cp->lru.head);
+
+    g_mutex_unlock(&cp->lock);
+
+    // users of the evicted class still hold their own references
+    javaclass_unref(evicted);
+
+    return c;
+}
+
+gchar** javaclasspath_get_superclasses(JavaClassPath *cp, const gchar *fqn,
+        GError **error)
+{
+    GPtrArray *result = g_ptr_array_new();
+    gchar *name = g_strdup(fqn);
+
+    for (;;) {
+        JavaClass *c = javaclasspath_get_class(cp, name, error);
+        const gchar *parent = NULL;
+
+        g_free(name);
+
+        if (c == NULL) {
+            g_ptr_array_add(result, NULL);
+            g_strfreev((gchar**) g_ptr_array_free(result, FALSE));
+            return NULL;
+        }
+
+        parent = javaclass_get_fq_parent(c);
+        if (parent == NULL) {
+            javaclass_unref(c);
+            break;
+        }
+
+        // guard against cycles in broken classpaths
+        if (result->len > javaclasspath_get_class_number(cp)) {
+            g_set_error(error, JAVACLASS_GERROR,
+                    JAVACLASS_ERROR_CLASS_NOT_FOUND,
+                    "Cyclic class hierarchy at %s\n", parent);
+            javaclass_unref(c);
+            g_ptr_array_add(result, NULL);
+            g_strfreev((gchar**) g_ptr_array_free(result, FALSE));
+            return NULL;
+        }
+
+        name = g_strdup(parent);
+        g_ptr_array_add(result, g_strdup(parent));
+        javaclass_unref(c);
+    }
+
+    g_ptr_array_add(result, NULL);
+
+    return (gchar**) g_ptr_array_free(result, FALSE);
+}
+
+gchar** javaclasspath_get_all_interfaces(JavaClassPath *cp, const gchar *fqn,
+        GError **error)
+{
+    GPtrArray *result = g_ptr_array_new();
+    GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+    GQueue pending = G_QUEUE_INIT;
+    gchar **superclasses = javaclasspath_get_superclasses(cp, fqn, error);
+    gchar *name = NULL;
+    gboolean failed = superclasses == NULL;
+
+    if (!failed) {
+        g_queue_push_tail(&pending, g_strdup(fqn));
+        for (int i = 0; superclasses[i]; i++) {
+            g_queue_push_tail(&pending, g_strdup(superclasses[i]));
+        }
+    }
+
+    // breadth first over the classes and the interfaces found so far
+    while (!failed && (name = g_queue_pop_head(&pending)) != NULL) {
+        JavaClass *c = javaclasspath_get_class(cp, name, error);
+        gchar **interfaces = NULL;
+
+        g_free(name);
+
+        if (c == NULL) {
+            failed = TRUE;
+            break;
+        }
+
+        interfaces = javaclass_get_interfaces(c);
+        for (int i = 0; interfaces && interfaces[i]; i++) {
+            gchar *interface = NULL;
+
+            if (g_hash_table_contains(seen, interfaces[i])) continue;
+
+            interface = g_strdup(interfaces[i]);
+            g_ptr_array_add(result, interface);
+            g_hash_table_add(seen, interface);
+            g_queue_push_tail(&pending, g_strdup(interface));
+        }
+
+        javaclass_unref(c);
+    }
+
+    while ((name = g_queue_pop_head(&pending)) != NULL) g_free(name);
+    g_hash_table_destroy(seen);
+    g_strfreev(superclasses);
+    g_ptr_array_add(result, NULL);
+
+    if (failed) {
+        g_strfreev((gchar**) g_ptr_array_free(result, FALSE));
+        return NULL;
+    }
+
+    return (gchar**) g_ptr_array_free(result, FALSE);
+}
+
+void javaclasspath_free(JavaClassPath *cp)
+{
+    cache_entry *entry = NULL;
+
+    if (cp != NULL) {
+        while ((entry = g_queue_pop_head(&cp->lru)) != NULL) {
+            javaclass_unref(entry->c);
+            g_free(entry);
+        }
+
+        for (guint i = 0; i < cp->elements->len; i++) {
+            classpath_element *element = g_ptr_array_index(cp->elements, i);
+            javaarchive_free(element->archive);
+            g_free(element->path);
+            g_free(element);
+        }
+
+        g_ptr_array_free(cp->elements, TRUE);
+        g_array_free(cp->locations, TRUE);
+        g_hash_table_destroy(cp->index);
+        g_hash_table_destroy(cp->cache);
+        g_string_chunk_free(cp->names);
+        javapackagetree_free(cp->packages);
+        g_mutex_clear(&cp->lock);
+        g_free(cp);
+    }
+}
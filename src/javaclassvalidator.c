@@ -0,0 +1,633 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javaclassvalidator.h"
+#include "javaprivate.h"
+
+#define MIN_MAJOR_VERSION 45
+
+// the tag table keeps the attribute a UTF-8 constant names in the upper
+// bits of its tag
+#define TAG_MASK 0x1f
+#define NAME_SHIFT 5
+
+/*
+ * The attributes javaclass_new() interprets, their contents are checked
+ */
+enum
+{
+    NAME_NONE,
+    NAME_CODE,
+    NAME_EXCEPTIONS,
+    NAME_SIGNATURE,
+    NAME_SOURCEFILE,
+    NAME_CONSTANT_VALUE,
+    NAME_INNER_CLASSES,
+    NAME_DEPRECATED
+};
+
+static const gchar *attribute_names[] = {
+    NULL, "Code", "Exceptions", "Signature", "SourceFile", "ConstantValue",
+    "InnerClasses", "Deprecated"
+};
+
+typedef struct _validator
+{
+    const guchar *bytes;
+    gsize length;
+    gsize offset;
+    guint16 cp_count;       // as in the file, the entries count from 1
+    guint8 *tags;           // tag of every constant, 0 for unusable slots
+    JavaClassValidation *report;
+} validator;
+
+static gboolean fail(validator *v, JavaClassValidity result,
+        const gchar *message)
+{
+    v->report->result = result;
+    v->report->message = message;
+    v->report->offset = v->offset;
+
+    return FALSE;
+}
+
+static guint16 get_u16(validator *v, gsize at)
+{
+    return (v->bytes[at] << 8) | v->bytes[at + 1];
+}
+
+static guint32 get_u32(validator *v, gsize at)
+{
+    return ((guint32) v->bytes[at] << 24) | (v->bytes[at + 1] << 16) |
+        (v->bytes[at + 2] << 8) | v->bytes[at + 3];
+}
+
+static gboolean has_bytes(validator *v, gsize n)
+{
+    return v->length - v->offset >= n;
+}
+
+static gboolean is_constant(validator *v, guint16 i, guint8 tag)
+{
+    return i > 0 && i < v->cp_count && (v->tags[i] & TAG_MASK) == tag;
+}
+
+static gboolean is_member_ref(validator *v, guint16 i)
+{
+    return is_constant(v, i, TAG_FIELDREF) ||
+        is_constant(v, i, TAG_METHODREF) ||
+        is_constant(v, i, TAG_INTERFACEMETHODREF);
+}
+
+/*
+ * The class file version a constant pool tag was introduced with
+ */
+static guint16 tag_version(guint8 tag)
+{
+    switch (tag) {
+        case TAG_METHODHANDLE:
+        case TAG_METHODTYPE:
+        case TAG_INVOKEDYNAMIC:
+            return 51;
+        case TAG_MODULE:
+        case TAG_PACKAGE:
+            return 53;
+        case TAG_DYNAMIC:
+            return 55;
+        default:
+            return MIN_MAJOR_VERSION;
+    }
+}
+
+/*
+ * Modified UTF-8 has no zero bytes and no bytes from 0xf0 on
+ */
+static gboolean is_modified_utf8(const guchar *p, guint16 length)
+{
+    guchar bad = 0;
+
+    // no early exit so that the compiler can vectorize the loop
+    for (guint16 i = 0; i < length; i++) {
+        bad |= (p[i] == 0) | (p[i] >= 0xf0);
+    }
+
+    return !bad;
+}
+
+/*
+ * First pass over the constant pool: tags and lengths
+ */
+static gboolean scan_constants(validator *v)
+{
+    for (guint16 i = 1; i < v->cp_count; i++) {
+        guint8 tag = 0;
+        gsize size = 0;
+
+        if (!has_bytes(v, 1)) {
+            return fail(v, JAVACLASS_INVALID_TRUNCATED,
+                    "Constant pool ends beyond the file");
+        }
+
+        tag = v->bytes[v->offset];
+        v->tags[i] = tag;
+
+        switch (tag) {
+            case TAG_UTF8:
+                if (!has_bytes(v, 3)) break;
+                size = 3 + get_u16(v, v->offset + 1);
+                break;
+            case TAG_CLASS:
+            case TAG_STRING:
+            case TAG_METHODTYPE:
+            case TAG_MODULE:
+            case TAG_PACKAGE:
+                size = 3;
+                break;
+            case TAG_METHODHANDLE:
+                size = 4;
+                break;
+            case TAG_INTEGER:
+            case TAG_FLOAT:
+            case TAG_FIELDREF:
+            case TAG_METHODREF:
+            case TAG_INTERFACEMETHODREF:
+            case TAG_NAMEANDTYPE:
+            case TAG_DYNAMIC:
+            case TAG_INVOKEDYNAMIC:
+                size = 5;
+                break;
+            case TAG_LONG:
+            case TAG_DOUBLE:
+                // the next slot is unusable and has to exist
+                if (i + 1 >= v->cp_count) {
+                    return fail(v, JAVACLASS_INVALID_CONSTANT,
+                            "Long or double constant in the last slot");
+                }
+
+                v->tags[++i] = 0;
+                size = 9;
+                break;
+            default:
+                return fail(v, JAVACLASS_INVALID_CONSTANT,
+                        "Unknown constant pool tag");
+        }
+
+        if (tag_version(tag) > v->report->major_version) {
+            return fail(v, JAVACLASS_INVALID_CONSTANT,
+                    "Constant pool tag of a newer class file version");
+        }
+
+        if (size == 0 || !has_bytes(v, size)) {
+            return fail(v, JAVACLASS_INVALID_TRUNCATED,
+                    "Constant pool ends beyond the file");
+        }
+
+        if (tag == TAG_UTF8) {
+            const guchar *string = v->bytes + v->offset + 3;
+
+            if (!is_modified_utf8(string, size - 3)) {
+                return fail(v, JAVACLASS_INVALID_CONSTANT,
+                        "Malformed UTF-8 constant");
+            }
+
+            for (guint8 name = NAME_CODE; name <= NAME_DEPRECATED; name++) {
+                if (size - 3 == strlen(attribute_names[name]) &&
+                        memcmp(string, attribute_names[name], size - 3) == 0) {
+                    v->tags[i] |= name << NAME_SHIFT;
+                }
+            }
+        }
+
+        v->offset += size;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Second pass over the constant pool: the references between constants,
+ * which may point forward
+ */
+static gboolean check_constants(validator *v, gsize start)
+{
+    v->offset = start;
+
+    for (guint16 i = 1; i < v->cp_count; i++) {
+        guint8 tag = v->tags[i] & TAG_MASK;
+        gsize entry = v->offset;
+        gsize at = v->offset + 1;
+        gboolean valid = TRUE;
+
+        switch (tag) {
+            case TAG_UTF8:
+                v->offset += 3 + get_u16(v, at);
+                continue;
+            case TAG_INTEGER:
+            case TAG_FLOAT:
+                v->offset += 5;
+                continue;
+            case TAG_LONG:
+            case TAG_DOUBLE:
+                v->offset += 9;
+                i++;
+                continue;
+            case TAG_CLASS:
+            case TAG_STRING:
+            case TAG_METHODTYPE:
+            case TAG_MODULE:
+            case TAG_PACKAGE:
+                valid = is_constant(v, get_u16(v, at), TAG_UTF8);
+                v->offset += 3;
+                break;
+            case TAG_FIELDREF:
+            case TAG_METHODREF:
+            case TAG_INTERFACEMETHODREF:
+                valid = is_constant(v, get_u16(v, at), TAG_CLASS) &&
+                    is_constant(v, get_u16(v, at + 2), TAG_NAMEANDTYPE);
+                v->offset += 5;
+                break;
+            case TAG_NAMEANDTYPE:
+                valid = is_constant(v, get_u16(v, at), TAG_UTF8) &&
+                    is_constant(v, get_u16(v, at + 2), TAG_UTF8);
+                v->offset += 5;
+                break;
+            case TAG_DYNAMIC:
+            case TAG_INVOKEDYNAMIC:
+                // the first index is into the BootstrapMethods attribute
+                valid = is_constant(v, get_u16(v, at + 2),
+                        TAG_NAMEANDTYPE);
+                v->offset += 5;
+                break;
+            case TAG_METHODHANDLE:
+                // reference kinds 1 to 4 are fields, 5 to 9 methods
+                valid = v->bytes[at] >= 1 && v->bytes[at] <= 9 &&
+                    is_member_ref(v, get_u16(v, at + 1)) &&
+                    (v->bytes[at] <= 4) ==
+                    is_constant(v, get_u16(v, at + 1), TAG_FIELDREF);
+                v->offset += 4;
+                break;
+        }
+
+        if (!valid) {
+            v->offset = entry;
+            return fail(v, JAVACLASS_INVALID_REFERENCE,
+                    "Constant refers to a missing or wrong constant");
+        }
+    }
+
+    return TRUE;
+}
+
+/*
+ * The contents of a "Code" attribute of length bytes at start: u2
+ * max_stack, u2 max_locals, u4 code_length, code, u2
+ * exception_table_length, exception table, u2 attributes_count, attributes
+ */
+static gboolean check_code(validator *v, gsize start, guint32 length)
+{
+    guint32 codelen = 0;
+    guint32 pos = 0;
+    guint16 n = 0;
+
+    if (length < 8) {
+        return fail(v, JAVACLASS_INVALID_ATTRIBUTE, "Code attribute too short");
+    }
+
+    codelen = get_u32(v, start + 4);
+    if (codelen == 0 || codelen > 65535 || codelen > length - 8 ||
+            length - 8 - codelen < 4) {
+        return fail(v, JAVACLASS_INVALID_ATTRIBUTE,
+                "Code length doesn't fit the Code attribute");
+    }
+
+    pos = 8 + codelen;
+    n = get_u16(v, start + pos);
+    pos += 2;
+
+    if ((guint64) n * 8 > length - pos - 2) {
+        return fail(v, JAVACLASS_INVALID_ATTRIBUTE,
+                "Exception table doesn't fit the Code attribute");
+    }
+
+    for (guint16 i = 0; i < n; i++, pos += 8) {
+        guint16 start_pc = get_u16(v, start + pos);
+        guint16 end_pc = get_u16(v, start + pos + 2);
+        guint16 handler_pc = get_u16(v, start + pos + 4);
+        guint16 catch_type = get_u16(v, start + pos + 6);
+
+        if (start_pc >= end_pc || end_pc > codelen || handler_pc >= codelen) {
+            return fail(v, JAVACLASS_INVALID_ATTRIBUTE,
+                    "Exception handler outside of the code");
+        }
+
+        if (catch_type != 0 && !is_constant(v, catch_type, TAG_CLASS)) {
+            return fail(v, JAVACLASS_INVALID_REFERENCE,
+                    "Exception handler catches no class");
+        }
+    }
+
+    n = get_u16(v, start + pos);
+    pos += 2;
+
+    for (guint16 i = 0; i < n; i++) {
+        guint32 size = 0;
+
+        if (length - pos < 6) {
+            return fail(v, JAVACLASS_INVALID_ATTRIBUTE,
+                    "Attributes don't fit the Code attribute");
+        }
+
+        if (!is_constant(v, get_u16(v, start + pos), TAG_UTF8)) {
+            return fail(v, JAVACLASS_INVALID_REFERENCE,
+                    "Attribute name isn't a UTF-8 constant");
+        }
+
+        size = get_u32(v, start + pos + 2);
+        pos += 6;
+
+        if (size > length - pos) {
+            return fail(v, JAVACLASS_INVALID_ATTRIBUTE,
+                    "Attributes don't fit the Code attribute");
+        }
+
+        pos += size;
+    }
+
+    if (pos != length) {
+        return fail(v, JAVACLASS_INVALID_ATTRIBUTE,
+                "Code attribute is longer than its contents");
+    }
+
+    return TRUE;
+}
+
+/*
+ * The contents of the other attributes javaclass_new() reads
+ */
+static gboolean check_attribute(validator *v, guint8 name, gsize start,
+        guint32 length)
+{
+    guint16 n = 0;
+    guint16 index = 0;
+
+    switch (name) {
+        case NAME_CODE:
+            return check_code(v, start, length);
+        case NAME_SIGNATURE:
+        case NAME_SOURCEFILE:
+            if (length != 2) break;
+            if (!is_constant(v, get_u16(v, start), TAG_UTF8)) {
+                return fail(v, JAVACLASS_INVALID_REFERENCE,
+                        "Attribute doesn't refer to a UTF-8 constant");
+            }
+            return TRUE;
+        case NAME_CONSTANT_VALUE:
+            if (length != 2) break;
+            index = get_u16(v, start);
+            if (!is_constant(v, index, TAG_INTEGER) &&
+                    !is_constant(v, index, TAG_FLOAT) &&
+                    !is_constant(v, index, TAG_LONG) &&
+                    !is_constant(v, index, TAG_DOUBLE) &&
+                    !is_constant(v, index, TAG_STRING)) {
+                return fail(v, JAVACLASS_INVALID_REFERENCE,
+                        "ConstantValue doesn't refer to a constant value");
+            }
+            return TRUE;
+        case NAME_EXCEPTIONS:
+            // u2 count and the classes
+            if (length < 2) break;
+            n = get_u16(v, start);
+            if (length != 2 + (guint32) n * 2) break;
+
+            for (guint16 i = 0; i < n; i++) {
+                if (!is_constant(v, get_u16(v, start + 2 + i * 2),
+                            TAG_CLASS)) {
+                    return fail(v, JAVACLASS_INVALID_REFERENCE,
+                            "Declared exception isn't a class constant");
+                }
+            }
+            return TRUE;
+        case NAME_INNER_CLASSES:
+            // u2 count and for each u2 inner class, u2 outer class (or 0),
+            // u2 simple name (or 0), u2 access flags
+            if (length < 2) break;
+            n = get_u16(v, start);
+            if (length != 2 + (guint32) n * 8) break;
+
+            for (guint16 i = 0; i < n; i++) {
+                gsize at = start + 2 + (gsize) i * 8;
+                guint16 outer = get_u16(v, at + 2);
+                guint16 simple = get_u16(v, at + 4);
+
+                if (!is_constant(v, get_u16(v, at), TAG_CLASS) ||
+                        (outer != 0 && !is_constant(v, outer, TAG_CLASS)) ||
+                        (simple != 0 && !is_constant(v, simple, TAG_UTF8))) {
+                    return fail(v, JAVACLASS_INVALID_REFERENCE,
+                            "Inner class entry refers to a wrong constant");
+                }
+            }
+            return TRUE;
+        case NAME_DEPRECATED:
+            if (length != 0) break;
+            return TRUE;
+        default:
+            return TRUE;
+    }
+
+    return fail(v, JAVACLASS_INVALID_ATTRIBUTE,
+            "Attribute length doesn't fit its contents");
+}
+
+static gboolean check_attributes(validator *v)
+{
+    guint16 count = 0;
+
+    if (!has_bytes(v, 2)) {
+        return fail(v, JAVACLASS_INVALID_TRUNCATED,
+                "Attributes end beyond the file");
+    }
+
+    count = get_u16(v, v->offset);
+    v->offset += 2;
+
+    for (guint16 i = 0; i < count; i++) {
+        guint16 name = 0;
+        guint32 length = 0;
+
+        if (!has_bytes(v, 6)) {
+            return fail(v, JAVACLASS_INVALID_TRUNCATED,
+                    "Attributes end beyond the file");
+        }
+
+        name = get_u16(v, v->offset);
+        length = get_u32(v, v->offset + 2);
+
+        if (!is_constant(v, name, TAG_UTF8)) {
+            return fail(v, JAVACLASS_INVALID_REFERENCE,
+                    "Attribute name isn't a UTF-8 constant");
+        }
+
+        v->offset += 6;
+
+        if (!has_bytes(v, length)) {
+            return fail(v, JAVACLASS_INVALID_TRUNCATED,
+                    "Attribute ends beyond the file");
+        }
+
+        if (!check_attribute(v, v->tags[name] >> NAME_SHIFT, v->offset,
+                    length)) {
+            return FALSE;
+        }
+
+        v->offset += length;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Fields or methods: u2 count and for each u2 access_flags, u2 name_index,
+ * u2 descriptor_index and the attributes
+ */
+static gboolean check_members(validator *v, guint16 *count)
+{
+    if (!has_bytes(v, 2)) {
+        return fail(v, JAVACLASS_INVALID_TRUNCATED,
+                "Members end beyond the file");
+    }
+
+    *count = get_u16(v, v->offset);
+    v->offset += 2;
+
+    for (guint16 i = 0; i < *count; i++) {
+        if (!has_bytes(v, 6)) {
+            return fail(v, JAVACLASS_INVALID_TRUNCATED,
+                    "Members end beyond the file");
+        }
+
+        if (!is_constant(v, get_u16(v, v->offset + 2), TAG_UTF8) ||
+                !is_constant(v, get_u16(v, v->offset + 4), TAG_UTF8)) {
+            return fail(v, JAVACLASS_INVALID_REFERENCE,
+                    "Member name or descriptor isn't a UTF-8 constant");
+        }
+
+        v->offset += 6;
+
+        if (!check_attributes(v)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean javaclass_validate(const guchar *classbytes, gsize length,
+        JavaClassValidation *report)
+{
+    // all the memory validation needs, the tags of up to 65535 constants
+    guint8 tags[G_MAXUINT16 + 1];
+    JavaClassValidation dummy;
+    validator v = {classbytes, length, 0, 0, tags, NULL};
+    gsize cp_start = 0;
+    gsize cp_end = 0;
+    guint16 n = 0;
+
+    v.report = report != NULL ? report : &dummy;
+    memset(v.report, 0, sizeof(JavaClassValidation));
+
+    if (!has_bytes(&v, 10)) {
+        return fail(&v, JAVACLASS_INVALID_TRUNCATED, "File too short");
+    }
+
+    if (get_u32(&v, 0) != 0xCAFEBABE) {
+        return fail(&v, JAVACLASS_INVALID_MAGIC, "Wrong magic number");
+    }
+
+    v.report->minor_version = get_u16(&v, 4);
+    v.report->major_version = get_u16(&v, 6);
+    v.cp_count = get_u16(&v, 8);
+    v.report->constant_pool_count = v.cp_count;
+
+    if (v.report->major_version < MIN_MAJOR_VERSION ||
+            v.report->major_version > MAX_MAJOR_VERSION) {
+        v.offset = 6;
+        return fail(&v, JAVACLASS_INVALID_VERSION,
+                "Unknown class file version");
+    }
+
+    if (v.cp_count == 0) {
+        v.offset = 8;
+        return fail(&v, JAVACLASS_INVALID_CONSTANT,
+                "Constant pool count is 0");
+    }
+
+    v.offset = cp_start = 10;
+    tags[0] = 0;
+
+    if (!scan_constants(&v)) return FALSE;
+
+    cp_end = v.offset;
+    if (!check_constants(&v, cp_start)) return FALSE;
+    v.offset = cp_end;
+
+    // u2 access_flags, u2 this_class, u2 super_class, u2 interfaces_count
+    if (!has_bytes(&v, 8)) {
+        return fail(&v, JAVACLASS_INVALID_TRUNCATED,
+                "Class header ends beyond the file");
+    }
+
+    if (!is_constant(&v, get_u16(&v, v.offset + 2), TAG_CLASS)) {
+        return fail(&v, JAVACLASS_INVALID_REFERENCE,
+                "This class isn't a class constant");
+    }
+
+    if (get_u16(&v, v.offset + 4) != 0 &&
+            !is_constant(&v, get_u16(&v, v.offset + 4), TAG_CLASS)) {
+        return fail(&v, JAVACLASS_INVALID_REFERENCE,
+                "Superclass isn't a class constant");
+    }
+
+    n = get_u16(&v, v.offset + 6);
+    v.offset += 8;
+
+    if (!has_bytes(&v, (gsize) n * 2)) {
+        return fail(&v, JAVACLASS_INVALID_TRUNCATED,
+                "Interfaces end beyond the file");
+    }
+
+    for (guint16 i = 0; i < n; i++, v.offset += 2) {
+        if (!is_constant(&v, get_u16(&v, v.offset), TAG_CLASS)) {
+            return fail(&v, JAVACLASS_INVALID_REFERENCE,
+                    "Interface isn't a class constant");
+        }
+    }
+
+    if (!check_members(&v, &v.report->fields_count) ||
+            !check_members(&v, &v.report->methods_count) ||
+            !check_attributes(&v)) {
+        return FALSE;
+    }
+
+    if (v.offset != length) {
+        return fail(&v, JAVACLASS_INVALID_TRAILING_BYTES,
+                "Bytes after the end of the class");
+    }
+
+    v.report->result = JAVACLASS_VALID;
+
+    return TRUE;
+}
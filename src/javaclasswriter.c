@@ -0,0 +1,906 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javaclasswriter.h"
+#include "javaprivate.h"
+
+#define ACC_PRIVATE  0x0002
+#define ACC_NATIVE   0x0100
+#define ACC_ABSTRACT 0x0400
+
+#define INVALID_INDEX 65535
+
+// annotations nested deeper than this are treated as malformed
+#define MAX_ANNOTATION_DEPTH 64
+
+/*
+ * The state of writing one class
+ *
+ * A stripped class is walked twice: first without output to mark the
+ * constants that are still used, then for real with the constants
+ * renumbered. Both walks run the same code, so they can't disagree.
+ */
+typedef struct _class_writer
+{
+    JavaClass *c;
+    gboolean strip;
+    guint8 *marks;      // which constants are used (only when stripping)
+    guint16 *remap;     // new index of each constant counting from 1
+    GByteArray *out;    // NULL while marking
+    gboolean malformed;
+} class_writer;
+
+static guint16 read_u16(const guchar *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static guint32 read_u32(const guchar *p)
+{
+    return ((guint32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void put_bytes(class_writer *w, const void *data, gsize size)
+{
+    if (w->out != NULL && size > 0) {
+        g_byte_array_append(w->out, data, size);
+    }
+}
+
+static void put_u8(class_writer *w, guint8 value)
+{
+    put_bytes(w, &value, 1);
+}
+
+static void put_u16(class_writer *w, guint16 value)
+{
+    value = GUINT16_TO_BE(value);
+    put_bytes(w, &value, 2);
+}
+
+static void put_u32(class_writer *w, guint32 value)
+{
+    value = GUINT32_TO_BE(value);
+    put_bytes(w, &value, 4);
+}
+
+/*
+ * Mark a constant (counting from 0) and everything it refers to as used
+ */
+static void mark_constant(class_writer *w, guint16 i)
+{
+    JavaClass *c = w->c;
+
+    if (i >= c->constant_pool_count) {
+        w->malformed = TRUE;
+        return;
+    }
+
+    if (w->marks[i]) return;
+    w->marks[i] = 1;
+
+    switch (c->cp_tags[i]) {
+        case TAG_CLASS:
+        case TAG_STRING:
+        case TAG_METHODTYPE:
+        case TAG_MODULE:
+        case TAG_PACKAGE:
+            mark_constant(w, c->cp_values[i].index);
+            break;
+        case TAG_FIELDREF:
+        case TAG_METHODREF:
+        case TAG_INTERFACEMETHODREF:
+        case TAG_NAMEANDTYPE:
+            mark_constant(w, c->cp_values[i].indexpair[0]);
+            mark_constant(w, c->cp_values[i].indexpair[1]);
+            break;
+        case TAG_METHODHANDLE:
+            mark_constant(w, c->cp_values[i].handle.index);
+            break;
+        case TAG_DYNAMIC:
+        case TAG_INVOKEDYNAMIC:
+            // the bootstrap methods go with the bytecode that uses them
+            mark_constant(w, c->cp_values[i].indexpair[1]);
+            break;
+        case TAG_LONG:
+        case TAG_DOUBLE:
+            // the second slot
+            if (i + 1 < c->constant_pool_count) w->marks[i + 1] = 1;
+            break;
+    }
+}
+
+/*
+ * Write a reference to a constant (counting from 0), or mark it while
+ * marking
+ */
+static void put_index(class_writer *w, guint16 i)
+{
+    if (w->strip && w->out == NULL) {
+        mark_constant(w, i);
+    } else if (w->strip) {
+        put_u16(w, w->remap[i]);
+    } else {
+        put_u16(w, i + 1);
+    }
+}
+
+/*
+ * Copy a constant pool index as found in an attribute (counting from 1, 0
+ * stays 0 for optional references)
+ */
+static void copy_index(class_writer *w, const guchar *p)
+{
+    guint16 i = read_u16(p);
+
+    if (i == 0) {
+        put_u16(w, 0);
+    } else {
+        put_index(w, i - 1);
+    }
+}
+
+/*
+ * Make sure there are size more bytes in an attribute at offset
+ */
+static gboolean has_bytes(class_writer *w, guint32 length, guint32 offset,
+        guint32 size)
+{
+    if (length - offset < size) {
+        w->malformed = TRUE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean copy_annotation(class_writer *w, const guchar *p,
+        guint32 length, guint32 *offset, guint depth);
+
+static gboolean copy_element_value(class_writer *w, const guchar *p,
+        guint32 length, guint32 *offset, guint depth)
+{
+    guint8 tag = 0;
+    guint16 count = 0;
+
+    if (depth > MAX_ANNOTATION_DEPTH || !has_bytes(w, length, *offset, 1)) {
+        w->malformed = TRUE;
+        return FALSE;
+    }
+
+    tag = p[(*offset)++];
+    put_u8(w, tag);
+
+    switch (tag) {
+        case 'B': case 'C': case 'D': case 'F': case 'I': case 'J':
+        case 'S': case 'Z': case 's': case 'c':
+            if (!has_bytes(w, length, *offset, 2)) return FALSE;
+            copy_index(w, p + *offset);
+            *offset += 2;
+            return TRUE;
+        case 'e':
+            if (!has_bytes(w, length, *offset, 4)) return FALSE;
+            copy_index(w, p + *offset);
+            copy_index(w, p + *offset + 2);
+            *offset += 4;
+            return TRUE;
+        case '@':
+            return copy_annotation(w, p, length, offset, depth + 1);
+        case '[':
+            if (!has_bytes(w, length, *offset, 2)) return FALSE;
+            count = read_u16(p + *offset);
+            put_u16(w, count);
+            *offset += 2;
+
+            for (guint16 i = 0; i < count; i++) {
+                if (!copy_element_value(w, p, length, offset, depth + 1))
+                    return FALSE;
+            }
+
+            return TRUE;
+    }
+
+    w->malformed = TRUE;
+    return FALSE;
+}
+
+static gboolean copy_annotation(class_writer *w, const guchar *p,
+        guint32 length, guint32 *offset, guint depth)
+{
+    guint16 count = 0;
+
+    if (!has_bytes(w, length, *offset, 4)) return FALSE;
+
+    copy_index(w, p + *offset);
+    count = read_u16(p + *offset + 2);
+    put_u16(w, count);
+    *offset += 4;
+
+    for (guint16 i = 0; i < count; i++) {
+        if (!has_bytes(w, length, *offset, 2)) return FALSE;
+        copy_index(w, p + *offset);
+        *offset += 2;
+
+        if (!copy_element_value(w, p, length, offset, depth)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Copy size bytes that aren't constant pool indices
+ */
+static gboolean copy_raw(class_writer *w, const guchar *p, guint32 length,
+        guint32 *offset, guint32 size)
+{
+    if (!has_bytes(w, length, *offset, size)) return FALSE;
+
+    put_bytes(w, p + *offset, size);
+    *offset += size;
+
+    return TRUE;
+}
+
+/*
+ * Copy one constant pool index
+ */
+static gboolean copy_ref(class_writer *w, const guchar *p, guint32 length,
+        guint32 *offset)
+{
+    if (!has_bytes(w, length, *offset, 2)) return FALSE;
+
+    copy_index(w, p + *offset);
+    *offset += 2;
+
+    return TRUE;
+}
+
+/*
+ * Copy a u2 count followed by that many constant pool indices
+ */
+static gboolean copy_refs(class_writer *w, const guchar *p, guint32 length,
+        guint32 *offset)
+{
+    guint16 count = 0;
+
+    if (!has_bytes(w, length, *offset, 2)) return FALSE;
+
+    count = read_u16(p + *offset);
+    put_u16(w, count);
+    *offset += 2;
+
+    for (guint16 i = 0; i < count; i++) {
+        if (!copy_ref(w, p, length, offset)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+static gboolean copy_type_annotation(class_writer *w, const guchar *p,
+        guint32 length, guint32 *offset)
+{
+    guint8 target = 0;
+    guint32 size = 0;
+
+    if (!has_bytes(w, length, *offset, 1)) return FALSE;
+
+    target = p[*offset];
+    put_u8(w, target);
+    (*offset)++;
+
+    // the target info holds no constant pool indices, only its size differs
+    switch (target) {
+        case 0x00: case 0x01: case 0x16:
+            size = 1;
+            break;
+        case 0x10: case 0x11: case 0x12: case 0x17:
+        case 0x42: case 0x43: case 0x44: case 0x45: case 0x46:
+            size = 2;
+            break;
+        case 0x13: case 0x14: case 0x15:
+            size = 0;
+            break;
+        case 0x47: case 0x48: case 0x49: case 0x4a: case 0x4b:
+            size = 3;
+            break;
+        case 0x40: case 0x41:
+            // a table of local variable ranges
+            if (!has_bytes(w, length, *offset, 2)) return FALSE;
+            size = 2 + read_u16(p + *offset) * 6;
+            break;
+        default:
+            w->malformed = TRUE;
+            return FALSE;
+    }
+
+    if (!copy_raw(w, p, length, offset, size)) return FALSE;
+
+    // the type path
+    if (!has_bytes(w, length, *offset, 1)) return FALSE;
+    if (!copy_raw(w, p, length, offset, 1 + p[*offset] * 2)) return FALSE;
+
+    return copy_annotation(w, p, length, offset, 0);
+}
+
+static void copy_attribute_info(class_writer *w, attribute_info *attribute);
+
+/*
+ * Copy the attributes of a record component, the ones that can't be
+ * renumbered make the class malformed as dropping them would change the
+ * length of the Record attribute
+ */
+static gboolean copy_component_attributes(class_writer *w, const guchar *p,
+        guint32 length, guint32 *offset)
+{
+    JavaClass *c = w->c;
+    guint16 count = 0;
+
+    if (!has_bytes(w, length, *offset, 2)) return FALSE;
+
+    count = read_u16(p + *offset);
+    put_u16(w, count);
+    *offset += 2;
+
+    for (guint16 i = 0; i < count; i++) {
+        attribute_info nested;
+        guint16 name_index = 0;
+
+        if (!has_bytes(w, length, *offset, 6)) return FALSE;
+
+        name_index = read_u16(p + *offset) - 1;
+        if (name_index >= c->constant_pool_count ||
+                c->cp_tags[name_index] != TAG_UTF8) {
+            w->malformed = TRUE;
+            return FALSE;
+        }
+
+        nested.attribute_name_index = name_index;
+        nested._kind = javaclass_attribute_kind(
+                javaclass_cp_string(c, name_index));
+        nested.attribute_length = read_u32(p + *offset + 2);
+        *offset += 6;
+
+        if (!has_bytes(w, length, *offset, nested.attribute_length))
+            return FALSE;
+        nested.info = (guchar*) p + *offset;
+
+        switch (nested._kind) {
+            case ATTRIBUTE_SIGNATURE:
+            case ATTRIBUTE_VISIBLE_ANNOTATIONS:
+            case ATTRIBUTE_INVISIBLE_ANNOTATIONS:
+            case ATTRIBUTE_VISIBLE_TYPE_ANNOTATIONS:
+            case ATTRIBUTE_INVISIBLE_TYPE_ANNOTATIONS:
+                break;
+            default:
+                w->malformed = TRUE;
+                return FALSE;
+        }
+
+        put_index(w, name_index);
+        put_u32(w, nested.attribute_length);
+        copy_attribute_info(w, &nested);
+        *offset += nested.attribute_length;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Copy a Module attribute: the module, its requires, exports, opens, uses
+ * and provides tables
+ */
+static gboolean copy_module(class_writer *w, const guchar *p, guint32 length,
+        guint32 *offset)
+{
+    guint16 count = 0;
+
+    // name, flags and version
+    if (!copy_ref(w, p, length, offset) ||
+            !copy_raw(w, p, length, offset, 2) ||
+            !copy_ref(w, p, length, offset))
+        return FALSE;
+
+    // requires: module, flags and version
+    if (!has_bytes(w, length, *offset, 2)) return FALSE;
+    count = read_u16(p + *offset);
+    put_u16(w, count);
+    *offset += 2;
+
+    for (guint16 i = 0; i < count; i++) {
+        if (!copy_ref(w, p, length, offset) ||
+                !copy_raw(w, p, length, offset, 2) ||
+                !copy_ref(w, p, length, offset))
+            return FALSE;
+    }
+
+    // exports and opens: package, flags and the modules it goes to
+    for (int table = 0; table < 2; table++) {
+        if (!has_bytes(w, length, *offset, 2)) return FALSE;
+        count = read_u16(p + *offset);
+        put_u16(w, count);
+        *offset += 2;
+
+        for (guint16 i = 0; i < count; i++) {
+            if (!copy_ref(w, p, length, offset) ||
+                    !copy_raw(w, p, length, offset, 2) ||
+                    !copy_refs(w, p, length, offset))
+                return FALSE;
+        }
+    }
+
+    // uses
+    if (!copy_refs(w, p, length, offset)) return FALSE;
+
+    // provides: service and implementations
+    if (!has_bytes(w, length, *offset, 2)) return FALSE;
+    count = read_u16(p + *offset);
+    put_u16(w, count);
+    *offset += 2;
+
+    for (guint16 i = 0; i < count; i++) {
+        if (!copy_ref(w, p, length, offset) ||
+                !copy_refs(w, p, length, offset))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Copy the payload of an attribute with the constant pool indices in it
+ * renumbered. The indices keep their size, so the length doesn't change.
+ */
+static void copy_attribute_info(class_writer *w, attribute_info *attribute)
+{
+    const guchar *p = attribute->info;
+    guint32 length = attribute->attribute_length;
+    guint32 offset = 0;
+    guint16 count = 0;
+
+    switch (attribute->_kind) {
+        case ATTRIBUTE_SIGNATURE:
+        case ATTRIBUTE_CONSTANT_VALUE:
+            if (!has_bytes(w, length, 0, 2)) return;
+            copy_index(w, p);
+            offset = 2;
+            break;
+        case ATTRIBUTE_EXCEPTIONS:
+            if (!has_bytes(w, length, 0, 2)) return;
+            count = read_u16(p);
+            put_u16(w, count);
+            offset = 2;
+            if (!has_bytes(w, length, offset, count * 2)) return;
+
+            for (guint16 i = 0; i < count; i++, offset += 2) {
+                copy_index(w, p + offset);
+            }
+            break;
+        case ATTRIBUTE_INNER_CLASSES:
+            if (!has_bytes(w, length, 0, 2)) return;
+            count = read_u16(p);
+            put_u16(w, count);
+            offset = 2;
+            if (!has_bytes(w, length, offset, count * 8)) return;
+
+            for (guint16 i = 0; i < count; i++, offset += 8) {
+                copy_index(w, p + offset);       // inner class
+                copy_index(w, p + offset + 2);   // outer class
+                copy_index(w, p + offset + 4);   // simple name
+                put_bytes(w, p + offset + 6, 2); // access flags
+            }
+            break;
+        case ATTRIBUTE_VISIBLE_ANNOTATIONS:
+        case ATTRIBUTE_INVISIBLE_ANNOTATIONS:
+            if (!has_bytes(w, length, 0, 2)) return;
+            count = read_u16(p);
+            put_u16(w, count);
+            offset = 2;
+
+            for (guint16 i = 0; i < count; i++) {
+                if (!copy_annotation(w, p, length, &offset, 0)) return;
+            }
+            break;
+        case ATTRIBUTE_VISIBLE_PARAMETER_ANNOTATIONS:
+        case ATTRIBUTE_INVISIBLE_PARAMETER_ANNOTATIONS:
+            if (!has_bytes(w, length, 0, 1)) return;
+            put_u8(w, p[0]);
+            offset = 1;
+
+            for (guint8 i = 0; i < p[0]; i++) {
+                if (!has_bytes(w, length, offset, 2)) return;
+                count = read_u16(p + offset);
+                put_u16(w, count);
+                offset += 2;
+
+                for (guint16 j = 0; j < count; j++) {
+                    if (!copy_annotation(w, p, length, &offset, 0)) return;
+                }
+            }
+            break;
+        case ATTRIBUTE_ANNOTATION_DEFAULT:
+            if (!copy_element_value(w, p, length, &offset, 0)) return;
+            break;
+        case ATTRIBUTE_ENCLOSING_METHOD:
+            if (!has_bytes(w, length, 0, 4)) return;
+            copy_index(w, p);       // class
+            copy_index(w, p + 2);   // method, 0 outside of methods
+            offset = 4;
+            break;
+        case ATTRIBUTE_NEST_HOST:
+        case ATTRIBUTE_MODULE_MAIN_CLASS:
+            if (!copy_ref(w, p, length, &offset)) return;
+            break;
+        case ATTRIBUTE_NEST_MEMBERS:
+        case ATTRIBUTE_PERMITTED_SUBCLASSES:
+        case ATTRIBUTE_MODULE_PACKAGES:
+            if (!copy_refs(w, p, length, &offset)) return;
+            break;
+        case ATTRIBUTE_MODULE:
+            if (!copy_module(w, p, length, &offset)) return;
+            break;
+        case ATTRIBUTE_RECORD:
+            if (!has_bytes(w, length, 0, 2)) return;
+            count = read_u16(p);
+            put_u16(w, count);
+            offset = 2;
+
+            // name, descriptor and attributes of each component
+            for (guint16 i = 0; i < count; i++) {
+                if (!copy_ref(w, p, length, &offset) ||
+                        !copy_ref(w, p, length, &offset) ||
+                        !copy_component_attributes(w, p, length, &offset))
+                    return;
+            }
+            break;
+        case ATTRIBUTE_METHOD_PARAMETERS:
+            if (!has_bytes(w, length, 0, 1)) return;
+            put_u8(w, p[0]);
+            offset = 1;
+
+            // name (0 if it has none) and access flags
+            for (guint8 i = 0; i < p[0]; i++) {
+                if (!copy_ref(w, p, length, &offset) ||
+                        !copy_raw(w, p, length, &offset, 2))
+                    return;
+            }
+            break;
+        case ATTRIBUTE_VISIBLE_TYPE_ANNOTATIONS:
+        case ATTRIBUTE_INVISIBLE_TYPE_ANNOTATIONS:
+            if (!has_bytes(w, length, 0, 2)) return;
+            count = read_u16(p);
+            put_u16(w, count);
+            offset = 2;
+
+            for (guint16 i = 0; i < count; i++) {
+                if (!copy_type_annotation(w, p, length, &offset)) return;
+            }
+            break;
+        case ATTRIBUTE_DEPRECATED:
+        case ATTRIBUTE_SYNTHETIC:
+            break;
+        default:
+            // Code, SourceFile, BootstrapMethods and unknown attributes are
+            // never written when stripping
+            g_assert_not_reached();
+    }
+
+    if (offset != length) w->malformed = TRUE;
+}
+
+/*
+ * Is an attribute written? Without stripping every attribute is written
+ * back as it was.
+ */
+static gboolean keep_attribute(class_writer *w, attribute_info *attribute)
+{
+    if (w->strip) {
+        return attribute->_kind != ATTRIBUTE_UNKNOWN &&
+            attribute->_kind != ATTRIBUTE_CODE &&
+            attribute->_kind != ATTRIBUTE_SOURCEFILE &&
+            attribute->_kind != ATTRIBUTE_BOOTSTRAP_METHODS;
+    }
+
+    return TRUE;
+}
+
+static void write_attributes(class_writer *w, attribute_info *attributes,
+        guint16 count)
+{
+    guint16 kept = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (keep_attribute(w, &attributes[i])) kept++;
+    }
+
+    put_u16(w, kept);
+
+    for (int i = 0; i < count; i++) {
+        attribute_info *attribute = &attributes[i];
+
+        if (!keep_attribute(w, attribute)) continue;
+
+        put_index(w, attribute->attribute_name_index);
+        put_u32(w, attribute->attribute_length);
+
+        if (w->strip) {
+            copy_attribute_info(w, attribute);
+        } else {
+            put_bytes(w, attribute->info, attribute->attribute_length);
+        }
+    }
+}
+
+/*
+ * Is a field or method written?
+ */
+static gboolean keep_member(class_writer *w, guint16 access_flags,
+        guint16 name_index)
+{
+    if (!w->strip) return TRUE;
+    if (access_flags & ACC_PRIVATE) return FALSE;
+
+    return name_index >= w->c->constant_pool_count ||
+        w->c->cp_tags[name_index] != TAG_UTF8 ||
+        strcmp(javaclass_cp_string(w->c, name_index), "<clinit>") != 0;
+}
+
+/*
+ * Write everything after the constant pool
+ */
+static void write_body(class_writer *w)
+{
+    JavaClass *c = w->c;
+    guint16 kept = 0;
+
+    put_u16(w, c->access_flags);
+    put_index(w, c->this_class);
+
+    if (c->super_class != INVALID_INDEX) {
+        put_index(w, c->super_class);
+    } else {
+        put_u16(w, 0);
+    }
+
+    put_u16(w, c->interfaces_count);
+    for (int i = 0; i < c->interfaces_count; i++) {
+        put_index(w, c->interfaces[i]);
+    }
+
+    for (int i = 0; i < c->fields_count; i++) {
+        if (keep_member(w, c->fields[i].access_flags, c->fields[i].name_index))
+            kept++;
+    }
+
+    put_u16(w, kept);
+
+    for (int i = 0; i < c->fields_count; i++) {
+        field_info *field = &c->fields[i];
+
+        if (!keep_member(w, field->access_flags, field->name_index)) continue;
+
+        put_u16(w, field->access_flags);
+        put_index(w, field->name_index);
+        put_index(w, field->descriptor_index);
+        write_attributes(w, field->attributes, field->attributes_count);
+    }
+
+    kept = 0;
+    for (int i = 0; i < c->methods_count; i++) {
+        if (keep_member(w, c->methods[i].access_flags,
+                    c->methods[i].name_index))
+            kept++;
+    }
+
+    put_u16(w, kept);
+
+    for (int i = 0; i < c->methods_count; i++) {
+        method_info *method = &c->methods[i];
+
+        if (!keep_member(w, method->access_flags, method->name_index))
+            continue;
+
+        put_u16(w, method->access_flags);
+        put_index(w, method->name_index);
+        put_index(w, method->descriptor_index);
+        write_attributes(w, method->attributes, method->attributes_count);
+    }
+
+    write_attributes(w, c->attributes, c->attributes_count);
+}
+
+/*
+ * Were the payloads of all attributes kept?
+ */
+static gboolean has_payloads(attribute_info *attributes, guint16 count)
+{
+    for (int i = 0; i < count; i++) {
+        if (attributes[i].info == NULL && attributes[i].attribute_length > 0)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Can the class be written back unstripped? That needs the payloads of all
+ * attributes and the bytecode of every method that has some, which only a
+ * class parsed with its bytecode has.
+ */
+static gboolean is_complete(JavaClass *c)
+{
+    if (!has_payloads(c->attributes, c->attributes_count)) return FALSE;
+
+    for (int i = 0; i < c->fields_count; i++) {
+        if (!has_payloads(c->fields[i].attributes,
+                    c->fields[i].attributes_count))
+            return FALSE;
+    }
+
+    for (int i = 0; i < c->methods_count; i++) {
+        method_info *method = &c->methods[i];
+        gboolean found = FALSE;
+
+        if (!has_payloads(method->attributes, method->attributes_count))
+            return FALSE;
+
+        if (method->access_flags & (ACC_ABSTRACT | ACC_NATIVE)) continue;
+
+        for (int j = 0; j < method->attributes_count; j++) {
+            if (method->attributes[j]._kind == ATTRIBUTE_CODE) found = TRUE;
+        }
+
+        if (!found) return FALSE;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Write the constant pool, only the used constants when stripping
+ */
+static void write_constant_pool(class_writer *w)
+{
+    JavaClass *c = w->c;
+    guint16 count = 0;
+
+    for (guint16 i = 0; i < c->constant_pool_count; i++) {
+        if (!w->strip || w->marks[i]) count++;
+    }
+
+    put_u16(w, count + 1);
+
+    for (guint16 i = 0; i < c->constant_pool_count; i++) {
+        cp_value *value = &c->cp_values[i];
+        const gchar *string = NULL;
+        gsize len = 0;
+
+        if (w->strip && !w->marks[i]) continue;
+
+        put_u8(w, c->cp_tags[i]);
+
+        switch (c->cp_tags[i]) {
+            case TAG_UTF8:
+                string = javaclass_cp_string(c, i);
+                len = strlen(string);
+                put_u16(w, len);
+                put_bytes(w, string, len);
+                break;
+            case TAG_INTEGER:
+            case TAG_FLOAT:
+                put_u32(w, (guint32) value->i);
+                break;
+            case TAG_LONG:
+            case TAG_DOUBLE:
+                put_u32(w, value->word);
+                put_u32(w, c->cp_values[i + 1].word);
+                i++;
+                break;
+            case TAG_CLASS:
+            case TAG_STRING:
+            case TAG_METHODTYPE:
+            case TAG_MODULE:
+            case TAG_PACKAGE:
+                put_index(w, value->index);
+                break;
+            case TAG_METHODHANDLE:
+                put_u8(w, value->handle.kind);
+                put_index(w, value->handle.index);
+                break;
+            case TAG_DYNAMIC:
+            case TAG_INVOKEDYNAMIC:
+                put_u16(w, value->indexpair[0]);
+                put_index(w, value->indexpair[1]);
+                break;
+            default:
+                put_index(w, value->indexpair[0]);
+                put_index(w, value->indexpair[1]);
+                break;
+        }
+    }
+}
+
+GBytes* javaclass_write(JavaClass *c, guint flags, GError **error)
+{
+    class_writer w;
+
+    memset(&w, 0, sizeof(w));
+    w.c = c;
+    w.strip = flags & JAVACLASS_WRITE_STRIP ? TRUE : FALSE;
+
+    if (!w.strip && !is_complete(c)) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_CLASS,
+                "Error writing class %s: Bytecode or attributes missing, "
+                "parse the class with its bytecode or strip it\n",
+                javaclass_get_fq_name(c));
+        return NULL;
+    }
+
+    if (w.strip) {
+        guint16 next = 1;
+
+        // find the constants that are still used
+        w.marks = g_new0(guint8, c->constant_pool_count);
+        write_body(&w);
+
+        w.remap = g_new0(guint16, c->constant_pool_count);
+        for (guint16 i = 0; i < c->constant_pool_count; i++) {
+            if (w.marks[i]) w.remap[i] = next++;
+        }
+    }
+
+    if (!w.malformed) {
+        w.out = g_byte_array_sized_new(1024);
+
+        put_u32(&w, c->magic_number);
+        put_u16(&w, c->minor_version);
+        put_u16(&w, c->major_version);
+        write_constant_pool(&w);
+        write_body(&w);
+    }
+
+    g_free(w.marks);
+    g_free(w.remap);
+
+    if (w.malformed) {
+        if (w.out != NULL) g_byte_array_free(w.out, TRUE);
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_CLASS,
+                "Error writing class %s: Malformed attribute or constant\n",
+                javaclass_get_fq_name(c));
+        return NULL;
+    }
+
+    return g_byte_array_free_to_bytes(w.out);
+}
+
+gboolean javaclass_write_file(JavaClass *c, guint flags,
+        const gchar *filename, GError **error)
+{
+    GBytes *bytes = javaclass_write(c, flags, error);
+    gsize length = 0;
+    const gchar *data = NULL;
+    gboolean success = FALSE;
+
+    if (bytes == NULL) return FALSE;
+
+    data = g_bytes_get_data(bytes, &length);
+    success = g_file_set_contents(filename, data, length, error);
+    g_bytes_unref(bytes);
+
+    return success;
+}
@@ -0,0 +1,378 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "javaclones.h"
+#include "javabytecode.h"
+#include "javaprivate.h"
+
+// the signature is cut into LSH_BANDS bands of LSH_ROWS values
+#define LSH_BANDS 8
+#define LSH_ROWS (JAVACLONES_SIGNATURE_SIZE / LSH_BANDS)
+
+#define OPCODE_LDC_W   19
+#define OPCODE_GOTO    167
+#define OPCODE_JSR     168
+#define OPCODE_GOTO_W  200
+#define OPCODE_JSR_W   201
+
+#define ROLLING_PRIME G_GUINT64_CONSTANT(0x100000001b3)
+
+struct _JavaCloneIndex
+{
+    GArray *fingerprints;       // JavaMethodFingerprint by id
+    GPtrArray *locations;       // by id, stored in names
+    GStringChunk *names;
+    GHashTable *bands[LSH_BANDS];   // band hash -> GArray of ids
+};
+
+static guint64 mix64(guint64 x)
+{
+    x ^= x >> 33;
+    x *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    x ^= x >> 33;
+    x *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    x ^= x >> 33;
+
+    return x;
+}
+
+static guint64 combine(guint64 hash, guint64 value)
+{
+    return mix64(hash ^ (value + G_GUINT64_CONSTANT(0x9e3779b97f4a7c15)));
+}
+
+/*
+ * The hash of an instruction without what depends on the layout of the
+ * class or the code: constant pool indexes and branch offsets
+ */
+static guint64 instruction_token(JavaClass *c, const guchar *code,
+        const JavaInstruction *insn)
+{
+    guint8 opcode = insn->opcode;
+    guint64 operand = 0;
+    guint32 skip = insn->wide ? 2 : 1;
+
+    // the wide forms only exist because of the layout
+    if (opcode == OPCODE_LDC_W) opcode = JAVABYTECODE_LDC;
+    if (opcode == OPCODE_GOTO_W) opcode = OPCODE_GOTO;
+    if (opcode == OPCODE_JSR_W) opcode = OPCODE_JSR;
+
+    switch (insn->operand) {
+        case JAVABYTECODE_OPERAND_CONSTANT:
+            operand = javahash_constant(c, insn->cp_index, 0);
+            break;
+        case JAVABYTECODE_OPERAND_LOCAL:
+        case JAVABYTECODE_OPERAND_IMMEDIATE:
+            operand = javahash_bytes(code + insn->offset + skip,
+                    insn->length - skip, 0);
+            break;
+        default:
+            break;
+    }
+
+    return combine(opcode, operand);
+}
+
+/*
+ * Fold a shingle into the signature, every position uses its own
+ * multiply-xorshift permutation of the shingle hash
+ */
+static void signature_add(guint32 *signature, guint64 shingle)
+{
+    guint32 h = (guint32) (shingle ^ (shingle >> 32));
+
+    // written so that the compiler can vectorize it
+    for (guint32 j = 0; j < JAVACLONES_SIGNATURE_SIZE; j++) {
+        guint32 v = (h ^ (0x9e3779b9U * (j + 1))) *
+            ((0x85ebca6bU + j * 0x1b873594U) | 1);
+        v ^= v >> 16;
+        signature[j] = MIN(signature[j], v);
+    }
+}
+
+gboolean javaclones_fingerprint(JavaClass *c, guint16 i,
+        JavaMethodFingerprint *fingerprint)
+{
+    attribute_info *attr = NULL;
+    const guchar *code = NULL;
+    guint32 codelen = 0;
+    guint32 offset = 0;
+    guint64 window[JAVACLONES_SHINGLE_SIZE];
+    guint64 rolling = 0;
+    guint64 power = 1;      // ROLLING_PRIME^(JAVACLONES_SHINGLE_SIZE - 1)
+    guint32 n = 0;
+
+    g_return_val_if_fail(i < c->methods_count, FALSE);
+
+    for (guint16 j = 0; j < c->methods[i].attributes_count; j++) {
+        if (c->methods[i].attributes[j]._kind == ATTRIBUTE_CODE) {
+            attr = &c->methods[i].attributes[j];
+        }
+    }
+
+    // u2 max_stack, u2 max_locals, u4 code_length, code
+    if (attr == NULL || attr->info == NULL || attr->attribute_length < 8) {
+        return FALSE;
+    }
+
+    code = attr->info + 8;
+    codelen = ((guint32) attr->info[4] << 24) | (attr->info[5] << 16) |
+        (attr->info[6] << 8) | attr->info[7];
+    if (codelen > attr->attribute_length - 8) return FALSE;
+
+    for (int j = 1; j < JAVACLONES_SHINGLE_SIZE; j++) power *= ROLLING_PRIME;
+
+    memset(fingerprint->signature, 0xff, sizeof(fingerprint->signature));
+    fingerprint->hash = 0;
+
+    while (offset < codelen) {
+        JavaInstruction insn;
+        guint32 length = javabytecode_decode(code, codelen, offset, &insn);
+        guint64 token = 0;
+
+        if (length == 0) break;
+
+        token = instruction_token(c, code, &insn);
+        fingerprint->hash = combine(fingerprint->hash, token);
+
+        // slide the window: drop the oldest token, add the new one
+        if (n >= JAVACLONES_SHINGLE_SIZE) {
+            rolling -= window[n % JAVACLONES_SHINGLE_SIZE] * power;
+        }
+        rolling = rolling * ROLLING_PRIME + token;
+        window[n % JAVACLONES_SHINGLE_SIZE] = token;
+        n++;
+
+        if (n >= JAVACLONES_SHINGLE_SIZE) {
+            signature_add(fingerprint->signature, mix64(rolling));
+        }
+
+        offset += length;
+    }
+
+    // methods shorter than a shingle are a single shingle
+    if (n > 0 && n < JAVACLONES_SHINGLE_SIZE) {
+        signature_add(fingerprint->signature, mix64(rolling));
+    }
+
+    fingerprint->instructions = n;
+    fingerprint->hash = combine(fingerprint->hash, n);
+
+    return TRUE;
+}
+
+gdouble javaclones_similarity(const JavaMethodFingerprint *a,
+        const JavaMethodFingerprint *b)
+{
+    guint equal = 0;
+
+    for (guint j = 0; j < JAVACLONES_SIGNATURE_SIZE; j++) {
+        if (a->signature[j] == b->signature[j]) equal++;
+    }
+
+    return (gdouble) equal / JAVACLONES_SIGNATURE_SIZE;
+}
+
+/*
+ * Index
+ */
+
+static gpointer band_key(const JavaMethodFingerprint *fingerprint, guint band)
+{
+    guint64 hash = band;
+
+    for (guint j = 0; j < LSH_ROWS; j++) {
+        hash = combine(hash, fingerprint->signature[band * LSH_ROWS + j]);
+    }
+
+    // buckets that share the truncated hash are told apart by the similarity
+    return GUINT_TO_POINTER((guint) hash);
+}
+
+static void ids_free(gpointer data)
+{
+    g_array_free(data, TRUE);
+}
+
+JavaCloneIndex* javacloneindex_new(void)
+{
+    JavaCloneIndex *index = g_new0(JavaCloneIndex, 1);
+
+    index->fingerprints = g_array_new(FALSE, FALSE,
+            sizeof(JavaMethodFingerprint));
+    index->locations = g_ptr_array_new();
+    index->names = g_string_chunk_new(64 * 1024);
+
+    for (guint band = 0; band < LSH_BANDS; band++) {
+        index->bands[band] = g_hash_table_new_full(g_direct_hash,
+                g_direct_equal, NULL, ids_free);
+    }
+
+    return index;
+}
+
+guint32 javacloneindex_add(JavaCloneIndex *index,
+        const JavaMethodFingerprint *fingerprint, const gchar *location)
+{
+    guint32 id = index->fingerprints->len;
+
+    g_array_append_val(index->fingerprints, *fingerprint);
+    g_ptr_array_add(index->locations,
+            g_string_chunk_insert(index->names, location));
+
+    for (guint band = 0; band < LSH_BANDS; band++) {
+        gpointer key = band_key(fingerprint, band);
+        GArray *ids = g_hash_table_lookup(index->bands[band], key);
+
+        if (ids == NULL) {
+            ids = g_array_sized_new(FALSE, FALSE, sizeof(guint32), 1);
+            g_hash_table_insert(index->bands[band], key, ids);
+        }
+
+        g_array_append_val(ids, id);
+    }
+
+    return id;
+}
+
+guint javacloneindex_add_class(JavaCloneIndex *index, JavaClass *c)
+{
+    JavaMethod **methods = javaclass_get_methods(c);
+    GString *location = g_string_new(NULL);
+    guint added = 0;
+
+    for (guint16 i = 0; i < c->methods_count; i++) {
+        JavaMethodFingerprint fingerprint;
+
+        if (!javaclones_fingerprint(c, i, &fingerprint) ||
+                fingerprint.instructions < JAVACLONES_MIN_INSTRUCTIONS) {
+            continue;
+        }
+
+        g_string_printf(location, "%s.%s%s", javaclass_get_fq_name(c),
+                methods[i]->name, methods[i]->descriptor);
+        javacloneindex_add(index, &fingerprint, location->str);
+        added++;
+    }
+
+    g_string_free(location, TRUE);
+
+    return added;
+}
+
+guint32 javacloneindex_get_method_number(JavaCloneIndex *index)
+{
+    return index->fingerprints->len;
+}
+
+const gchar* javacloneindex_get_location(JavaCloneIndex *index, guint32 id)
+{
+    g_return_val_if_fail(id < index->locations->len, NULL);
+
+    return g_ptr_array_index(index->locations, id);
+}
+
+const JavaMethodFingerprint* javacloneindex_get_fingerprint(
+        JavaCloneIndex *index, guint32 id)
+{
+    g_return_val_if_fail(id < index->fingerprints->len, NULL);
+
+    return &g_array_index(index->fingerprints, JavaMethodFingerprint, id);
+}
+
+static gint compare_ids(gconstpointer a, gconstpointer b)
+{
+    guint32 x = *(const guint32*) a;
+    guint32 y = *(const guint32*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+static gint compare_matches(gconstpointer a, gconstpointer b)
+{
+    const JavaCloneMatch *x = a;
+    const JavaCloneMatch *y = b;
+
+    if (x->similarity != y->similarity) {
+        return x->similarity > y->similarity ? -1 : 1;
+    }
+
+    return x->id < y->id ? -1 : x->id > y->id;
+}
+
+JavaCloneMatch* javacloneindex_query(JavaCloneIndex *index,
+        const JavaMethodFingerprint *fingerprint, gdouble min_similarity,
+        guint *n_matches)
+{
+    GArray *candidates = g_array_new(FALSE, FALSE, sizeof(guint32));
+    GArray *matches = g_array_new(FALSE, FALSE, sizeof(JavaCloneMatch));
+    guint32 previous = G_MAXUINT32;
+
+    for (guint band = 0; band < LSH_BANDS; band++) {
+        GArray *ids = g_hash_table_lookup(index->bands[band],
+                band_key(fingerprint, band));
+
+        if (ids != NULL) g_array_append_vals(candidates, ids->data, ids->len);
+    }
+
+    // a method is usually a candidate in several bands
+    qsort(candidates->data, candidates->len, sizeof(guint32), compare_ids);
+
+    for (guint i = 0; i < candidates->len; i++) {
+        guint32 id = g_array_index(candidates, guint32, i);
+        const JavaMethodFingerprint *other = NULL;
+        JavaCloneMatch match;
+
+        if (id == previous) continue;
+        previous = id;
+
+        other = &g_array_index(index->fingerprints, JavaMethodFingerprint,
+                id);
+        match.id = id;
+        match.similarity = javaclones_similarity(fingerprint, other);
+        match.exact = other->hash == fingerprint->hash &&
+            other->instructions == fingerprint->instructions;
+
+        if (match.similarity >= min_similarity) {
+            g_array_append_val(matches, match);
+        }
+    }
+
+    g_array_free(candidates, TRUE);
+    g_array_sort(matches, compare_matches);
+
+    *n_matches = matches->len;
+
+    return (JavaCloneMatch*) g_array_free(matches, matches->len == 0);
+}
+
+void javacloneindex_free(JavaCloneIndex *index)
+{
+    if (index != NULL) {
+        for (guint band = 0; band < LSH_BANDS; band++) {
+            g_hash_table_destroy(index->bands[band]);
+        }
+
+        g_array_free(index->fingerprints, TRUE);
+        g_ptr_array_free(index->locations, TRUE);
+        g_string_chunk_free(index->names);
+        g_free(index);
+    }
+}
@@ -0,0 +1,194 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javacodestats.h"
+#include "javaprivate.h"
+
+#define OPCODE_WORDS ((JAVABYTECODE_OPCODE_COUNT + 63) / 64)
+
+static guint16 get_u16(const guchar *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static guint32 get_u32(const guchar *p)
+{
+    return ((guint32) p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+void javacodestats_init(JavaCodeStats *stats)
+{
+    memset(stats, 0, sizeof(JavaCodeStats));
+}
+
+guint javacodestats_get_bucket(guint32 value)
+{
+    guint bucket = 0;
+
+    while (value != 0 && bucket < JAVACODESTATS_BUCKET_COUNT - 1) {
+        value >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+/*
+ * Count the instructions of a code array, returns FALSE if it can't be
+ * decoded to its end
+ */
+static gboolean add_code(JavaCodeStats *stats, const guchar *code,
+        guint32 codelen)
+{
+    guint64 used[OPCODE_WORDS] = {0};
+    guint32 offset = 0;
+    gboolean valid = TRUE;
+
+    while (offset < codelen) {
+        JavaInstruction insn;
+        guint32 length = javabytecode_decode(code, codelen, offset, &insn);
+
+        if (length == 0) {
+            valid = FALSE;
+            break;
+        }
+
+        stats->instructions++;
+        stats->opcodes[insn.opcode]++;
+        used[insn.opcode / 64] |= G_GUINT64_CONSTANT(1) << (insn.opcode % 64);
+
+        if (insn.wide) {
+            stats->opcodes[JAVABYTECODE_WIDE]++;
+            used[JAVABYTECODE_WIDE / 64] |=
+                G_GUINT64_CONSTANT(1) << (JAVABYTECODE_WIDE % 64);
+        }
+
+        offset += length;
+    }
+
+    for (guint i = 0; i < JAVABYTECODE_OPCODE_COUNT; i++) {
+        if (used[i / 64] & (G_GUINT64_CONSTANT(1) << (i % 64))) {
+            stats->methods_using[i]++;
+        }
+    }
+
+    return valid;
+}
+
+/*
+ * Count a "Code" attribute: u2 max_stack, u2 max_locals, u4 code_length,
+ * code, u2 exception_table_length, exception table, attributes
+ */
+static void add_code_attribute(JavaCodeStats *stats, attribute_info *attr)
+{
+    const guchar *p = attr->info;
+    guint32 codelen = 0;
+
+    if (p == NULL || attr->attribute_length < 8) {
+        stats->invalid_methods++;
+        return;
+    }
+
+    codelen = get_u32(p + 4);
+    if (codelen > attr->attribute_length - 8) {
+        stats->invalid_methods++;
+        return;
+    }
+
+    stats->methods++;
+    stats->code_bytes += codelen;
+    stats->max_stack[javacodestats_get_bucket(get_u16(p))]++;
+    stats->max_locals[javacodestats_get_bucket(get_u16(p + 2))]++;
+    stats->code_sizes[javacodestats_get_bucket(codelen)]++;
+
+    if (attr->attribute_length - 8 - codelen >= 2) {
+        stats->exception_handlers += get_u16(p + 8 + codelen);
+    }
+
+    if (!add_code(stats, p + 8, codelen)) stats->invalid_methods++;
+}
+
+void javacodestats_add_class(JavaCodeStats *stats, JavaClass *c)
+{
+    stats->classes++;
+
+    for (guint16 i = 0; i < c->methods_count; i++) {
+        method_info *method = &c->methods[i];
+
+        for (guint16 j = 0; j < method->attributes_count; j++) {
+            if (method->attributes[j]._kind == ATTRIBUTE_CODE) {
+                add_code_attribute(stats, &method->attributes[j]);
+            }
+        }
+    }
+}
+
+static void add_counters(guint64 *sum, const guint64 *counters, guint n)
+{
+    for (guint i = 0; i < n; i++) sum[i] += counters[i];
+}
+
+void javacodestats_merge(JavaCodeStats *stats, const JavaCodeStats *other)
+{
+    // the structure is nothing but guint64 counters
+    add_counters((guint64*) stats, (const guint64*) other,
+            sizeof(JavaCodeStats) / sizeof(guint64));
+}
+
+/*
+ * Every parser thread counts into its own statistics
+ */
+static void count_class(guint worker, const gchar *location, JavaClass *c,
+        gpointer user_data)
+{
+    JavaCodeStats **partials = user_data;
+
+    javacodestats_add_class(partials[worker], c);
+}
+
+static void ignore_class(const gchar *location, JavaClass *c,
+        const GError *error, gpointer user_data)
+{
+}
+
+void javacodestats_collect(JavaCodeStats *stats, JavaPipeline *pipeline,
+        JavaPipelineFunc func, gpointer user_data,
+        JavaPipelineStats *pipelinestats)
+{
+    guint n_workers = javapipeline_get_worker_number(pipeline);
+    JavaCodeStats **partials = g_new(JavaCodeStats*, n_workers);
+
+    // separate allocations keep the threads off each other's cache lines
+    for (guint i = 0; i < n_workers; i++) {
+        partials[i] = g_new0(JavaCodeStats, 1);
+    }
+
+    javapipeline_set_include_code(pipeline, TRUE);
+    javapipeline_set_worker_func(pipeline, count_class, partials);
+    javapipeline_run(pipeline, func != NULL ? func : ignore_class, user_data,
+            pipelinestats);
+    javapipeline_set_worker_func(pipeline, NULL, NULL);
+
+    for (guint i = 0; i < n_workers; i++) {
+        javacodestats_merge(stats, partials[i]);
+        g_free(partials[i]);
+    }
+
+    g_free(partials);
+}
@@ -0,0 +1,663 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "javacolumns.h"
+#include "javaprivate.h"
+
+#define MAGIC "JCOL"
+#define HEADER_SIZE 8
+#define TRAILER_SIZE 16
+#define CHUNK_ENTRY_SIZE 32
+#define MAX_COLUMNS JAVACOLUMNS_CLASS_COLUMN_COUNT
+
+#define CODEC_NONE 0
+#define CODEC_ZLIB 1
+
+/*
+ * Number of columns and their widths in bytes for every table
+ */
+static const guint column_count[JAVACOLUMNS_TABLE_COUNT] = {
+    JAVACOLUMNS_CLASS_COLUMN_COUNT,
+    JAVACOLUMNS_FIELD_COLUMN_COUNT,
+    JAVACOLUMNS_METHOD_COLUMN_COUNT,
+    JAVACOLUMNS_STRING_COLUMN_COUNT
+};
+
+static const guint8 column_width[JAVACOLUMNS_TABLE_COUNT][MAX_COLUMNS] = {
+    {2, 4, 4, 2, 2, 2, 2, 2, 4},
+    {4, 2, 4, 4},
+    {4, 2, 4, 4, 4, 2},
+    {4, 1}
+};
+
+typedef struct _chunk_entry
+{
+    guint8 table;
+    guint8 column;
+    guint8 codec;
+    guint8 width;
+    guint32 rows;
+    guint64 offset;
+    guint64 stored_size;
+    guint64 size;
+} chunk_entry;
+
+struct _JavaColumnWriter
+{
+    gchar *filename;
+    FILE *file;
+    guint64 pos;
+    gboolean failed;
+
+    // the current row group of every table
+    GByteArray *columns[JAVACOLUMNS_TABLE_COUNT][MAX_COLUMNS];
+    guint32 rows[JAVACOLUMNS_TABLE_COUNT];
+    guint32 n_classes;
+
+    GArray *chunks;            // chunk_entry of every chunk written
+    GByteArray *compressed;    // scratch buffer for compression
+
+    // string dictionary
+    GHashTable *string_ids;    // string -> id + 1
+    GStringChunk *string_data;
+    GPtrArray *strings;        // strings by id
+};
+
+struct _JavaColumnReader
+{
+    GMappedFile *file;
+    GBytes *bytes;
+    const guchar *data;
+    gsize length;
+
+    chunk_entry *chunks;
+    guint32 n_chunks;
+    guint32 rows[JAVACOLUMNS_TABLE_COUNT];
+
+    GBytes *string_offsets;
+    GBytes *string_data;
+    guint32 n_strings;
+};
+
+/*
+ * Writing
+ */
+
+static gboolean write_bytes(JavaColumnWriter *writer, const void *data,
+        gsize size, GError **error)
+{
+    if (size > 0 && fwrite(data, 1, size, writer->file) != size) {
+        int saved_errno = errno;
+        writer->failed = TRUE;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                "Error writing column file %s: %s\n", writer->filename,
+                g_strerror(saved_errno));
+        return FALSE;
+    }
+
+    writer->pos += size;
+
+    return TRUE;
+}
+
+static void put_u16(GByteArray *array, guint16 value)
+{
+    value = GUINT16_TO_LE(value);
+    g_byte_array_append(array, (guint8*) &value, 2);
+}
+
+static void put_u32(GByteArray *array, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    g_byte_array_append(array, (guint8*) &value, 4);
+}
+
+static void put_u64(GByteArray *array, guint64 value)
+{
+    value = GUINT64_TO_LE(value);
+    g_byte_array_append(array, (guint8*) &value, 8);
+}
+
+static guint32 string_id(JavaColumnWriter *writer, const gchar *string)
+{
+    gpointer id = NULL;
+    gchar *copy = NULL;
+
+    if (string == NULL) return 0;
+
+    id = g_hash_table_lookup(writer->string_ids, string);
+    if (id != NULL) return GPOINTER_TO_UINT(id) - 1;
+
+    copy = g_string_chunk_insert(writer->string_data, string);
+    g_ptr_array_add(writer->strings, copy);
+    g_hash_table_insert(writer->string_ids, copy,
+            GUINT_TO_POINTER(writer->strings->len));
+
+    return writer->strings->len - 1;
+}
+
+static gboolean write_chunk(JavaColumnWriter *writer, JavaColumnsTable table,
+        guint column, guint32 rows, GByteArray *values, GError **error)
+{
+    static const guint8 padding[8] = {0};
+    chunk_entry entry;
+    uLongf stored_size = compressBound(values->len);
+    const guint8 *stored = values->data;
+
+    if (writer->pos % 8 != 0 &&
+            !write_bytes(writer, padding, 8 - writer->pos % 8, error)) {
+        return FALSE;
+    }
+
+    entry.table = table;
+    entry.column = column;
+    entry.codec = CODEC_NONE;
+    entry.width = column_width[table][column];
+    entry.rows = rows;
+    entry.offset = writer->pos;
+    entry.size = values->len;
+    entry.stored_size = values->len;
+
+    g_byte_array_set_size(writer->compressed, stored_size);
+    if (compress2(writer->compressed->data, &stored_size, values->data,
+                values->len, Z_DEFAULT_COMPRESSION) == Z_OK &&
+            stored_size < values->len) {
+        entry.codec = CODEC_ZLIB;
+        entry.stored_size = stored_size;
+        stored = writer->compressed->data;
+    }
+
+    if (!write_bytes(writer, stored, entry.stored_size, error)) return FALSE;
+
+    g_array_append_val(writer->chunks, entry);
+
+    return TRUE;
+}
+
+static gboolean flush_table(JavaColumnWriter *writer, JavaColumnsTable table,
+        GError **error)
+{
+    if (writer->rows[table] == 0) return TRUE;
+
+    for (guint i = 0; i < column_count[table]; i++) {
+        if (!write_chunk(writer, table, i, writer->rows[table],
+                    writer->columns[table][i], error)) {
+            return FALSE;
+        }
+
+        g_byte_array_set_size(writer->columns[table][i], 0);
+    }
+
+    writer->rows[table] = 0;
+
+    return TRUE;
+}
+
+static gboolean end_row(JavaColumnWriter *writer, JavaColumnsTable table,
+        GError **error)
+{
+    writer->rows[table]++;
+
+    if (writer->rows[table] == JAVACOLUMNS_ROW_GROUP_SIZE) {
+        return flush_table(writer, table, error);
+    }
+
+    return TRUE;
+}
+
+/*
+ * The bytecode size of a method from its "Code" attribute, which is only
+ * kept if the class was parsed with its bytecode
+ */
+static guint32 method_code_size(JavaClass *c, guint16 i)
+{
+    for (int j = 0; j < c->methods[i].attributes_count; j++) {
+        attribute_info *code = &c->methods[i].attributes[j];
+
+        if (code->_kind == ATTRIBUTE_CODE && code->attribute_length >= 8) {
+            const guchar *p = code->info;
+
+            return ((guint32) p[4] << 24) | ((guint32) p[5] << 16) |
+                ((guint32) p[6] << 8) | (guint32) p[7];
+        }
+    }
+
+    return c->_methods[i]->codelen;
+}
+
+JavaColumnWriter* javacolumnwriter_new(const gchar *filename, GError **error)
+{
+    JavaColumnWriter *writer = NULL;
+    FILE *file = fopen(filename, "wb");
+    guint32 version = GUINT32_TO_LE(JAVACOLUMNS_VERSION);
+
+    if (file == NULL) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                "Error creating column file %s: %s\n", filename,
+                g_strerror(saved_errno));
+        return NULL;
+    }
+
+    writer = g_new0(JavaColumnWriter, 1);
+    writer->filename = g_strdup(filename);
+    writer->file = file;
+    writer->chunks = g_array_new(FALSE, FALSE, sizeof(chunk_entry));
+    writer->compressed = g_byte_array_new();
+    writer->string_ids = g_hash_table_new(g_str_hash, g_str_equal);
+    writer->string_data = g_string_chunk_new(64 * 1024);
+    writer->strings = g_ptr_array_new();
+
+    for (guint t = 0; t < JAVACOLUMNS_TABLE_COUNT; t++) {
+        for (guint i = 0; i < column_count[t]; i++) {
+            writer->columns[t][i] = g_byte_array_new();
+        }
+    }
+
+    string_id(writer, "");
+
+    if (!write_bytes(writer, MAGIC, 4, error) ||
+            !write_bytes(writer, &version, 4, error)) {
+        javacolumnwriter_close(writer, NULL);
+        return NULL;
+    }
+
+    return writer;
+}
+
+gint64 javacolumnwriter_add_class(JavaColumnWriter *writer, JavaClass *c,
+        GError **error)
+{
+    GByteArray **columns = NULL;
+    JavaField **fields = javaclass_get_fields(c);
+    JavaMethod **methods = javaclass_get_methods(c);
+    guint32 id = writer->n_classes;
+    guint32 code_size = 0;
+
+    if (writer->failed) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_IO,
+                "Error writing column file %s: Writer failed earlier\n",
+                writer->filename);
+        return -1;
+    }
+
+    columns = writer->columns[JAVACOLUMNS_TABLE_FIELDS];
+    for (guint16 i = 0; i < c->fields_count; i++) {
+        put_u32(columns[JAVACOLUMNS_FIELD_CLASS], id);
+        put_u16(columns[JAVACOLUMNS_FIELD_ACCESS_FLAGS],
+                fields[i]->access_flags);
+        put_u32(columns[JAVACOLUMNS_FIELD_NAME],
+                string_id(writer, fields[i]->name));
+        put_u32(columns[JAVACOLUMNS_FIELD_DESCRIPTOR],
+                string_id(writer, fields[i]->descriptor));
+
+        if (!end_row(writer, JAVACOLUMNS_TABLE_FIELDS, error)) return -1;
+    }
+
+    columns = writer->columns[JAVACOLUMNS_TABLE_METHODS];
+    for (guint16 i = 0; i < c->methods_count; i++) {
+        guint32 size = method_code_size(c, i);
+        guint16 n_exceptions = 0;
+
+        if (methods[i]->exceptions != NULL) {
+            n_exceptions = g_strv_length(methods[i]->exceptions);
+        }
+
+        put_u32(columns[JAVACOLUMNS_METHOD_CLASS], id);
+        put_u16(columns[JAVACOLUMNS_METHOD_ACCESS_FLAGS],
+                methods[i]->access_flags);
+        put_u32(columns[JAVACOLUMNS_METHOD_NAME],
+                string_id(writer, methods[i]->name));
+        put_u32(columns[JAVACOLUMNS_METHOD_DESCRIPTOR],
+                string_id(writer, methods[i]->descriptor));
+        put_u32(columns[JAVACOLUMNS_METHOD_CODE_SIZE], size);
+        put_u16(columns[JAVACOLUMNS_METHOD_EXCEPTIONS], n_exceptions);
+        code_size += size;
+
+        if (!end_row(writer, JAVACOLUMNS_TABLE_METHODS, error)) return -1;
+    }
+
+    columns = writer->columns[JAVACOLUMNS_TABLE_CLASSES];
+    put_u16(columns[JAVACOLUMNS_CLASS_ACCESS_FLAGS], c->access_flags);
+    put_u32(columns[JAVACOLUMNS_CLASS_NAME],
+            string_id(writer, javaclass_get_fq_name(c)));
+    put_u32(columns[JAVACOLUMNS_CLASS_PARENT],
+            string_id(writer, javaclass_get_fq_parent(c)));
+    put_u16(columns[JAVACOLUMNS_CLASS_MAJOR_VERSION], c->major_version);
+    put_u16(columns[JAVACOLUMNS_CLASS_MINOR_VERSION], c->minor_version);
+    put_u16(columns[JAVACOLUMNS_CLASS_INTERFACES], c->interfaces_count);
+    put_u16(columns[JAVACOLUMNS_CLASS_FIELDS], c->fields_count);
+    put_u16(columns[JAVACOLUMNS_CLASS_METHODS], c->methods_count);
+    put_u32(columns[JAVACOLUMNS_CLASS_CODE_SIZE], code_size);
+    writer->n_classes++;
+
+    if (!end_row(writer, JAVACOLUMNS_TABLE_CLASSES, error)) return -1;
+
+    return id;
+}
+
+/*
+ * Write the string dictionary as the strings table
+ */
+static gboolean write_strings(JavaColumnWriter *writer, GError **error)
+{
+    GByteArray *offsets = writer->columns[JAVACOLUMNS_TABLE_STRINGS][0];
+    GByteArray *data = writer->columns[JAVACOLUMNS_TABLE_STRINGS][1];
+
+    for (guint i = 0; i < writer->strings->len; i++) {
+        const gchar *string = g_ptr_array_index(writer->strings, i);
+
+        put_u32(offsets, data->len);
+        g_byte_array_append(data, (const guint8*) string, strlen(string) + 1);
+    }
+
+    return write_chunk(writer, JAVACOLUMNS_TABLE_STRINGS,
+                JAVACOLUMNS_STRING_OFFSET, writer->strings->len, offsets,
+                error) &&
+        write_chunk(writer, JAVACOLUMNS_TABLE_STRINGS,
+                JAVACOLUMNS_STRING_DATA, data->len, data, error);
+}
+
+static gboolean write_footer(JavaColumnWriter *writer, GError **error)
+{
+    GByteArray *footer = g_byte_array_new();
+    guint64 footer_offset = writer->pos;
+    gboolean success = FALSE;
+
+    for (guint i = 0; i < writer->chunks->len; i++) {
+        chunk_entry *entry = &g_array_index(writer->chunks, chunk_entry, i);
+        guint8 head[4] = {entry->table, entry->column, entry->codec,
+            entry->width};
+
+        g_byte_array_append(footer, head, 4);
+        put_u32(footer, entry->rows);
+        put_u64(footer, entry->offset);
+        put_u64(footer, entry->stored_size);
+        put_u64(footer, entry->size);
+    }
+
+    put_u64(footer, footer_offset);
+    put_u32(footer, writer->chunks->len);
+    g_byte_array_append(footer, (const guint8*) MAGIC, 4);
+
+    success = write_bytes(writer, footer->data, footer->len, error);
+    g_byte_array_free(footer, TRUE);
+
+    return success;
+}
+
+gboolean javacolumnwriter_close(JavaColumnWriter *writer, GError **error)
+{
+    gboolean success = !writer->failed;
+
+    for (guint t = 0; success && t < JAVACOLUMNS_TABLE_STRINGS; t++) {
+        success = flush_table(writer, t, error);
+    }
+
+    success = success && write_strings(writer, error) &&
+        write_footer(writer, error);
+
+    if (fclose(writer->file) != 0 && success) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                "Error writing column file %s: %s\n", writer->filename,
+                g_strerror(saved_errno));
+        success = FALSE;
+    }
+
+    for (guint t = 0; t < JAVACOLUMNS_TABLE_COUNT; t++) {
+        for (guint i = 0; i < column_count[t]; i++) {
+            g_byte_array_free(writer->columns[t][i], TRUE);
+        }
+    }
+
+    g_array_free(writer->chunks, TRUE);
+    g_byte_array_free(writer->compressed, TRUE);
+    g_hash_table_destroy(writer->string_ids);
+    g_string_chunk_free(writer->string_data);
+    g_ptr_array_free(writer->strings, TRUE);
+    g_free(writer->filename);
+    g_free(writer);
+
+    return success;
+}
+
+/*
+ * Reading
+ */
+
+static guint32 get_u32(const guchar *p)
+{
+    guint32 value;
+    memcpy(&value, p, 4);
+    return GUINT32_FROM_LE(value);
+}
+
+static guint64 get_u64(const guchar *p)
+{
+    guint64 value;
+    memcpy(&value, p, 8);
+    return GUINT64_FROM_LE(value);
+}
+
+static gboolean invalid_file(const gchar *filename, const gchar *reason,
+        GError **error)
+{
+    g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+            "Error reading column file %s: %s\n", filename, reason);
+    return FALSE;
+}
+
+static gboolean read_footer(JavaColumnReader *reader, const gchar *filename,
+        GError **error)
+{
+    const guchar *trailer = NULL;
+    guint64 footer_offset = 0;
+    guint64 n_chunks = 0;
+
+    if (reader->length < HEADER_SIZE + TRAILER_SIZE ||
+            memcmp(reader->data, MAGIC, 4) != 0 ||
+            memcmp(reader->data + reader->length - 4, MAGIC, 4) != 0) {
+        return invalid_file(filename, "Not a column file", error);
+    }
+
+    if (get_u32(reader->data + 4) != JAVACOLUMNS_VERSION) {
+        return invalid_file(filename, "Unsupported version", error);
+    }
+
+    trailer = reader->data + reader->length - TRAILER_SIZE;
+    footer_offset = get_u64(trailer);
+    n_chunks = get_u32(trailer + 8);
+
+    if (footer_offset < HEADER_SIZE || footer_offset +
+            n_chunks * CHUNK_ENTRY_SIZE != reader->length - TRAILER_SIZE) {
+        return invalid_file(filename, "Footer out of bounds", error);
+    }
+
+    reader->n_chunks = n_chunks;
+    reader->chunks = g_new(chunk_entry, n_chunks);
+
+    for (guint32 i = 0; i < n_chunks; i++) {
+        const guchar *p = reader->data + footer_offset + i * CHUNK_ENTRY_SIZE;
+        chunk_entry *entry = &reader->chunks[i];
+
+        entry->table = p[0];
+        entry->column = p[1];
+        entry->codec = p[2];
+        entry->width = p[3];
+        entry->rows = get_u32(p + 4);
+        entry->offset = get_u64(p + 8);
+        entry->stored_size = get_u64(p + 16);
+        entry->size = get_u64(p + 24);
+
+        if (entry->table >= JAVACOLUMNS_TABLE_COUNT ||
+                entry->column >= column_count[entry->table] ||
+                entry->width != column_width[entry->table][entry->column] ||
+                entry->codec > CODEC_ZLIB ||
+                entry->size != (guint64) entry->rows * entry->width ||
+                entry->offset > footer_offset ||
+                entry->stored_size > footer_offset - entry->offset ||
+                (entry->codec == CODEC_NONE &&
+                 entry->stored_size != entry->size)) {
+            return invalid_file(filename, "Invalid chunk", error);
+        }
+
+        // the first column of a table counts its rows
+        if (entry->column == 0) reader->rows[entry->table] += entry->rows;
+    }
+
+    return TRUE;
+}
+
+JavaColumnReader* javacolumnreader_open(const gchar *filename,
+        GError **error)
+{
+    JavaColumnReader *reader = NULL;
+    GMappedFile *file = g_mapped_file_new(filename, FALSE, error);
+    const guchar *offsets = NULL;
+    gsize size = 0;
+
+    if (file == NULL) return NULL;
+
+    reader = g_new0(JavaColumnReader, 1);
+    reader->file = file;
+    reader->bytes = g_mapped_file_get_bytes(file);
+    reader->data = g_bytes_get_data(reader->bytes, &reader->length);
+
+    if (!read_footer(reader, filename, error)) goto fail;
+
+    reader->string_offsets = javacolumnreader_read_column(reader,
+            JAVACOLUMNS_TABLE_STRINGS, JAVACOLUMNS_STRING_OFFSET, error);
+    if (reader->string_offsets == NULL) goto fail;
+
+    reader->string_data = javacolumnreader_read_column(reader,
+            JAVACOLUMNS_TABLE_STRINGS, JAVACOLUMNS_STRING_DATA, error);
+    if (reader->string_data == NULL) goto fail;
+
+    // check once that every string lies within the data and is terminated
+    offsets = g_bytes_get_data(reader->string_offsets, NULL);
+    reader->n_strings = reader->rows[JAVACOLUMNS_TABLE_STRINGS];
+    g_bytes_get_data(reader->string_data, &size);
+
+    for (guint32 i = 0; i < reader->n_strings; i++) {
+        guint32 end = i + 1 < reader->n_strings ?
+            get_u32(offsets + (i + 1) * 4) : size;
+
+        if (get_u32(offsets + i * 4) >= end || end > size ||
+                ((const gchar*) g_bytes_get_data(reader->string_data,
+                    NULL))[end - 1] != '\0') {
+            invalid_file(filename, "Invalid string table", error);
+            goto fail;
+        }
+    }
+
+    return reader;
+
+fail:
+    javacolumnreader_free(reader);
+    return NULL;
+}
+
+guint32 javacolumnreader_get_row_number(JavaColumnReader *reader,
+        JavaColumnsTable table)
+{
+    return reader->rows[table];
+}
+
+GBytes* javacolumnreader_read_column(JavaColumnReader *reader,
+        JavaColumnsTable table, guint column, GError **error)
+{
+    chunk_entry *single = NULL;
+    guint n = 0;
+    gsize size = 0;
+    guchar *values = NULL;
+    gsize pos = 0;
+
+    for (guint32 i = 0; i < reader->n_chunks; i++) {
+        chunk_entry *entry = &reader->chunks[i];
+
+        if (entry->table == table && entry->column == column) {
+            single = entry;
+            size += entry->size;
+            n++;
+        }
+    }
+
+    if (n == 1 && single->codec == CODEC_NONE) {
+        return g_bytes_new_from_bytes(reader->bytes, single->offset,
+                single->size);
+    }
+
+    values = g_malloc(size);
+
+    for (guint32 i = 0; i < reader->n_chunks; i++) {
+        chunk_entry *entry = &reader->chunks[i];
+        uLongf length = entry->size;
+
+        if (entry->table != table || entry->column != column) continue;
+
+        if (entry->codec == CODEC_NONE) {
+            memcpy(values + pos, reader->data + entry->offset, entry->size);
+        } else if (uncompress(values + pos, &length,
+                    reader->data + entry->offset, entry->stored_size) != Z_OK ||
+                length != entry->size) {
+            g_set_error(error, JAVACLASS_GERROR,
+                    JAVACLASS_ERROR_INVALID_ARCHIVE,
+                    "Error reading column file: Can't uncompress chunk\n");
+            g_free(values);
+            return NULL;
+        }
+
+        pos += entry->size;
+    }
+
+    return g_bytes_new_take(values, size);
+}
+
+const gchar* javacolumnreader_get_string(JavaColumnReader *reader,
+        guint32 id)
+{
+    const guchar *offsets = NULL;
+    const gchar *data = NULL;
+
+    if (id >= reader->n_strings) return NULL;
+
+    offsets = g_bytes_get_data(reader->string_offsets, NULL);
+    data = g_bytes_get_data(reader->string_data, NULL);
+
+    return data + get_u32(offsets + id * 4);
+}
+
+void javacolumnreader_free(JavaColumnReader *reader)
+{
+    if (reader != NULL) {
+        if (reader->string_offsets != NULL) {
+            g_bytes_unref(reader->string_offsets);
+        }
+        if (reader->string_data != NULL) g_bytes_unref(reader->string_data);
+
+        g_free(reader->chunks);
+        g_bytes_unref(reader->bytes);
+        g_mapped_file_unref(reader->file);
+        g_free(reader);
+    }
+}
@@ -0,0 +1,360 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "javadependencies.h"
+#include "javaprivate.h"
+
+/*
+ * Marks for the UTF-8 entries of the constant pool that name classes
+ */
+#define MARK_CLASSNAME 1 // internal name of a class (or array descriptor)
+#define MARK_SIGNATURE 2 // descriptor or generic signature
+
+/*
+ * A name of the set, stamp tells if it was already collected for the
+ * current class
+ */
+typedef struct _dependency_name
+{
+    gchar *name;
+    guint stamp;
+} dependency_name;
+
+struct _JavaDependencySet
+{
+    GHashTable *names;     // name -> dependency_name
+    JavaArena *arena;      // holds the names and their structs
+    guint stamp;           // incremented for every class
+    const gchar *self;     // name of the current class
+    GString *scratch;      // names being converted to the external format
+    GByteArray *marks;     // one mark per constant pool entry
+    GPtrArray *result;
+};
+
+JavaDependencySet* javadependencyset_new(void)
+{
+    JavaDependencySet *set = g_new(JavaDependencySet, 1);
+
+    set->names = g_hash_table_new(g_str_hash, g_str_equal);
+    set->arena = javaarena_new(64 * 1024);
+    set->stamp = 0;
+    set->self = NULL;
+    set->scratch = g_string_sized_new(256);
+    set->marks = g_byte_array_new();
+    set->result = g_ptr_array_new();
+
+    return set;
+}
+
+/*
+ * Append a class name converting it to the external format
+ */
+static void append_external(GString *str, const gchar *name, gsize len)
+{
+    gsize start = str->len;
+
+    g_string_append_len(str, name, len);
+    for (gsize i = start; i < str->len; i++) {
+        if (str->str[i] == '/') str->str[i] = '.';
+    }
+}
+
+/*
+ * Add the name at the end of the scratch buffer starting at base
+ */
+static void emit(JavaDependencySet *set, gsize base)
+{
+    const gchar *name = set->scratch->str + base;
+    gsize len = set->scratch->len - base;
+    dependency_name *entry = NULL;
+
+    if (len == 0 || strcmp(name, set->self) == 0) return;
+
+    entry = g_hash_table_lookup(set->names, name);
+
+    if (entry == NULL) {
+        entry = javaarena_alloc(set->arena, sizeof(dependency_name));
+        entry->name = javaarena_alloc(set->arena, len + 1);
+        memcpy(entry->name, name, len + 1);
+        entry->stamp = 0;
+
+        g_hash_table_insert(set->names, entry->name, entry);
+    }
+
+    if (entry->stamp != set->stamp) {
+        entry->stamp = set->stamp;
+        g_ptr_array_add(set->result, entry->name);
+    }
+}
+
+static gboolean scan_type(JavaDependencySet *set, const gchar **pp);
+
+/*
+ * Scan a class type like "Ljava/util/Map<TK;TV;>.Entry;"
+ */
+static void scan_class_type(JavaDependencySet *set, const gchar **pp)
+{
+    const gchar *p = *pp + 1; // skip the 'L'
+    gsize base = set->scratch->len;
+
+    for (;;) {
+        const gchar *start = p;
+
+        while (*p != '\0' && *p != ';' && *p != '<' && *p != '.') p++;
+        append_external(set->scratch, start, p - start);
+
+        // type arguments
+        if (*p == '<') {
+            p++;
+
+            while (*p != '\0' && *p != '>') {
+                if (*p == '*') {
+                    p++;
+                    continue;
+                }
+
+                if (*p == '+' || *p == '-') p++;
+                if (!scan_type(set, &p)) break;
+            }
+
+            if (*p == '>') p++;
+        }
+
+        // inner class of a generic outer class
+        if (*p == '.') {
+            g_string_append_c(set->scratch, '$');
+            p++;
+            continue;
+        }
+
+        break;
+    }
+
+    if (*p == ';') {
+        emit(set, base);
+        p++;
+    }
+
+    g_string_truncate(set->scratch, base);
+    *pp = p;
+}
+
+/*
+ * Scan a field type or type argument, returns FALSE if there is none
+ */
+static gboolean scan_type(JavaDependencySet *set, const gchar **pp)
+{
+    switch (**pp) {
+        case 'B': case 'C': case 'D': case 'F':
+        case 'I': case 'J': case 'S': case 'Z': case 'V':
+            (*pp)++;
+            return TRUE;
+        case 'L':
+            scan_class_type(set, pp);
+            return TRUE;
+        case 'T':
+            // type variable
+            while (**pp != '\0' && **pp != ';') (*pp)++;
+            if (**pp == ';') (*pp)++;
+            return TRUE;
+        case '[':
+            (*pp)++;
+            return scan_type(set, pp);
+        default:
+            return FALSE;
+    }
+}
+
+/*
+ * Scan a field or method descriptor or a generic signature of a class, field
+ * or method (descriptors are a subset of signatures)
+ */
+static void scan_signature(JavaDependencySet *set, const gchar *p)
+{
+    // formal type parameters like "<K:Ljava/lang/Object;V::Ljava/io/Closeable;>"
+    if (*p == '<') {
+        p++;
+
+        while (*p != '\0' && *p != '>') {
+            while (*p != '\0' && *p != ':') p++;
+
+            while (*p == ':') {
+                p++;
+                if (*p == 'L' || *p == 'T' || *p == '[') scan_type(set, &p);
+            }
+        }
+
+        if (*p == '>') p++;
+    }
+
+    while (*p != '\0') {
+        if (*p == '(' || *p == ')' || *p == '^') {
+            p++;
+        } else if (!scan_type(set, &p)) {
+            break;
+        }
+    }
+}
+
+/*
+ * Mark a constant pool entry if it is a UTF-8 entry, malformed classes may
+ * refer to anything
+ */
+static void mark_utf8(JavaClass *c, guint8 *marks, guint16 index, guint8 mark)
+{
+    if (index < c->constant_pool_count && c->cp_tags[index] == TAG_UTF8)
+        marks[index] |= mark;
+}
+
+/*
+ * Mark the UTF-8 entry of a "Signature" attribute if there is one
+ */
+static void mark_signature(JavaClass *c, guint8 *marks,
+        attribute_info *attributes, guint16 count)
+{
+    for (int i = 0; i < count; i++) {
+        guint16 index = 0;
+
+        if (attributes[i]._kind != ATTRIBUTE_SIGNATURE ||
+                attributes[i].info == NULL || attributes[i].attribute_length < 2)
+            continue;
+
+        memcpy(&index, attributes[i].info, 2);
+        mark_utf8(c, marks, GUINT16_FROM_BE(index) - 1, MARK_SIGNATURE);
+    }
+}
+
+const gchar** javadependencyset_collect(JavaDependencySet *set, JavaClass *c,
+        guint *n_dependencies)
+{
+    guint8 *marks = NULL;
+    const gchar **result = NULL;
+    gint i = 0;
+
+    set->stamp++;
+    set->self = javaclass_get_fq_name(c);
+    g_ptr_array_set_size(set->result, 0);
+
+    g_byte_array_set_size(set->marks, c->constant_pool_count);
+    marks = set->marks->data;
+    memset(marks, 0, c->constant_pool_count);
+
+    // find all UTF-8 entries that name classes before parsing any of them so
+    // that every entry is parsed only once
+    for (i = javaclass_cp_find_tag(c, TAG_CLASS, 0); i >= 0;
+            i = javaclass_cp_find_tag(c, TAG_CLASS, i + 1)) {
+        mark_utf8(c, marks, c->cp_values[i].index, MARK_CLASSNAME);
+    }
+
+    for (i = javaclass_cp_find_tag(c, TAG_NAMEANDTYPE, 0); i >= 0;
+            i = javaclass_cp_find_tag(c, TAG_NAMEANDTYPE, i + 1)) {
+        mark_utf8(c, marks, c->cp_values[i].indexpair[1], MARK_SIGNATURE);
+    }
+
+    // the descriptors of lambdas and method handle constants
+    for (i = javaclass_cp_find_tag(c, TAG_METHODTYPE, 0); i >= 0;
+            i = javaclass_cp_find_tag(c, TAG_METHODTYPE, i + 1)) {
+        mark_utf8(c, marks, c->cp_values[i].index, MARK_SIGNATURE);
+    }
+
+    for (i = 0; i < c->fields_count; i++) {
+        mark_utf8(c, marks, c->fields[i].descriptor_index, MARK_SIGNATURE);
+        mark_signature(c, marks, c->fields[i].attributes,
+                c->fields[i].attributes_count);
+    }
+
+    for (i = 0; i < c->methods_count; i++) {
+        mark_utf8(c, marks, c->methods[i].descriptor_index, MARK_SIGNATURE);
+        mark_signature(c, marks, c->methods[i].attributes,
+                c->methods[i].attributes_count);
+    }
+
+    mark_signature(c, marks, c->attributes, c->attributes_count);
+
+    for (i = 0; i < c->constant_pool_count; i++) {
+        gchar *str = NULL;
+
+        if (marks[i] == 0 || c->cp_tags[i] != TAG_UTF8) continue;
+
+        str = javaclass_cp_string(c, i);
+
+        if ((marks[i] & MARK_CLASSNAME) && str[0] != '[') {
+            g_string_truncate(set->scratch, 0);
+            append_external(set->scratch, str, strlen(str));
+            emit(set, 0);
+        }
+
+        // array classes are named by their descriptor
+        if ((marks[i] & MARK_SIGNATURE) || str[0] == '[') {
+            g_string_truncate(set->scratch, 0);
+            scan_signature(set, str);
+        }
+    }
+
+    result = g_new(const gchar*, set->result->len + 1);
+    memcpy(result, set->result->pdata, set->result->len * sizeof(gchar*));
+    result[set->result->len] = NULL;
+
+    if (n_dependencies != NULL) *n_dependencies = set->result->len;
+
+    return result;
+}
+
+guint javadependencyset_get_name_number(JavaDependencySet *set)
+{
+    return g_hash_table_size(set->names);
+}
+
+void javadependencyset_free(JavaDependencySet *set)
+{
+    if (set != NULL) {
+        g_hash_table_destroy(set->names);
+        javaarena_free(set->arena);
+        g_string_free(set->scratch, TRUE);
+        g_byte_array_free(set->marks, TRUE);
+        g_ptr_array_free(set->result, TRUE);
+        g_free(set);
+    }
+}
+
+static gint compare_names(gconstpointer a, gconstpointer b)
+{
+    return strcmp(*(const gchar**) a, *(const gchar**) b);
+}
+
+gchar** javaclass_get_dependencies(JavaClass *c)
+{
+    JavaDependencySet *set = javadependencyset_new();
+    guint n = 0;
+    const gchar **names = javadependencyset_collect(set, c, &n);
+    gchar **result = g_new(gchar*, n + 1);
+
+    for (guint i = 0; i < n; i++) {
+        result[i] = g_strdup(names[i]);
+    }
+    result[n] = NULL;
+
+    qsort(result, n, sizeof(gchar*), compare_names);
+
+    g_free(names);
+    javadependencyset_free(set);
+
+    return result;
+}
@@ -0,0 +1,400 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "javaduplicates.h"
+#include "javabytecode.h"
+#include "javaclassvalidator.h"
+#include "javaprivate.h"
+
+#define HASH_SEED_EXACT      0x4a415641
+#define HASH_SEED_NORMALIZED 0x4e4f524d
+
+typedef struct _duplicate_group
+{
+    JavaDuplicateGroup group;
+    GPtrArray *locations;
+} duplicate_group;
+
+struct _JavaDuplicateIndex
+{
+    gboolean normalize;
+    GHashTable *exact;         // JavaDuplicateGroup -> duplicate_group
+    GHashTable *normalized;
+    GStringChunk *locations;
+    GByteArray *scratch;       // the normalized form of the current class
+};
+
+/*
+ * The groups are their own keys, they are equal if hash and size are
+ */
+static guint group_hash(gconstpointer key)
+{
+    return (guint) ((const JavaDuplicateGroup*) key)->hash;
+}
+
+static gboolean group_equal(gconstpointer a, gconstpointer b)
+{
+    const JavaDuplicateGroup *x = a;
+    const JavaDuplicateGroup *y = b;
+
+    return x->hash == y->hash && x->size == y->size;
+}
+
+static void group_free(gpointer data)
+{
+    duplicate_group *group = data;
+
+    g_ptr_array_free(group->locations, TRUE);
+    g_free(group);
+}
+
+/*
+ * Normalization
+ */
+
+static void put_u8(GByteArray *buf, guint8 value)
+{
+    g_byte_array_append(buf, &value, 1);
+}
+
+static void put_u32(GByteArray *buf, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    g_byte_array_append(buf, (guint8*) &value, 4);
+}
+
+static void put_string(GByteArray *buf, const gchar *string)
+{
+    // strings are NUL terminated, so no two sequences of them are the same
+    if (string == NULL) string = "";
+    g_byte_array_append(buf, (const guint8*) string, strlen(string) + 1);
+}
+
+static guint16 get_u16(const guchar *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/*
+ * Append the hash of what the constant with index i (counting from 1)
+ * resolves to
+ */
+static void put_constant(GByteArray *buf, JavaClass *c, guint16 i)
+{
+    guint64 hash = GUINT64_TO_LE(javahash_constant(c, i,
+                HASH_SEED_NORMALIZED));
+
+    g_byte_array_append(buf, (guint8*) &hash, 8);
+}
+
+/*
+ * Append the bytecode of a method with its constant pool operands resolved
+ * and its exception table, leaving out the attributes of the "Code"
+ * attribute (line numbers, local variable names and so on)
+ */
+static void put_code(GByteArray *buf, JavaClass *c, attribute_info *code)
+{
+    const guchar *info = code->info;
+    guint32 codelen = 0;
+    guint32 offset = 0;
+    guint16 n_handlers = 0;
+
+    if (code->attribute_length < 8) return;
+
+    codelen = ((guint32) get_u16(info + 4) << 16) | get_u16(info + 6);
+    if (codelen > code->attribute_length - 8) return;
+
+    // max_stack and max_locals
+    g_byte_array_append(buf, info, 4);
+    info += 8;
+
+    while (offset < codelen) {
+        JavaInstruction insn;
+        guint32 length = javabytecode_decode(info, codelen, offset, &insn);
+
+        if (length == 0) {
+            // keep what can't be decoded as it is
+            g_byte_array_append(buf, info + offset, codelen - offset);
+            break;
+        }
+
+        if (insn.operand == JAVABYTECODE_OPERAND_CONSTANT) {
+            // ldc has a one byte index, all others two bytes
+            guint32 rest = insn.opcode == JAVABYTECODE_LDC ? 2 : 3;
+
+            put_u8(buf, insn.opcode);
+            put_constant(buf, c, insn.cp_index);
+            g_byte_array_append(buf, info + offset + rest, length - rest);
+        } else {
+            g_byte_array_append(buf, info + offset, length);
+        }
+
+        offset += length;
+    }
+
+    if (code->attribute_length - 8 - codelen < 2) return;
+
+    n_handlers = get_u16(info + codelen);
+    info += codelen + 2;
+
+    for (guint16 i = 0; i < n_handlers; i++) {
+        if ((guint64) codelen + 10 + (i + 1) * 8 > code->attribute_length) {
+            break;
+        }
+
+        g_byte_array_append(buf, info + i * 8, 6);
+        put_constant(buf, c, get_u16(info + i * 8 + 6));
+    }
+}
+
+static void normalize_class(GByteArray *buf, JavaClass *c)
+{
+    JavaField **fields = javaclass_get_fields(c);
+    JavaMethod **methods = javaclass_get_methods(c);
+
+    g_byte_array_set_size(buf, 0);
+
+    put_string(buf, javaclass_get_fq_name(c));
+    put_string(buf, javaclass_get_fq_parent(c));
+    put_u32(buf, c->access_flags);
+    put_string(buf, javaclass_get_signature(c));
+
+    put_u32(buf, c->interfaces_count);
+    for (guint16 i = 0; i < c->interfaces_count; i++) {
+        put_string(buf, c->_interfaces[i]);
+    }
+
+    put_u32(buf, c->fields_count);
+    for (guint16 i = 0; i < c->fields_count; i++) {
+        put_u32(buf, fields[i]->access_flags);
+        put_string(buf, fields[i]->name);
+        put_string(buf, fields[i]->descriptor);
+        put_string(buf, fields[i]->signature);
+    }
+
+    put_u32(buf, c->methods_count);
+    for (guint16 i = 0; i < c->methods_count; i++) {
+        put_u32(buf, methods[i]->access_flags);
+        put_string(buf, methods[i]->name);
+        put_string(buf, methods[i]->descriptor);
+        put_string(buf, methods[i]->signature);
+
+        for (gchar **e = methods[i]->exceptions; e != NULL && *e; e++) {
+            put_string(buf, *e);
+        }
+        put_u8(buf, 0);
+
+        for (guint16 j = 0; j < c->methods[i].attributes_count; j++) {
+            if (c->methods[i].attributes[j]._kind == ATTRIBUTE_CODE) {
+                put_code(buf, c, &c->methods[i].attributes[j]);
+            }
+        }
+        put_u8(buf, 0);
+    }
+}
+
+guint64 javaclass_get_normalized_hash(JavaClass *c)
+{
+    GByteArray *buf = g_byte_array_new();
+    guint64 hash = 0;
+
+    normalize_class(buf, c);
+    hash = javahash_bytes(buf->data, buf->len, HASH_SEED_NORMALIZED);
+    g_byte_array_free(buf, TRUE);
+
+    return hash;
+}
+
+/*
+ * The index
+ */
+
+JavaDuplicateIndex* javaduplicates_new(gboolean normalize)
+{
+    JavaDuplicateIndex *index = g_new(JavaDuplicateIndex, 1);
+
+    index->normalize = normalize;
+    index->exact = g_hash_table_new_full(group_hash, group_equal, NULL,
+            group_free);
+    index->normalized = g_hash_table_new_full(group_hash, group_equal, NULL,
+            group_free);
+    index->locations = g_string_chunk_new(64 * 1024);
+    index->scratch = g_byte_array_new();
+
+    return index;
+}
+
+/*
+ * Add a location to the group of hash and size, returns TRUE if the group
+ * existed
+ */
+static gboolean add_location(JavaDuplicateIndex *index, GHashTable *groups,
+        guint64 hash, guint32 size, const gchar *location)
+{
+    JavaDuplicateGroup key = {hash, size, 0, NULL};
+    duplicate_group *group = g_hash_table_lookup(groups, &key);
+    gboolean found = group != NULL;
+
+    if (!found) {
+        group = g_new0(duplicate_group, 1);
+        group->group.hash = hash;
+        group->group.size = size;
+        group->locations = g_ptr_array_new();
+        g_hash_table_insert(groups, &group->group, group);
+    }
+
+    g_ptr_array_add(group->locations,
+            g_string_chunk_insert(index->locations, location));
+
+    return found;
+}
+
+gboolean javaduplicates_add_bytes(JavaDuplicateIndex *index,
+        const guchar *classbytes, guint32 length, const gchar *location)
+{
+    guint64 hash = javahash_bytes(classbytes, length, HASH_SEED_EXACT);
+
+    return add_location(index, index->exact, hash, length, location);
+}
+
+gboolean javaduplicates_add_class(JavaDuplicateIndex *index, JavaClass *c,
+        const gchar *location)
+{
+    guint64 hash = 0;
+
+    normalize_class(index->scratch, c);
+    hash = javahash_bytes(index->scratch->data, index->scratch->len,
+            HASH_SEED_NORMALIZED);
+
+    return add_location(index, index->normalized, hash, index->scratch->len,
+            location);
+}
+
+guint javaduplicates_scan_archive(JavaDuplicateIndex *index,
+        JavaArchive *archive, JavaClassParser *parser, gboolean includecode,
+        JavaDuplicateFunc func, gpointer user_data)
+{
+    GString *location = g_string_new(javaarchive_get_filename(archive));
+    gsize prefix = 0;
+    guint parsed = 0;
+
+    g_string_append_c(location, '!');
+    prefix = location->len;
+
+    for (guint i = 0; i < javaarchive_get_entry_count(archive); i++) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(archive, i);
+        GBytes *bytes = NULL;
+        gsize length = 0;
+        guchar *data = NULL;
+        JavaClass *c = NULL;
+
+        if (!javaarchive_entry_is_class(entry)) continue;
+
+        bytes = javaarchive_read_entry(archive, entry, NULL);
+        if (bytes == NULL) continue;
+
+        g_string_truncate(location, prefix);
+        g_string_append(location, entry->name);
+
+        data = (guchar*) g_bytes_get_data(bytes, &length);
+
+        // the parser trusts its input, so corrupt entries are skipped
+        if (!javaclass_validate(data, length, NULL)) {
+            g_bytes_unref(bytes);
+            continue;
+        }
+
+        if (!javaduplicates_add_bytes(index, data, length, location->str)) {
+            // the normalized form is built from the bytecode
+            c = javaclass_parser_parse(parser, data, length,
+                    includecode || index->normalize, NULL);
+
+            if (c != NULL) {
+                parsed++;
+
+                if (index->normalize) {
+                    javaduplicates_add_class(index, c, location->str);
+                }
+                if (func != NULL) func(location->str, c, user_data);
+            }
+
+            // a failed parse may have left parts of the class in the arena
+            javaclass_parser_reset(parser);
+        }
+
+        g_bytes_unref(bytes);
+    }
+
+    g_string_free(location, TRUE);
+
+    return parsed;
+}
+
+static int compare_groups(const void *a, const void *b)
+{
+    const JavaDuplicateGroup *x = *(const JavaDuplicateGroup**) a;
+    const JavaDuplicateGroup *y = *(const JavaDuplicateGroup**) b;
+
+    if (x->n_locations != y->n_locations) {
+        return x->n_locations > y->n_locations ? -1 : 1;
+    }
+
+    return strcmp(x->locations[0], y->locations[0]);
+}
+
+const JavaDuplicateGroup** javaduplicates_get_groups(
+        JavaDuplicateIndex *index, gboolean normalized, guint *n_groups)
+{
+    GHashTable *groups = normalized ? index->normalized : index->exact;
+    GPtrArray *result = g_ptr_array_new();
+    GHashTableIter iter;
+    gpointer value = NULL;
+
+    g_hash_table_iter_init(&iter, groups);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        duplicate_group *group = value;
+
+        if (group->locations->len < 2) continue;
+
+        group->group.n_locations = group->locations->len;
+        group->group.locations = (const gchar**) group->locations->pdata;
+        g_ptr_array_add(result, &group->group);
+    }
+
+    if (result->len > 1) {
+        qsort(result->pdata, result->len, sizeof(gpointer), compare_groups);
+    }
+
+    if (n_groups != NULL) *n_groups = result->len;
+    g_ptr_array_add(result, NULL);
+
+    return (const JavaDuplicateGroup**) g_ptr_array_free(result, FALSE);
+}
+
+void javaduplicates_free(JavaDuplicateIndex *index)
+{
+    if (index != NULL) {
+        g_hash_table_destroy(index->exact);
+        g_hash_table_destroy(index->normalized);
+        g_string_chunk_free(index->locations);
+        g_byte_array_free(index->scratch, TRUE);
+        g_free(index);
+    }
+}
@@ -0,0 +1,707 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#ifdef HAVE_IO_URING
+// syscall(), statx() and the io_uring definitions
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "javafilereader.h"
+
+/*
+ * Blocking reads
+ */
+
+static GBytes* read_file(const gchar *filename, GError **error)
+{
+    struct stat st;
+    guchar *buffer = NULL;
+    gsize nbytes = 0;
+    ssize_t n = 0;
+    int fd = -1;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        int saved_errno = errno;
+        g_set_error(error, G_FILE_ERROR, g_file_error_from_errno(saved_errno),
+                "Error reading file %s: %s\n", filename,
+                g_strerror(saved_errno));
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+
+    buffer = g_malloc(st.st_size);
+
+    while (nbytes < (gsize) st.st_size) {
+        n = read(fd, buffer + nbytes, st.st_size - nbytes);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        nbytes += n;
+    }
+
+    close(fd);
+
+    if (n < 0) {
+        g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_IO,
+                "Error reading file %s\n", filename);
+        g_free(buffer);
+        return NULL;
+    }
+
+    return g_bytes_new_take(buffer, nbytes);
+}
+
+static void deliver(const gchar *filename, GBytes *bytes, GError *error,
+        JavaFileFunc func, gpointer user_data)
+{
+    func(filename, bytes, error, user_data);
+
+    if (bytes != NULL) g_bytes_unref(bytes);
+    if (error != NULL) g_error_free(error);
+}
+
+static guint read_blocking(const gchar **filenames, guint n_files,
+        JavaFileFunc func, gpointer user_data)
+{
+    guint n_read = 0;
+
+    for (guint i = 0; i < n_files; i++) {
+        GError *error = NULL;
+        GBytes *bytes = read_file(filenames[i], &error);
+
+        if (bytes != NULL) n_read++;
+        deliver(filenames[i], bytes, error, func, user_data);
+    }
+
+    return n_read;
+}
+
+#ifdef HAVE_IO_URING
+
+/*
+ * A minimal io_uring client on top of the raw system calls
+ */
+typedef struct _uring
+{
+    int fd;
+    guint32 sq_entries;
+    guint32 *sq_head;
+    guint32 *sq_tail;
+    guint32 *sq_mask;
+    guint32 *sq_array;
+    struct io_uring_sqe *sqes;
+    guint32 *cq_head;
+    guint32 *cq_tail;
+    guint32 *cq_mask;
+    struct io_uring_cqe *cqes;
+    guint32 to_submit;
+    gboolean failed;     // a submission failed, queue no more requests
+
+    void *sq_ring;
+    gsize sq_ring_size;
+    void *cq_ring;
+    gsize cq_ring_size;
+    gsize sqes_size;
+} uring;
+
+/*
+ * Operations, stored in the low bits of the user data of a request
+ */
+#define OP_OPEN  0
+#define OP_STATX 1
+#define OP_READ  2
+#define OP_CLOSE 3
+#define OP_BITS  2
+
+/*
+ * A file being read
+ */
+typedef struct _read_slot
+{
+    const gchar *filename;
+    int fd;
+    int error;           // errno of the first failed operation
+    guint pending;       // queued requests that have not completed
+    struct statx stx;
+    guchar *buffer;
+    gsize size;
+    gsize done;
+} read_slot;
+
+#endif
+
+struct _JavaFileReader
+{
+    guint queue_depth;
+#ifdef HAVE_IO_URING
+    gboolean async;
+    uring ring;
+    read_slot *slots;
+    guint *free_slots;
+    guint n_free;
+    const gchar **retry; // files to read with blocking calls after a failure
+    guint n_retry;
+#endif
+};
+
+#ifdef HAVE_IO_URING
+
+static gboolean uring_supports_ops(int fd)
+{
+    static const guint8 needed[] = {IORING_OP_OPENAT, IORING_OP_STATX,
+        IORING_OP_READ, IORING_OP_CLOSE};
+    gsize size = sizeof(struct io_uring_probe) +
+        256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *probe = g_malloc0(size);
+    gboolean supported = TRUE;
+
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe,
+                256) < 0) {
+        g_free(probe);
+        return FALSE;
+    }
+
+    for (guint i = 0; i < G_N_ELEMENTS(needed); i++) {
+        if (needed[i] > probe->last_op ||
+                !(probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED)) {
+            supported = FALSE;
+        }
+    }
+
+    g_free(probe);
+
+    return supported;
+}
+
+static gboolean uring_init(uring *ring, guint entries)
+{
+    struct io_uring_params params;
+    guchar *sq = NULL;
+    guchar *cq = NULL;
+
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) return FALSE;
+
+    if (!uring_supports_ops(ring->fd)) {
+        close(ring->fd);
+        return FALSE;
+    }
+
+    ring->sq_ring_size = params.sq_off.array +
+        params.sq_entries * sizeof(guint32);
+    ring->cq_ring_size = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sq_ring_size = MAX(ring->sq_ring_size, ring->cq_ring_size);
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) goto fail;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) goto fail;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) goto fail;
+
+    sq = ring->sq_ring;
+    cq = ring->cq_ring;
+    ring->sq_entries = params.sq_entries;
+    ring->sq_head = (guint32*) (sq + params.sq_off.head);
+    ring->sq_tail = (guint32*) (sq + params.sq_off.tail);
+    ring->sq_mask = (guint32*) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (guint32*) (sq + params.sq_off.array);
+    ring->cq_head = (guint32*) (cq + params.cq_off.head);
+    ring->cq_tail = (guint32*) (cq + params.cq_off.tail);
+    ring->cq_mask = (guint32*) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*) (cq + params.cq_off.cqes);
+
+    return TRUE;
+
+fail:
+    if (ring->sq_ring != NULL && ring->sq_ring != MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+    }
+    if (ring->cq_ring != NULL && ring->cq_ring != MAP_FAILED &&
+            ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    close(ring->fd);
+
+    return FALSE;
+}
+
+static void uring_destroy(uring *ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+/*
+ * Submit the queued requests and wait for min_complete completions,
+ * requests the kernel did not take stay queued when this fails
+ */
+static gboolean uring_submit(uring *ring, guint min_complete)
+{
+    while (ring->to_submit > 0 || min_complete > 0) {
+        int n = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit,
+                min_complete, min_complete > 0 ? IORING_ENTER_GETEVENTS : 0,
+                NULL, 0);
+
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+            ring->failed = TRUE;
+            return FALSE;
+        }
+
+        ring->to_submit -= n;
+        min_complete = 0;
+    }
+
+    return TRUE;
+}
+
+/*
+ * Get a request to fill in, submitting the queued ones if the queue is full
+ */
+static struct io_uring_sqe* uring_get_sqe(uring *ring, guint64 user_data)
+{
+    guint32 tail = *ring->sq_tail;
+    guint32 index = 0;
+    struct io_uring_sqe *sqe = NULL;
+
+    if (ring->failed) return NULL;
+
+    // the kernel moves the head when it consumed requests
+    while (tail - (guint32) g_atomic_int_get((gint*) ring->sq_head) >=
+            ring->sq_entries) {
+        if (!uring_submit(ring, 0)) return NULL;
+    }
+
+    index = tail & *ring->sq_mask;
+    sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+
+    g_atomic_int_set((gint*) ring->sq_tail, tail + 1);
+    ring->to_submit++;
+
+    return sqe;
+}
+
+static guint64 user_data(guint slot, guint op)
+{
+    return ((guint64) slot << OP_BITS) | op;
+}
+
+static void queue_close(JavaFileReader *reader, int fd)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(&reader->ring,
+            user_data(0, OP_CLOSE));
+
+    if (sqe == NULL) {
+        close(fd);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = fd;
+}
+
+static gboolean queue_read(JavaFileReader *reader, guint index)
+{
+    read_slot *slot = &reader->slots[index];
+    struct io_uring_sqe *sqe = uring_get_sqe(&reader->ring,
+            user_data(index, OP_READ));
+
+    if (sqe == NULL) return FALSE;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = slot->fd;
+    sqe->addr = (guint64) (guintptr) (slot->buffer + slot->done);
+    sqe->len = MIN(slot->size - slot->done, G_MAXINT32);
+    sqe->off = slot->done;
+    slot->pending++;
+
+    return TRUE;
+}
+
+/*
+ * Start reading a file, the slot owns the file even if its requests can't
+ * be queued because the ring failed
+ */
+static void queue_open(JavaFileReader *reader, guint index,
+        const gchar *filename)
+{
+    read_slot *slot = &reader->slots[index];
+    struct io_uring_sqe *sqe = NULL;
+
+    slot->filename = filename;
+    slot->fd = -1;
+    slot->error = 0;
+    slot->pending = 0;
+    slot->buffer = NULL;
+    slot->size = 0;
+    slot->done = 0;
+
+    sqe = uring_get_sqe(&reader->ring, user_data(index, OP_OPEN));
+    if (sqe == NULL) return;
+
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (guint64) (guintptr) filename;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC;
+    slot->pending++;
+
+    // the size is needed before the read, so stat the path in parallel
+    sqe = uring_get_sqe(&reader->ring, user_data(index, OP_STATX));
+    if (sqe == NULL) return;
+
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (guint64) (guintptr) filename;
+    sqe->len = STATX_SIZE;
+    sqe->off = (guint64) (guintptr) &slot->stx;
+    slot->pending++;
+}
+
+/*
+ * Release a slot without delivering its file, which is read with blocking
+ * calls instead. The slot must not have requests in flight.
+ */
+static void retry_slot(JavaFileReader *reader, guint index)
+{
+    read_slot *slot = &reader->slots[index];
+
+    if (slot->fd >= 0) close(slot->fd);
+    g_free(slot->buffer);
+
+    reader->retry[reader->n_retry++] = slot->filename;
+
+    slot->filename = NULL;
+    slot->buffer = NULL;
+    reader->free_slots[reader->n_free++] = index;
+}
+
+/*
+ * After a failed submission take back the requests the kernel never saw and
+ * retry the files of slots left without requests, returns their number
+ */
+static guint drop_unsubmitted(JavaFileReader *reader)
+{
+    uring *ring = &reader->ring;
+    guint32 tail = *ring->sq_tail;
+    guint32 first = tail - ring->to_submit;
+    guint n_retried = 0;
+
+    for (guint32 i = first; i != tail; i++) {
+        struct io_uring_sqe *sqe = &ring->sqes[i & *ring->sq_mask];
+        guint op = sqe->user_data & ((1 << OP_BITS) - 1);
+
+        if (op == OP_CLOSE) {
+            close(sqe->fd);
+        } else {
+            reader->slots[sqe->user_data >> OP_BITS].pending--;
+        }
+    }
+
+    // without a polling thread the kernel only reads the tail on submission
+    g_atomic_int_set((gint*) ring->sq_tail, first);
+    ring->to_submit = 0;
+
+    for (guint i = 0; i < reader->queue_depth; i++) {
+        read_slot *slot = &reader->slots[i];
+
+        if (slot->filename != NULL && slot->pending == 0) {
+            retry_slot(reader, i);
+            n_retried++;
+        }
+    }
+
+    return n_retried;
+}
+
+/*
+ * When even waiting for completions fails, leave the slots with requests in
+ * flight to the kernel and retry their files. Their buffers can't be freed
+ * while the kernel may still write to them, and the slots are never reused.
+ */
+static guint abandon_slots(JavaFileReader *reader)
+{
+    guint n_abandoned = 0;
+
+    for (guint i = 0; i < reader->queue_depth; i++) {
+        read_slot *slot = &reader->slots[i];
+
+        if (slot->filename != NULL) {
+            reader->retry[reader->n_retry++] = slot->filename;
+            slot->filename = NULL;
+            n_abandoned++;
+        }
+    }
+
+    return n_abandoned;
+}
+
+/*
+ * Pass a finished file to the callback and release its slot
+ */
+static gboolean finish_slot(JavaFileReader *reader, guint index,
+        JavaFileFunc func, gpointer user_data)
+{
+    read_slot *slot = &reader->slots[index];
+    GBytes *bytes = NULL;
+    GError *error = NULL;
+
+    if (slot->fd >= 0) queue_close(reader, slot->fd);
+
+    if (slot->error != 0) {
+        g_set_error(&error, G_FILE_ERROR, g_file_error_from_errno(slot->error),
+                "Error reading file %s: %s\n", slot->filename,
+                g_strerror(slot->error));
+        g_free(slot->buffer);
+    } else {
+        bytes = g_bytes_new_take(slot->buffer, slot->done);
+    }
+
+    slot->buffer = NULL;
+    reader->free_slots[reader->n_free++] = index;
+
+    deliver(slot->filename, bytes, error, func, user_data);
+    slot->filename = NULL;
+
+    return error == NULL;
+}
+
+/*
+ * Handle a completion, returns TRUE if it finished a file successfully. A
+ * file that needs another request after the ring failed is retried.
+ */
+static gboolean complete(JavaFileReader *reader, struct io_uring_cqe *cqe,
+        JavaFileFunc func, gpointer user_data, gboolean *finished)
+{
+    guint index = cqe->user_data >> OP_BITS;
+    guint op = cqe->user_data & ((1 << OP_BITS) - 1);
+    read_slot *slot = &reader->slots[index];
+
+    *finished = FALSE;
+
+    if (op == OP_CLOSE) return FALSE;
+
+    slot->pending--;
+
+    switch (op) {
+        case OP_OPEN:
+        case OP_STATX:
+            if (cqe->res < 0 && slot->error == 0) slot->error = -cqe->res;
+            if (op == OP_OPEN && cqe->res >= 0) slot->fd = cqe->res;
+
+            if (slot->pending > 0) return FALSE;
+
+            // one of the requests may have been dropped
+            if (slot->error == 0 && reader->ring.failed) goto retry;
+
+            if (slot->error == 0) {
+                slot->size = slot->stx.stx_size;
+                slot->buffer = g_malloc(slot->size);
+
+                if (slot->size > 0 && !queue_read(reader, index)) goto retry;
+                if (slot->size > 0) return FALSE;
+            }
+            break;
+        case OP_READ:
+            if (cqe->res == -EINTR || cqe->res == -EAGAIN) {
+                if (!queue_read(reader, index)) goto retry;
+                return FALSE;
+            } else if (cqe->res < 0) {
+                slot->error = -cqe->res;
+            } else {
+                slot->done += cqe->res;
+
+                // a short read means the file shrank since statx
+                if (cqe->res > 0 && slot->done < slot->size) {
+                    if (!queue_read(reader, index)) goto retry;
+                    return FALSE;
+                }
+            }
+            break;
+    }
+
+    *finished = TRUE;
+
+    return finish_slot(reader, index, func, user_data);
+
+retry:
+    *finished = TRUE;
+    retry_slot(reader, index);
+
+    return FALSE;
+}
+
+static guint read_async(JavaFileReader *reader, const gchar **filenames,
+        guint n_files, JavaFileFunc func, gpointer user_data)
+{
+    uring *ring = &reader->ring;
+    guint next = 0;
+    guint in_flight = 0;
+    guint n_read = 0;
+
+    reader->n_retry = 0;
+
+    while (next < n_files || in_flight > 0) {
+        guint32 head = 0;
+        guint32 tail = 0;
+
+        while (next < n_files && reader->n_free > 0 && !ring->failed) {
+            guint index = reader->free_slots[--reader->n_free];
+
+            queue_open(reader, index, filenames[next++]);
+            in_flight++;
+        }
+
+        // after a failure only wait for what the kernel already has
+        if (ring->failed) in_flight -= drop_unsubmitted(reader);
+        if (in_flight == 0) break;
+
+        if (!uring_submit(ring, 1)) {
+            // drop the requests left behind and try waiting once more
+            if (ring->to_submit > 0) continue;
+
+            in_flight -= abandon_slots(reader);
+            break;
+        }
+
+        head = *ring->cq_head;
+        tail = g_atomic_int_get((gint*) ring->cq_tail);
+
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            gboolean finished = FALSE;
+
+            if (complete(reader, cqe, func, user_data, &finished)) n_read++;
+            if (finished) in_flight--;
+        }
+
+        g_atomic_int_set((gint*) ring->cq_head, head);
+    }
+
+    // submit the last closes, or close the files directly
+    if (!ring->failed) uring_submit(ring, 0);
+    if (ring->failed) drop_unsubmitted(reader);
+
+    // every file io_uring did not deliver is read with blocking calls
+    n_read += read_blocking(reader->retry, reader->n_retry, func, user_data);
+    n_read += read_blocking(filenames + next, n_files - next, func,
+            user_data);
+
+    return n_read;
+}
+
+#endif /* HAVE_IO_URING */
+
+JavaFileReader* javafilereader_new(guint queue_depth)
+{
+    JavaFileReader *reader = g_new0(JavaFileReader, 1);
+
+    reader->queue_depth = MAX(queue_depth, 1);
+
+#ifdef HAVE_IO_URING
+    // every file has up to two requests in flight plus its close
+    reader->async = uring_init(&reader->ring, reader->queue_depth * 4);
+
+    if (reader->async) {
+        reader->slots = g_new0(read_slot, reader->queue_depth);
+        reader->free_slots = g_new(guint, reader->queue_depth);
+        reader->retry = g_new(const gchar*, reader->queue_depth);
+
+        for (guint i = 0; i < reader->queue_depth; i++) {
+            reader->free_slots[i] = reader->queue_depth - 1 - i;
+        }
+        reader->n_free = reader->queue_depth;
+    }
+#endif
+
+    return reader;
+}
+
+gboolean javafilereader_is_async(JavaFileReader *reader)
+{
+#ifdef HAVE_IO_URING
+    return reader->async && !reader->ring.failed;
+#else
+    return FALSE;
+#endif
+}
+
+guint javafilereader_read(JavaFileReader *reader, const gchar **filenames,
+        guint n_files, JavaFileFunc func, gpointer user_data)
+{
+#ifdef HAVE_IO_URING
+    // once a submission failed the ring is no longer used
+    if (reader->async && !reader->ring.failed) {
+        return read_async(reader, filenames, n_files, func, user_data);
+    }
+#endif
+
+    return read_blocking(filenames, n_files, func, user_data);
+}
+
+void javafilereader_free(JavaFileReader *reader)
+{
+    if (reader != NULL) {
+#ifdef HAVE_IO_URING
+        if (reader->async) {
+            uring_destroy(&reader->ring);
+            g_free(reader->slots);
+            g_free(reader->free_slots);
+            g_free(reader->retry);
+        }
+#endif
+        g_free(reader);
+    }
+}
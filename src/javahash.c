@@ -0,0 +1,144 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javaprivate.h"
+
+/*
+ * A hash in the style of MurmurHash64A: the input is consumed 8 bytes at a
+ * time and the result is put through the finalizer of MurmurHash3
+ */
+#define HASH_M G_GUINT64_CONSTANT(0xc6a4a7935bd1e995)
+#define HASH_R 47
+
+// constants referring to constants are resolved up to this depth
+#define MAX_CONSTANT_DEPTH 3
+
+static guint64 mix(guint64 h)
+{
+    h ^= h >> 33;
+    h *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    h *= G_GUINT64_CONSTANT(0xc4ceb9fe1a85ec53);
+    h ^= h >> 33;
+
+    return h;
+}
+
+guint64 javahash_bytes(const void *data, gsize length, guint64 seed)
+{
+    const guchar *p = data;
+    guint64 h = seed ^ (length * HASH_M);
+    guint64 tail = 0;
+
+    for (; length >= 8; length -= 8, p += 8) {
+        guint64 k;
+
+        memcpy(&k, p, 8);
+        k = GUINT64_FROM_LE(k);
+        k *= HASH_M;
+        k ^= k >> HASH_R;
+        k *= HASH_M;
+
+        h ^= k;
+        h *= HASH_M;
+    }
+
+    if (length > 0) {
+        for (gsize i = 0; i < length; i++) {
+            tail |= (guint64) p[i] << (8 * i);
+        }
+
+        h ^= tail;
+        h *= HASH_M;
+    }
+
+    return mix(h);
+}
+
+static guint64 combine(guint64 hash, guint64 value)
+{
+    return mix(hash ^ (value + G_GUINT64_CONSTANT(0x9e3779b97f4a7c15)));
+}
+
+static guint64 hash_constant(JavaClass *c, guint16 i, guint64 seed,
+        int depth)
+{
+    guint8 tag = 0;
+    cp_value *value = NULL;
+    guint64 hash = 0;
+
+    if (i == 0 || i > c->constant_pool_count || depth > MAX_CONSTANT_DEPTH) {
+        return seed;
+    }
+
+    tag = c->cp_tags[i - 1];
+    value = &c->cp_values[i - 1];
+    hash = combine(seed, tag);
+
+    switch (tag) {
+        case TAG_UTF8:
+            hash = javahash_bytes(c->cp_strings + value->offset,
+                    strlen(c->cp_strings + value->offset), hash);
+            break;
+        case TAG_INTEGER:
+        case TAG_FLOAT:
+            hash = combine(hash, value->word);
+            break;
+        case TAG_LONG:
+        case TAG_DOUBLE:
+            hash = combine(hash, value->word);
+            if (i < c->constant_pool_count) {
+                hash = combine(hash, value[1].word);
+            }
+            break;
+        case TAG_CLASS:
+        case TAG_STRING:
+            hash = hash_constant(c, value->index + 1, hash, depth + 1);
+            break;
+        case TAG_FIELDREF:
+        case TAG_METHODREF:
+        case TAG_INTERFACEMETHODREF:
+        case TAG_NAMEANDTYPE:
+            hash = hash_constant(c, value->indexpair[0] + 1, hash, depth + 1);
+            hash = hash_constant(c, value->indexpair[1] + 1, hash, depth + 1);
+            break;
+        case TAG_METHODHANDLE:
+            hash = combine(hash, value->handle.kind);
+            hash = hash_constant(c, value->handle.index + 1, hash, depth + 1);
+            break;
+        case TAG_METHODTYPE:
+        case TAG_MODULE:
+        case TAG_PACKAGE:
+            hash = hash_constant(c, value->index + 1, hash, depth + 1);
+            break;
+        case TAG_DYNAMIC:
+        case TAG_INVOKEDYNAMIC:
+            // the bootstrap method is not a constant
+            hash = combine(hash, value->indexpair[0]);
+            hash = hash_constant(c, value->indexpair[1] + 1, hash, depth + 1);
+            break;
+    }
+
+    return hash;
+}
+
+guint64 javahash_constant(JavaClass *c, guint16 i, guint64 seed)
+{
+    return hash_constant(c, i, seed, 0);
+}
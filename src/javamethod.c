@@ -50,6 +50,7 @@ JavaMethod* javamethod_new(guint16 access_flags, const gchar *name,
     method->exceptions = NULL;
     method->code = NULL;
     method->codelen = 0;
+    method->_codebuf = NULL;
 
     if (exceptions != NULL) {
         int len;
@@ -197,13 +198,33 @@ void javamethod_set_code(JavaMethod *method, guchar *code, guint32 codelen)
     method->codelen = codelen;
 }
 
+void javamethod_set_code_view(JavaMethod *method, GBytes *buffer,
+        gsize offset, guint32 codelen)
+{
+    gsize size = 0;
+    const guchar *data = g_bytes_get_data(buffer, &size);
+
+    if (codelen <= 0) return;
+
+    g_assert(offset + codelen <= size);
+
+    method->code = (guchar*) data + offset;
+    method->codelen = codelen;
+    method->_codebuf = g_bytes_ref(buffer);
+}
+
 void javamethod_free(JavaMethod *method)
 {
     if (method != NULL) {
         g_free(method->name);
         g_free(method->descriptor);
         g_free(method->signature);
-        g_free(method->code);
+        if (method->_codebuf != NULL) {
+            g_bytes_unref(method->_codebuf);
+        } else {
+            g_free(method->code);
+        }
+
         g_strfreev(method->exceptions);
 
         g_free(method);
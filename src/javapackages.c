@@ -0,0 +1,242 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javapackages.h"
+
+/*
+ * A class of a package
+ */
+typedef struct _package_class
+{
+    const gchar *name;       // unqualified name
+    gpointer data;
+} package_class;
+
+struct _JavaPackage
+{
+    const gchar *name;       // dotted name, "" for the default package
+    JavaPackage *parent;
+    JavaPackage *children;   // first subpackage
+    JavaPackage *next;       // next subpackage of the parent
+    GArray *classes;         // package_class, NULL while there are none
+    guint class_count;       // classes of this package and all below
+};
+
+struct _JavaPackageTree
+{
+    JavaPackage root;        // the default package
+    GHashTable *packages;    // name -> JavaPackage*
+    GStringChunk *names;     // package and class names
+    GString *scratch;        // NUL terminated prefixes of names for lookups
+};
+
+JavaPackageTree* javapackagetree_new(void)
+{
+    JavaPackageTree *tree = g_new0(JavaPackageTree, 1);
+
+    tree->root.name = "";
+    tree->packages = g_hash_table_new(g_str_hash, g_str_equal);
+    tree->names = g_string_chunk_new(16 * 1024);
+    tree->scratch = g_string_sized_new(256);
+
+    return tree;
+}
+
+/*
+ * Find the last dot in the first len bytes of name (or NULL)
+ */
+static const gchar* last_dot(const gchar *name, gsize len)
+{
+    while (len > 0) {
+        if (name[--len] == '.') return &name[len];
+    }
+
+    return NULL;
+}
+
+/*
+ * Get the package named by the first len bytes of name, creating it and any
+ * missing parent packages
+ */
+static JavaPackage* get_package(JavaPackageTree *tree, const gchar *name,
+        gsize len)
+{
+    JavaPackage *package = NULL;
+    const gchar *dot = NULL;
+
+    if (len == 0) return &tree->root;
+
+    g_string_truncate(tree->scratch, 0);
+    g_string_append_len(tree->scratch, name, len);
+
+    package = g_hash_table_lookup(tree->packages, tree->scratch->str);
+    if (package != NULL) return package;
+
+    package = g_new0(JavaPackage, 1);
+    package->name = g_string_chunk_insert_len(tree->names, name, len);
+    g_hash_table_insert(tree->packages, (gpointer) package->name, package);
+
+    dot = last_dot(name, len);
+    package->parent = get_package(tree, name, dot != NULL ? dot - name : 0);
+    package->next = package->parent->children;
+    package->parent->children = package;
+
+    return package;
+}
+
+const JavaPackage* javapackagetree_add_class(JavaPackageTree *tree,
+        const gchar *fqn, gpointer data)
+{
+    gsize len = strlen(fqn);
+    const gchar *dot = last_dot(fqn, len);
+    JavaPackage *package = get_package(tree, fqn, dot != NULL ? dot - fqn : 0);
+    package_class entry;
+
+    if (package->classes == NULL) {
+        package->classes = g_array_new(FALSE, FALSE, sizeof(package_class));
+    }
+
+    entry.name = g_string_chunk_insert(tree->names,
+            dot != NULL ? &dot[1] : fqn);
+    entry.data = data;
+    g_array_append_val(package->classes, entry);
+
+    // the counts of the subtrees are kept up to date so counting is free
+    for (JavaPackage *p = package; p != NULL; p = p->parent) {
+        p->class_count++;
+    }
+
+    return package;
+}
+
+const JavaPackage* javapackagetree_lookup(JavaPackageTree *tree,
+        const gchar *name)
+{
+    if (name[0] == '\0') return &tree->root;
+
+    return g_hash_table_lookup(tree->packages, name);
+}
+
+guint javapackagetree_get_package_number(JavaPackageTree *tree)
+{
+    return g_hash_table_size(tree->packages);
+}
+
+static void append_fqn(const JavaPackage *package, const gchar *name,
+        gpointer data, gpointer user_data)
+{
+    GPtrArray *result = user_data;
+
+    if (package->name[0] == '\0') {
+        g_ptr_array_add(result, g_strdup(name));
+    } else {
+        g_ptr_array_add(result, g_strconcat(package->name, ".", name, NULL));
+    }
+}
+
+gchar** javapackagetree_get_classes(JavaPackageTree *tree, const gchar *name,
+        gboolean recursive)
+{
+    const JavaPackage *package = javapackagetree_lookup(tree, name);
+    GPtrArray *result = NULL;
+
+    if (package == NULL) return g_new0(gchar*, 1);
+
+    result = g_ptr_array_sized_new(
+            javapackage_get_class_number(package, recursive) + 1);
+    javapackage_foreach_class(package, recursive, append_fqn, result);
+    g_ptr_array_add(result, NULL);
+
+    return (gchar**) g_ptr_array_free(result, FALSE);
+}
+
+/*
+ * Free a package and all below it
+ */
+static void free_packages(JavaPackage *package)
+{
+    JavaPackage *next = NULL;
+
+    for (JavaPackage *child = package->children; child != NULL; child = next) {
+        next = child->next;
+        free_packages(child);
+        g_free(child);
+    }
+
+    if (package->classes != NULL) {
+        g_array_free(package->classes, TRUE);
+    }
+}
+
+void javapackagetree_free(JavaPackageTree *tree)
+{
+    if (tree != NULL) {
+        free_packages(&tree->root);
+        g_hash_table_destroy(tree->packages);
+        g_string_chunk_free(tree->names);
+        g_string_free(tree->scratch, TRUE);
+        g_free(tree);
+    }
+}
+
+const gchar* javapackage_get_name(const JavaPackage *package)
+{
+    return package->name;
+}
+
+const JavaPackage* javapackage_get_parent(const JavaPackage *package)
+{
+    return package->parent;
+}
+
+guint javapackage_get_class_number(const JavaPackage *package,
+        gboolean recursive)
+{
+    if (recursive) return package->class_count;
+
+    return package->classes != NULL ? package->classes->len : 0;
+}
+
+void javapackage_foreach_class(const JavaPackage *package, gboolean recursive,
+        JavaPackageClassFunc func, gpointer user_data)
+{
+    if (package->classes != NULL) {
+        for (guint i = 0; i < package->classes->len; i++) {
+            package_class *entry = &g_array_index(package->classes,
+                    package_class, i);
+            func(package, entry->name, entry->data, user_data);
+        }
+    }
+
+    if (!recursive) return;
+
+    for (JavaPackage *child = package->children; child != NULL;
+            child = child->next) {
+        javapackage_foreach_class(child, TRUE, func, user_data);
+    }
+}
+
+void javapackage_foreach_subpackage(const JavaPackage *package,
+        JavaPackageFunc func, gpointer user_data)
+{
+    for (JavaPackage *child = package->children; child != NULL;
+            child = child->next) {
+        func(child, user_data);
+    }
+}
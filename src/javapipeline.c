@@ -0,0 +1,397 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "javapipeline.h"
+#include "javaarchive.h"
+#include "javaclassparser.h"
+#include "javaclassvalidator.h"
+#include "javafilereader.h"
+#include "javaprivate.h"
+
+/*
+ * Loose class files are handed to the readers in batches of this size and
+ * each reader keeps this many of them in flight
+ */
+#define FILE_BATCH_SIZE 256
+#define READER_QUEUE_DEPTH 64
+
+/*
+ * A class on its way through the pipeline
+ */
+typedef struct _pipeline_item
+{
+    gchar *location;
+    GBytes *bytes;
+    GError *error;
+    JavaClass *c;
+    JavaClassParser *parser;
+} pipeline_item;
+
+/*
+ * The work of a reader: an archive or a batch of loose files
+ */
+typedef struct _read_unit
+{
+    const gchar *archive;
+    guint first;
+    guint count;
+} read_unit;
+
+struct _JavaPipeline
+{
+    guint n_readers;
+    guint n_workers;
+    guint queue_size;
+    gboolean includecode;
+    JavaPipelineWorkerFunc worker_func;
+    gpointer worker_data;
+    GPtrArray *paths;
+
+    // state of a run
+    GPtrArray *files;       // loose class files
+    GArray *units;
+    gint next_unit;
+    gint next_worker;
+    JavaRing *read;         // read classes waiting for a parser
+    JavaRing *parsed;       // parsed classes waiting for the consumer
+    JavaRing *contexts;     // unused parsers
+    gint active_readers;
+    gint active_workers;
+};
+
+JavaPipeline* javapipeline_new(guint n_readers, guint n_workers,
+        guint queue_size)
+{
+    JavaPipeline *pipeline = g_new0(JavaPipeline, 1);
+
+    pipeline->n_readers = MAX(n_readers, 1);
+    pipeline->n_workers = MAX(n_workers, 1);
+    pipeline->queue_size = MAX(queue_size, 1);
+    pipeline->paths = g_ptr_array_new_with_free_func(g_free);
+
+    return pipeline;
+}
+
+void javapipeline_set_include_code(JavaPipeline *pipeline,
+        gboolean includecode)
+{
+    pipeline->includecode = includecode;
+}
+
+void javapipeline_set_worker_func(JavaPipeline *pipeline,
+        JavaPipelineWorkerFunc func, gpointer user_data)
+{
+    pipeline->worker_func = func;
+    pipeline->worker_data = user_data;
+}
+
+guint javapipeline_get_worker_number(JavaPipeline *pipeline)
+{
+    return pipeline->n_workers;
+}
+
+void javapipeline_add_path(JavaPipeline *pipeline, const gchar *path)
+{
+    g_ptr_array_add(pipeline->paths, g_strdup(path));
+}
+
+static pipeline_item* item_new(gchar *location, GBytes *bytes, GError *error)
+{
+    pipeline_item *item = g_new0(pipeline_item, 1);
+
+    item->location = location;
+    item->bytes = bytes;
+    item->error = error;
+
+    return item;
+}
+
+static void item_free(pipeline_item *item)
+{
+    if (item->bytes != NULL) g_bytes_unref(item->bytes);
+    if (item->error != NULL) g_error_free(item->error);
+    g_free(item->location);
+    g_free(item);
+}
+
+/*
+ * Add an item to a queue, waiting while it is full
+ */
+static void push_wait(JavaRing *ring, gpointer data)
+{
+    guint attempts = 0;
+
+    while (!javaring_push(ring, data)) javaring_backoff(&attempts);
+}
+
+/*
+ * Take an item from a queue, waiting while it is empty. Returns NULL when
+ * the queue is empty and all of its producers have finished.
+ */
+static gpointer pop_wait(JavaRing *ring, gint *active_producers)
+{
+    guint attempts = 0;
+    gpointer data = NULL;
+
+    while (!javaring_pop(ring, &data)) {
+        if (active_producers != NULL &&
+                g_atomic_int_get(active_producers) == 0) {
+            // the last producer may have pushed right before finishing
+            return javaring_pop(ring, &data) ? data : NULL;
+        }
+
+        javaring_backoff(&attempts);
+    }
+
+    return data;
+}
+
+/*
+ * Collect the class files of a directory tree
+ */
+static void collect_files(GPtrArray *files, const gchar *dirname)
+{
+    GDir *dir = g_dir_open(dirname, 0, NULL);
+    const gchar *name = NULL;
+
+    if (dir == NULL) return;
+
+    while ((name = g_dir_read_name(dir)) != NULL) {
+        gchar *path = g_build_filename(dirname, name, NULL);
+
+        if (g_str_has_suffix(name, ".class")) {
+            g_ptr_array_add(files, path);
+            continue;
+        }
+
+        if (g_file_test(path, G_FILE_TEST_IS_DIR)) collect_files(files, path);
+        g_free(path);
+    }
+
+    g_dir_close(dir);
+}
+
+/*
+ * Readers
+ */
+
+static void file_read(const gchar *filename, GBytes *bytes,
+        const GError *error, gpointer user_data)
+{
+    JavaPipeline *pipeline = user_data;
+
+    push_wait(pipeline->read, item_new(g_strdup(filename),
+                bytes != NULL ? g_bytes_ref(bytes) : NULL,
+                error != NULL ? g_error_copy(error) : NULL));
+}
+
+static void read_archive(JavaPipeline *pipeline, const gchar *filename)
+{
+    GError *error = NULL;
+    JavaArchive *archive = javaarchive_open(filename, &error);
+
+    if (archive == NULL) {
+        push_wait(pipeline->read, item_new(g_strdup(filename), NULL, error));
+        return;
+    }
+
+    for (guint i = 0; i < javaarchive_get_entry_count(archive); i++) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(archive, i);
+        GBytes *bytes = NULL;
+
+        if (!javaarchive_entry_is_class(entry)) continue;
+
+        bytes = javaarchive_read_entry(archive, entry, &error);
+        push_wait(pipeline->read, item_new(g_strconcat(filename, "!",
+                        entry->name, NULL), bytes, error));
+        error = NULL;
+    }
+
+    javaarchive_free(archive);
+}
+
+static gpointer reader_thread(gpointer data)
+{
+    JavaPipeline *pipeline = data;
+    JavaFileReader *reader = javafilereader_new(READER_QUEUE_DEPTH);
+    guint unit = 0;
+
+    while ((unit = g_atomic_int_add(&pipeline->next_unit, 1)) <
+            pipeline->units->len) {
+        read_unit *cur = &g_array_index(pipeline->units, read_unit, unit);
+
+        if (cur->archive != NULL) {
+            read_archive(pipeline, cur->archive);
+        } else {
+            javafilereader_read(reader,
+                    (const gchar**) pipeline->files->pdata + cur->first,
+                    cur->count, file_read, pipeline);
+        }
+    }
+
+    javafilereader_free(reader);
+    g_atomic_int_add(&pipeline->active_readers, -1);
+
+    return NULL;
+}
+
+/*
+ * Parser workers
+ */
+
+static gpointer worker_thread(gpointer data)
+{
+    JavaPipeline *pipeline = data;
+    pipeline_item *item = NULL;
+    guint worker = g_atomic_int_add(&pipeline->next_worker, 1);
+
+    while ((item = pop_wait(pipeline->read, &pipeline->active_readers))) {
+        if (item->bytes != NULL) {
+            gsize length = 0;
+            guchar *classbytes = (guchar*) g_bytes_get_data(item->bytes,
+                    &length);
+            JavaClassValidation report;
+
+            // the parser trusts its input, a corrupt entry must not take
+            // down the whole run
+            if (!javaclass_validate(classbytes, length, &report)) {
+                g_set_error(&item->error, JAVACLASS_GERROR,
+                        JAVACLASS_ERROR_INVALID_CLASS,
+                        "Error parsing class file: %s at offset %u\n",
+                        report.message, report.offset);
+                push_wait(pipeline->parsed, item);
+                continue;
+            }
+
+            // there are always enough contexts for all workers
+            item->parser = pop_wait(pipeline->contexts, NULL);
+            item->c = javaclass_parser_parse(item->parser, classbytes,
+                    length, pipeline->includecode, &item->error);
+
+            if (item->c == NULL) {
+                javaring_push(pipeline->contexts, item->parser);
+                item->parser = NULL;
+            } else if (pipeline->worker_func != NULL) {
+                pipeline->worker_func(worker, item->location, item->c,
+                        pipeline->worker_data);
+            }
+        }
+
+        push_wait(pipeline->parsed, item);
+    }
+
+    g_atomic_int_add(&pipeline->active_workers, -1);
+
+    return NULL;
+}
+
+void javapipeline_run(JavaPipeline *pipeline, JavaPipelineFunc func,
+        gpointer user_data, JavaPipelineStats *stats)
+{
+    GThread **threads = NULL;
+    guint n_threads = pipeline->n_readers + pipeline->n_workers;
+    guint n_contexts = pipeline->n_workers + pipeline->queue_size;
+    JavaPipelineStats totals = {0, 0, 0};
+    pipeline_item *item = NULL;
+    gpointer parser = NULL;
+
+    pipeline->files = g_ptr_array_new_with_free_func(g_free);
+    pipeline->units = g_array_new(FALSE, FALSE, sizeof(read_unit));
+    pipeline->next_unit = 0;
+    pipeline->next_worker = 0;
+
+    for (guint i = 0; i < pipeline->paths->len; i++) {
+        const gchar *path = g_ptr_array_index(pipeline->paths, i);
+        read_unit unit = {path, 0, 0};
+
+        if (g_file_test(path, G_FILE_TEST_IS_DIR)) {
+            collect_files(pipeline->files, path);
+        } else if (g_str_has_suffix(path, ".class")) {
+            g_ptr_array_add(pipeline->files, g_strdup(path));
+        } else {
+            g_array_append_val(pipeline->units, unit);
+        }
+    }
+
+    for (guint i = 0; i < pipeline->files->len; i += FILE_BATCH_SIZE) {
+        read_unit unit = {NULL, i, MIN(FILE_BATCH_SIZE,
+                pipeline->files->len - i)};
+        g_array_append_val(pipeline->units, unit);
+    }
+
+    pipeline->read = javaring_new(pipeline->queue_size);
+    pipeline->parsed = javaring_new(pipeline->queue_size);
+    pipeline->contexts = javaring_new(n_contexts);
+    pipeline->active_readers = pipeline->n_readers;
+    pipeline->active_workers = pipeline->n_workers;
+
+    for (guint i = 0; i < n_contexts; i++) {
+        javaring_push(pipeline->contexts, javaclass_parser_new());
+    }
+
+    threads = g_new(GThread*, n_threads);
+    for (guint i = 0; i < pipeline->n_readers; i++) {
+        threads[i] = g_thread_new("classreader-read", reader_thread,
+                pipeline);
+    }
+    for (guint i = 0; i < pipeline->n_workers; i++) {
+        threads[pipeline->n_readers + i] = g_thread_new("classreader-parse",
+                worker_thread, pipeline);
+    }
+
+    // the consumer
+    while ((item = pop_wait(pipeline->parsed, &pipeline->active_workers))) {
+        func(item->location, item->c, item->error, user_data);
+
+        if (item->c != NULL) {
+            totals.classes++;
+            totals.bytes += g_bytes_get_size(item->bytes);
+
+            javaclass_parser_reset(item->parser);
+            javaring_push(pipeline->contexts, item->parser);
+        } else {
+            totals.errors++;
+        }
+
+        item_free(item);
+    }
+
+    for (guint i = 0; i < n_threads; i++) g_thread_join(threads[i]);
+    g_free(threads);
+
+    while (javaring_pop(pipeline->contexts, &parser)) {
+        javaclass_parser_free(parser);
+    }
+
+    javaring_free(pipeline->read);
+    javaring_free(pipeline->parsed);
+    javaring_free(pipeline->contexts);
+    g_array_free(pipeline->units, TRUE);
+    g_ptr_array_free(pipeline->files, TRUE);
+
+    if (stats != NULL) *stats = totals;
+}
+
+void javapipeline_free(JavaPipeline *pipeline)
+{
+    if (pipeline != NULL) {
+        g_ptr_array_free(pipeline->paths, TRUE);
+        g_free(pipeline);
+    }
+}
@@ -0,0 +1,191 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * Internal helpers shared between the modules of the library. This header
+ * is not installed.
+ */
+
+#ifndef __JAVAPRIVATE_H__
+#define __JAVAPRIVATE_H__
+
+#include <glib.h>
+
+#include "javaclass.h"
+
+// the newest class file version the parser and the validator support
+// (Java 25)
+#define MAX_MAJOR_VERSION 69
+
+/*
+ * Tags used to classify entries in the constant pool
+ */
+#define TAG_UTF8                1
+#define TAG_INTEGER             3
+#define TAG_FLOAT               4
+#define TAG_LONG                5
+#define TAG_DOUBLE              6
+#define TAG_CLASS               7
+#define TAG_STRING              8
+#define TAG_FIELDREF            9
+#define TAG_METHODREF          10
+#define TAG_INTERFACEMETHODREF 11
+#define TAG_NAMEANDTYPE        12
+
+/*
+ * Tags of newer class file versions: method handles and invokedynamic (51),
+ * modules (53) and dynamic constants (55)
+ */
+#define TAG_METHODHANDLE       15
+#define TAG_METHODTYPE         16
+#define TAG_DYNAMIC            17
+#define TAG_INVOKEDYNAMIC      18
+#define TAG_MODULE             19
+#define TAG_PACKAGE            20
+
+/*
+ * The attributes a JavaClass keeps, attribute_info._kind is one of these
+ */
+enum
+{
+    ATTRIBUTE_UNKNOWN,
+    ATTRIBUTE_CODE,
+    ATTRIBUTE_EXCEPTIONS,
+    ATTRIBUTE_SIGNATURE,
+    ATTRIBUTE_SOURCEFILE,
+    ATTRIBUTE_VISIBLE_ANNOTATIONS,
+    ATTRIBUTE_INVISIBLE_ANNOTATIONS,
+    ATTRIBUTE_CONSTANT_VALUE,
+    ATTRIBUTE_DEPRECATED,
+    ATTRIBUTE_INNER_CLASSES,
+    ATTRIBUTE_ANNOTATION_DEFAULT,
+    ATTRIBUTE_VISIBLE_PARAMETER_ANNOTATIONS,
+    ATTRIBUTE_INVISIBLE_PARAMETER_ANNOTATIONS,
+    ATTRIBUTE_ENCLOSING_METHOD,
+    ATTRIBUTE_SYNTHETIC,
+    ATTRIBUTE_BOOTSTRAP_METHODS,
+    ATTRIBUTE_NEST_HOST,
+    ATTRIBUTE_NEST_MEMBERS,
+    ATTRIBUTE_PERMITTED_SUBCLASSES,
+    ATTRIBUTE_RECORD,
+    ATTRIBUTE_MODULE,
+    ATTRIBUTE_MODULE_PACKAGES,
+    ATTRIBUTE_MODULE_MAIN_CLASS,
+    ATTRIBUTE_METHOD_PARAMETERS,
+    ATTRIBUTE_VISIBLE_TYPE_ANNOTATIONS,
+    ATTRIBUTE_INVISIBLE_TYPE_ANNOTATIONS,
+    ATTRIBUTE_KIND_COUNT
+};
+
+/*
+ * A simple bump allocator. Everything allocated from an arena is released at
+ * once by javaarena_reset() or javaarena_free().
+ */
+typedef struct _JavaArena JavaArena;
+
+/*
+ * Create a new arena whose first block holds at least block_size bytes
+ */
+JavaArena* javaarena_new(gsize block_size);
+
+/*
+ * Allocate size bytes from the arena (returns NULL for size 0 like g_malloc)
+ */
+gpointer javaarena_alloc(JavaArena *arena, gsize size);
+
+/*
+ * Release everything allocated from the arena but keep its memory around.
+ * If the arena had to grow since the last reset its blocks are merged into a
+ * single block, so a repeating workload stops allocating after a few rounds.
+ */
+void javaarena_reset(JavaArena *arena);
+
+/*
+ * Free the arena and all the memory allocated from it
+ */
+void javaarena_free(JavaArena *arena);
+
+/*
+ * A bounded multi-producer multi-consumer queue of pointers that doesn't
+ * take locks (Dmitry Vyukov's array queue)
+ */
+typedef struct _JavaRing JavaRing;
+
+/*
+ * Create a queue for at least capacity pointers
+ */
+JavaRing* javaring_new(guint capacity);
+
+/*
+ * Add a pointer, returns FALSE if the queue is full
+ */
+gboolean javaring_push(JavaRing *ring, gpointer data);
+
+/*
+ * Remove the oldest pointer, returns FALSE if the queue is empty
+ */
+gboolean javaring_pop(JavaRing *ring, gpointer *data);
+
+/*
+ * Wait a little longer on every call with the same counter: spin first,
+ * then yield and then sleep up to a millisecond
+ */
+void javaring_backoff(guint *attempts);
+
+/*
+ * Free a queue (the pointers in it are not freed)
+ */
+void javaring_free(JavaRing *ring);
+
+/*
+ * A fast 64 bit hash of a byte array (not suitable against attackers)
+ */
+guint64 javahash_bytes(const void *data, gsize length, guint64 seed);
+
+/*
+ * Hash what the constant with index i (counting from 1) resolves to, so the
+ * hash doesn't depend on the order of the constant pool. Class, string and
+ * reference constants are followed to the UTF-8 constants they name, an
+ * invalid index hashes like an empty constant.
+ */
+guint64 javahash_constant(JavaClass *c, guint16 i, guint64 seed);
+
+/*
+ * Parse a class from classbytes. If arena is not NULL all the memory of the
+ * new JavaClass object is taken from it. If bytes is not NULL it must hold
+ * classbytes and the class borrows its attributes and bytecode from it.
+ */
+JavaClass* javaclass_new_full(JavaArena *arena, GBytes *bytes,
+        guchar *classbytes, guint32 length, guint flags, GError **error);
+
+/*
+ * Return the UTF-8 constant pool entry with index i (counting from 0)
+ */
+gchar* javaclass_cp_string(JavaClass *c, guint16 i);
+
+/*
+ * Return the index of the first constant pool entry at or after start that
+ * has the given tag or -1 if there is none
+ */
+gint javaclass_cp_find_tag(JavaClass *c, guint8 tag, gint start);
+
+/*
+ * Return the ATTRIBUTE_* kind of an attribute name
+ */
+guint8 javaclass_attribute_kind(const gchar *name);
+
+#endif /* __JAVAPRIVATE_H__ */
@@ -0,0 +1,523 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "javareferences.h"
+#include "javaprivate.h"
+
+#define HASH_SEED  0x52454653        // the bits of a symbol
+#define BLOCK_SEED 0x424c4f43        // the block of a symbol
+
+#define BLOCK_SIZE  32             // bytes, 256 bits
+#define BITS_PER_SYMBOL 10         // about 1% false positives
+#define SIZE_CLASSES 6             // filters of 1, 2, 4, ... 32 blocks
+
+#define MAGIC "JREF"
+#define VERSION 2
+
+/*
+ * All filters of the same number of blocks
+ */
+typedef struct _filter_set
+{
+    GArray *ids;                   // guint32 id of the class of each filter
+    GByteArray *blocks;            // the filters back to back
+} filter_set;
+
+struct _JavaReferenceIndex
+{
+    GPtrArray *locations;
+    filter_set sets[SIZE_CLASSES];
+    GArray *symbols;               // scratch for the symbols of a class
+};
+
+/*
+ * A symbol is hashed twice, so that the block it goes to doesn't depend on
+ * the bits it sets in the block
+ */
+typedef struct _symbol
+{
+    guint64 hash;
+    guint64 block_hash;
+} symbol;
+
+/*
+ * Get the internal name of the class an array class is made of, so that
+ * "[[Ljava/lang/String;" becomes "java/lang/String" (returns FALSE for
+ * arrays of primitive types)
+ */
+static gboolean element_class(const gchar **name, gsize *len)
+{
+    const gchar *p = *name;
+
+    if (p[0] != '[') {
+        *len = strlen(p);
+        return TRUE;
+    }
+
+    while (*p == '[') p++;
+    if (*p != 'L') return FALSE;
+
+    *name = p + 1;
+    *len = strlen(p + 1);
+    if (*len > 0 && (*name)[*len - 1] == ';') (*len)--;
+
+    return TRUE;
+}
+
+static guint64 symbol_hash(const gchar *owner, gsize owner_len,
+        const gchar *member, guint64 seed)
+{
+    guint64 hash = javahash_bytes(owner, owner_len, seed);
+
+    if (member != NULL) hash = javahash_bytes(member, strlen(member), hash);
+
+    return hash;
+}
+
+static void make_symbol(symbol *sym, const gchar *owner, gsize owner_len,
+        const gchar *member)
+{
+    sym->hash = symbol_hash(owner, owner_len, member, HASH_SEED);
+    sym->block_hash = symbol_hash(owner, owner_len, member, BLOCK_SEED);
+}
+
+/*
+ * Set the 8 bits of a symbol in a block, one byte of the hash per bit
+ */
+static void symbol_mask(guint64 hash, guint8 mask[BLOCK_SIZE])
+{
+    memset(mask, 0, BLOCK_SIZE);
+
+    for (int i = 0; i < 8; i++) {
+        guint8 bit = (hash >> (i * 8)) & 0xff;
+        mask[bit / 8] |= 1 << (bit % 8);
+    }
+}
+
+/*
+ * The block of a filter a symbol goes to
+ */
+static guint32 symbol_block(const symbol *sym, guint32 n_blocks)
+{
+    return (guint32) (sym->block_hash >> 32) & (n_blocks - 1);
+}
+
+/*
+ * Is i a valid index of a constant of tag?
+ */
+static gboolean is_cp_index(JavaClass *c, guint16 i, guint8 tag)
+{
+    return i < c->constant_pool_count && c->cp_tags[i] == tag;
+}
+
+/*
+ * Get the name of the class a class constant refers to (or NULL)
+ */
+static const gchar* class_name(JavaClass *c, guint16 i)
+{
+    if (!is_cp_index(c, i, TAG_CLASS) ||
+            !is_cp_index(c, c->cp_values[i].index, TAG_UTF8))
+        return NULL;
+
+    return javaclass_cp_string(c, c->cp_values[i].index);
+}
+
+/*
+ * Get the owner and name of a field or method reference, returns FALSE if
+ * the constant isn't one or is malformed
+ */
+static gboolean member_ref(JavaClass *c, guint16 i, const gchar **owner,
+        const gchar **name)
+{
+    guint16 nat = 0;
+
+    if (c->cp_tags[i] != TAG_FIELDREF && c->cp_tags[i] != TAG_METHODREF &&
+            c->cp_tags[i] != TAG_INTERFACEMETHODREF)
+        return FALSE;
+
+    nat = c->cp_values[i].indexpair[1];
+    if (!is_cp_index(c, nat, TAG_NAMEANDTYPE) ||
+            !is_cp_index(c, c->cp_values[nat].indexpair[0], TAG_UTF8))
+        return FALSE;
+
+    *owner = class_name(c, c->cp_values[i].indexpair[0]);
+    *name = javaclass_cp_string(c, c->cp_values[nat].indexpair[0]);
+
+    return *owner != NULL;
+}
+
+gboolean javareferences_contains(JavaClass *c, const gchar *owner,
+        const gchar *member)
+{
+    gchar *internal = g_strdelimit(g_strdup(owner), ".", '/');
+    gboolean found = FALSE;
+
+    for (guint16 i = 0; i < c->constant_pool_count && !found; i++) {
+        const gchar *name = NULL;
+        const gchar *ref = NULL;
+        gsize len = 0;
+
+        if (member == NULL) {
+            name = c->cp_tags[i] == TAG_CLASS ? class_name(c, i) : NULL;
+        } else if (!member_ref(c, i, &name, &ref) ||
+                strcmp(ref, member) != 0) {
+            continue;
+        }
+
+        if (name == NULL || !element_class(&name, &len)) continue;
+
+        found = strlen(internal) == len && memcmp(internal, name, len) == 0;
+    }
+
+    g_free(internal);
+
+    return found;
+}
+
+JavaReferenceIndex* javareferenceindex_new(void)
+{
+    JavaReferenceIndex *index = g_new0(JavaReferenceIndex, 1);
+
+    index->locations = g_ptr_array_new_with_free_func(g_free);
+    index->symbols = g_array_new(FALSE, FALSE, sizeof(symbol));
+
+    for (int i = 0; i < SIZE_CLASSES; i++) {
+        index->sets[i].ids = g_array_new(FALSE, FALSE, sizeof(guint32));
+        index->sets[i].blocks = g_byte_array_new();
+    }
+
+    return index;
+}
+
+guint32 javareferenceindex_add_class(JavaReferenceIndex *index,
+        JavaClass *c, const gchar *location)
+{
+    guint32 id = index->locations->len;
+    guint32 n_symbols = 0;
+    guint32 size = 0;
+    filter_set *set = NULL;
+    guint8 *filter = NULL;
+
+    g_array_set_size(index->symbols, 0);
+
+    for (guint16 i = 0; i < c->constant_pool_count; i++) {
+        const gchar *owner = NULL;
+        const gchar *member = NULL;
+        gsize len = 0;
+        symbol sym;
+
+        if (c->cp_tags[i] == TAG_CLASS) {
+            owner = class_name(c, i);
+        } else if (!member_ref(c, i, &owner, &member)) {
+            continue;
+        }
+
+        if (owner == NULL || !element_class(&owner, &len)) continue;
+
+        make_symbol(&sym, owner, len, member);
+        g_array_append_val(index->symbols, sym);
+    }
+
+    // enough blocks for the number of symbols, up to the largest size
+    n_symbols = index->symbols->len;
+    while (size < SIZE_CLASSES - 1 &&
+            (BLOCK_SIZE * 8 << size) < n_symbols * BITS_PER_SYMBOL) {
+        size++;
+    }
+
+    set = &index->sets[size];
+    g_array_append_val(set->ids, id);
+    g_byte_array_set_size(set->blocks, set->blocks->len + (BLOCK_SIZE << size));
+    filter = set->blocks->data + set->blocks->len - (BLOCK_SIZE << size);
+    memset(filter, 0, BLOCK_SIZE << size);
+
+    for (guint32 i = 0; i < n_symbols; i++) {
+        symbol *sym = &g_array_index(index->symbols, symbol, i);
+        guint8 *block = filter + symbol_block(sym, 1 << size) * BLOCK_SIZE;
+        guint8 mask[BLOCK_SIZE];
+
+        symbol_mask(sym->hash, mask);
+        for (int j = 0; j < BLOCK_SIZE; j++) block[j] |= mask[j];
+    }
+
+    g_ptr_array_add(index->locations, g_strdup(location));
+
+    return id;
+}
+
+guint32 javareferenceindex_get_class_number(JavaReferenceIndex *index)
+{
+    return index->locations->len;
+}
+
+const gchar* javareferenceindex_get_location(JavaReferenceIndex *index,
+        guint32 id)
+{
+    g_return_val_if_fail(id < index->locations->len, NULL);
+
+    return g_ptr_array_index(index->locations, id);
+}
+
+/*
+ * Does a block have all the bits of the mask set?
+ */
+static inline gboolean block_matches(const guint8 *block, const guint8 *mask)
+{
+#ifdef __SSE2__
+    __m128i m0 = _mm_loadu_si128((const __m128i*) mask);
+    __m128i m1 = _mm_loadu_si128((const __m128i*) (mask + 16));
+    __m128i b0 = _mm_loadu_si128((const __m128i*) block);
+    __m128i b1 = _mm_loadu_si128((const __m128i*) (block + 16));
+    __m128i eq = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_and_si128(b0, m0), m0),
+            _mm_cmpeq_epi8(_mm_and_si128(b1, m1), m1));
+
+    return _mm_movemask_epi8(eq) == 0xffff;
+#else
+    for (int i = 0; i < BLOCK_SIZE; i += 8) {
+        guint64 b, m;
+
+        memcpy(&b, block + i, 8);
+        memcpy(&m, mask + i, 8);
+        if ((b & m) != m) return FALSE;
+    }
+
+    return TRUE;
+#endif
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+    guint32 x = *(const guint32*) a;
+    guint32 y = *(const guint32*) b;
+
+    return x < y ? -1 : x > y;
+}
+
+guint32* javareferenceindex_query(JavaReferenceIndex *index,
+        const gchar *owner, const gchar *member, guint *n_candidates)
+{
+    GArray *result = g_array_new(FALSE, FALSE, sizeof(guint32));
+    gchar *internal = g_strdelimit(g_strdup(owner), ".", '/');
+    const gchar *name = internal;
+    gsize len = 0;
+    symbol sym;
+    guint8 mask[BLOCK_SIZE];
+
+    if (!element_class(&name, &len)) {
+        g_free(internal);
+        *n_candidates = 0;
+        return (guint32*) g_array_free(result, FALSE);
+    }
+
+    make_symbol(&sym, name, len, member);
+    symbol_mask(sym.hash, mask);
+    g_free(internal);
+
+    // the mask is the same for all sizes, only the block differs
+    for (int size = 0; size < SIZE_CLASSES; size++) {
+        filter_set *set = &index->sets[size];
+        gsize stride = BLOCK_SIZE << size;
+        const guint8 *block = set->blocks->data +
+            symbol_block(&sym, 1 << size) * BLOCK_SIZE;
+
+        for (guint i = 0; i < set->ids->len; i++, block += stride) {
+            if (block_matches(block, mask)) {
+                g_array_append_val(result,
+                        g_array_index(set->ids, guint32, i));
+            }
+        }
+    }
+
+    if (result->len > 1) {
+        qsort(result->data, result->len, sizeof(guint32), compare_ids);
+    }
+
+    *n_candidates = result->len;
+
+    return (guint32*) g_array_free(result, FALSE);
+}
+
+/*
+ * Persistence, all numbers are little endian:
+ *
+ *   "JREF", u32 version, u32 number of classes,
+ *   for each class: u32 length, the location without a NUL,
+ *   for each size: u32 number of filters, their u32 ids, their blocks
+ */
+
+static void put_u32(GByteArray *array, guint32 value)
+{
+    value = GUINT32_TO_LE(value);
+    g_byte_array_append(array, (guint8*) &value, 4);
+}
+
+static guint32 get_u32(const guchar *p)
+{
+    guint32 value;
+    memcpy(&value, p, 4);
+    return GUINT32_FROM_LE(value);
+}
+
+gboolean javareferenceindex_save(JavaReferenceIndex *index,
+        const gchar *filename, GError **error)
+{
+    GByteArray *data = g_byte_array_new();
+    gboolean success = FALSE;
+
+    g_byte_array_append(data, (const guint8*) MAGIC, 4);
+    put_u32(data, VERSION);
+    put_u32(data, index->locations->len);
+
+    for (guint i = 0; i < index->locations->len; i++) {
+        const gchar *location = g_ptr_array_index(index->locations, i);
+        gsize len = strlen(location);
+
+        put_u32(data, len);
+        g_byte_array_append(data, (const guint8*) location, len);
+    }
+
+    for (int size = 0; size < SIZE_CLASSES; size++) {
+        filter_set *set = &index->sets[size];
+
+        put_u32(data, set->ids->len);
+        for (guint i = 0; i < set->ids->len; i++) {
+            put_u32(data, g_array_index(set->ids, guint32, i));
+        }
+
+        g_byte_array_append(data, set->blocks->data, set->blocks->len);
+    }
+
+    success = g_file_set_contents(filename, (const gchar*) data->data,
+            data->len, error);
+    g_byte_array_free(data, TRUE);
+
+    return success;
+}
+
+static JavaReferenceIndex* invalid_file(JavaReferenceIndex *index,
+        const gchar *filename, const gchar *reason, GError **error)
+{
+    g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_INVALID_ARCHIVE,
+            "Error reading reference index %s: %s\n", filename, reason);
+    javareferenceindex_free(index);
+    return NULL;
+}
+
+JavaReferenceIndex* javareferenceindex_load(const gchar *filename,
+        GError **error)
+{
+    JavaReferenceIndex *index = NULL;
+    gchar *contents = NULL;
+    const guchar *p = NULL;
+    gsize length = 0;
+    gsize offset = 12;
+    guint32 n_classes = 0;
+
+    if (!g_file_get_contents(filename, &contents, &length, error)) {
+        return NULL;
+    }
+
+    index = javareferenceindex_new();
+    p = (const guchar*) contents;
+
+    if (length < 12 || memcmp(p, MAGIC, 4) != 0) {
+        g_free(contents);
+        return invalid_file(index, filename, "Not a reference index", error);
+    }
+
+    if (get_u32(p + 4) != VERSION) {
+        g_free(contents);
+        return invalid_file(index, filename, "Unsupported version", error);
+    }
+
+    n_classes = get_u32(p + 8);
+
+    for (guint32 i = 0; i < n_classes; i++) {
+        guint32 len = 0;
+
+        if (length - offset < 4 || length - offset - 4 < get_u32(p + offset))
+            break;
+
+        len = get_u32(p + offset);
+        g_ptr_array_add(index->locations,
+                g_strndup((const gchar*) p + offset + 4, len));
+        offset += 4 + len;
+    }
+
+    for (int size = 0; size < SIZE_CLASSES &&
+            index->locations->len == n_classes; size++) {
+        filter_set *set = &index->sets[size];
+        gsize stride = BLOCK_SIZE << size;
+        guint32 count = 0;
+
+        if (length - offset < 4) break;
+        count = get_u32(p + offset);
+        offset += 4;
+
+        if (count > n_classes ||
+                (length - offset) / (4 + stride) < count) {
+            // marks the file as truncated
+            g_ptr_array_set_size(index->locations, 0);
+            break;
+        }
+
+        for (guint32 i = 0; i < count; i++, offset += 4) {
+            guint32 id = get_u32(p + offset);
+
+            if (id >= n_classes) break;
+            g_array_append_val(set->ids, id);
+        }
+
+        if (set->ids->len != count) {
+            g_ptr_array_set_size(index->locations, 0);
+            break;
+        }
+
+        g_byte_array_append(set->blocks, p + offset, count * stride);
+        offset += count * stride;
+    }
+
+    g_free(contents);
+
+    if (index->locations->len != n_classes || offset != length) {
+        return invalid_file(index, filename, "Truncated or corrupt", error);
+    }
+
+    return index;
+}
+
+void javareferenceindex_free(JavaReferenceIndex *index)
+{
+    if (index != NULL) {
+        for (int i = 0; i < SIZE_CLASSES; i++) {
+            g_array_free(index->sets[i].ids, TRUE);
+            g_byte_array_free(index->sets[i].blocks, TRUE);
+        }
+
+        g_ptr_array_free(index->locations, TRUE);
+        g_array_free(index->symbols, TRUE);
+        g_free(index);
+    }
+}
@@ -0,0 +1,138 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include "javaprivate.h"
+
+#define CACHE_LINE 64
+
+typedef struct _ring_cell
+{
+    gint sequence;
+    gpointer data;
+} ring_cell;
+
+/*
+ * The positions are on their own cache lines so producers and consumers
+ * don't fight over them
+ */
+struct _JavaRing
+{
+    ring_cell *cells;
+    guint mask;
+    gchar pad0[CACHE_LINE];
+    gint enqueue_pos;
+    gchar pad1[CACHE_LINE];
+    gint dequeue_pos;
+    gchar pad2[CACHE_LINE];
+};
+
+JavaRing* javaring_new(guint capacity)
+{
+    JavaRing *ring = g_new0(JavaRing, 1);
+    guint size = 2;
+
+    while (size < capacity) size *= 2;
+
+    ring->cells = g_new(ring_cell, size);
+    ring->mask = size - 1;
+
+    for (guint i = 0; i < size; i++) {
+        ring->cells[i].sequence = i;
+        ring->cells[i].data = NULL;
+    }
+
+    return ring;
+}
+
+gboolean javaring_push(JavaRing *ring, gpointer data)
+{
+    guint pos = g_atomic_int_get(&ring->enqueue_pos);
+    ring_cell *cell = NULL;
+
+    for (;;) {
+        gint diff = 0;
+
+        cell = &ring->cells[pos & ring->mask];
+        diff = (gint) ((guint) g_atomic_int_get(&cell->sequence) - pos);
+
+        if (diff == 0) {
+            // the cell is free, try to claim it
+            if (g_atomic_int_compare_and_exchange(&ring->enqueue_pos,
+                        (gint) pos, (gint) (pos + 1))) {
+                break;
+            }
+        } else if (diff < 0) {
+            return FALSE;
+        }
+
+        pos = g_atomic_int_get(&ring->enqueue_pos);
+    }
+
+    cell->data = data;
+    g_atomic_int_set(&cell->sequence, (gint) (pos + 1));
+
+    return TRUE;
+}
+
+gboolean javaring_pop(JavaRing *ring, gpointer *data)
+{
+    guint pos = g_atomic_int_get(&ring->dequeue_pos);
+    ring_cell *cell = NULL;
+
+    for (;;) {
+        gint diff = 0;
+
+        cell = &ring->cells[pos & ring->mask];
+        diff = (gint) ((guint) g_atomic_int_get(&cell->sequence) - (pos + 1));
+
+        if (diff == 0) {
+            // the cell is filled, try to claim it
+            if (g_atomic_int_compare_and_exchange(&ring->dequeue_pos,
+                        (gint) pos, (gint) (pos + 1))) {
+                break;
+            }
+        } else if (diff < 0) {
+            return FALSE;
+        }
+
+        pos = g_atomic_int_get(&ring->dequeue_pos);
+    }
+
+    *data = cell->data;
+    g_atomic_int_set(&cell->sequence, (gint) (pos + ring->mask + 1));
+
+    return TRUE;
+}
+
+void javaring_backoff(guint *attempts)
+{
+    if (*attempts >= 64) {
+        g_usleep(MIN((*attempts - 63) * 10, 1000));
+    } else if (*attempts >= 16) {
+        g_thread_yield();
+    }
+
+    (*attempts)++;
+}
+
+void javaring_free(JavaRing *ring)
+{
+    if (ring != NULL) {
+        g_free(ring->cells);
+        g_free(ring);
+    }
+}
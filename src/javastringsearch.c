@@ -0,0 +1,399 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "javastringsearch.h"
+#include "javaclass.h"
+#include "javaprivate.h"
+
+/*
+ * Up to this many distinct first bytes are compared with SIMD, for more the
+ * scalar bigram loop is faster
+ */
+#define MAX_SIMD_FIRST_BYTES 8
+
+#define NO_PATTERN G_MAXUINT
+
+struct _JavaStringSearch
+{
+    guint n_patterns;
+    gchar **patterns;
+    gsize *lengths;
+    guint *next;              // next pattern in the same bucket
+
+    guint8 first[256];        // is this byte the first byte of a pattern?
+    guint single[256];        // one byte patterns by their byte
+    guint32 bigrams[65536 / 32]; // bitset of the first two bytes of patterns
+    GHashTable *buckets;      // first two bytes -> first pattern
+
+    guint n_first;
+    guint8 first_bytes[MAX_SIMD_FIRST_BYTES];
+};
+
+/*
+ * Per thread scratch memory for the constant pool offsets, so scanning
+ * doesn't allocate once it has seen the largest constant pool
+ */
+typedef struct _scan_scratch
+{
+    guint32 size;
+    guint32 *utf8;    // offset of the length of each UTF-8 entry or 0
+    guint32 *strings; // pairs of String entry and UTF-8 entry
+} scan_scratch;
+
+static void scratch_free(gpointer data)
+{
+    scan_scratch *scratch = data;
+
+    if (scratch != NULL) {
+        g_free(scratch->utf8);
+        g_free(scratch->strings);
+        g_free(scratch);
+    }
+}
+
+static GPrivate scratch_key = G_PRIVATE_INIT(scratch_free);
+
+static scan_scratch* get_scratch(guint32 count)
+{
+    scan_scratch *scratch = g_private_get(&scratch_key);
+
+    if (scratch == NULL) {
+        scratch = g_new0(scan_scratch, 1);
+        g_private_set(&scratch_key, scratch);
+    }
+
+    if (scratch->size < count) {
+        g_free(scratch->utf8);
+        g_free(scratch->strings);
+        scratch->size = count;
+        scratch->utf8 = g_new(guint32, count);
+        scratch->strings = g_new(guint32, count * 2);
+    }
+
+    return scratch;
+}
+
+#define BIGRAM(a, b) ((((guint) (a)) << 8) | (guint) (b))
+
+JavaStringSearch* javastringsearch_new(const gchar **patterns)
+{
+    JavaStringSearch *search = NULL;
+    guint n = 0;
+
+    while (patterns[n] != NULL) {
+        g_return_val_if_fail(patterns[n][0] != '\0', NULL);
+        n++;
+    }
+
+    search = g_new0(JavaStringSearch, 1);
+
+    search->n_patterns = n;
+    search->patterns = g_new(gchar*, n);
+    search->lengths = g_new(gsize, n);
+    search->next = g_new(guint, n);
+    search->buckets = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    for (int i = 0; i < 256; i++) search->single[i] = NO_PATTERN;
+
+    // insert in reverse so that the buckets list the patterns in order
+    for (guint i = n; i-- > 0;) {
+        const guchar *p = (const guchar*) patterns[i];
+
+        search->patterns[i] = g_strdup(patterns[i]);
+        search->lengths[i] = strlen(patterns[i]);
+        search->first[p[0]] = 1;
+
+        if (p[1] == '\0') {
+            search->next[i] = search->single[p[0]];
+            search->single[p[0]] = i;
+        } else {
+            guint key = BIGRAM(p[0], p[1]);
+            gpointer head = g_hash_table_lookup(search->buckets,
+                    GUINT_TO_POINTER(key + 1));
+
+            search->next[i] = head != NULL ? GPOINTER_TO_UINT(head) - 1 :
+                NO_PATTERN;
+            g_hash_table_insert(search->buckets, GUINT_TO_POINTER(key + 1),
+                    GUINT_TO_POINTER(i + 1));
+            search->bigrams[key / 32] |= 1U << (key % 32);
+        }
+    }
+
+    for (int b = 0; b < 256; b++) {
+        if (!search->first[b]) continue;
+
+        if (search->n_first < MAX_SIMD_FIRST_BYTES)
+            search->first_bytes[search->n_first] = b;
+        search->n_first++;
+    }
+
+    return search;
+}
+
+/*
+ * Verify the patterns that may start at a candidate position
+ */
+static void verify(JavaStringSearch *search, const guchar *str, guint32 len,
+        guint32 pos, const gchar *location, guint16 cp_index,
+        JavaStringMatchFunc func, gpointer user_data)
+{
+    guint i = search->single[str[pos]];
+
+    for (; i != NO_PATTERN; i = search->next[i]) {
+        func(location, cp_index, pos, i, user_data);
+    }
+
+    if (pos + 1 >= len) return;
+
+    {
+        guint key = BIGRAM(str[pos], str[pos + 1]);
+        gpointer head = NULL;
+
+        if (!(search->bigrams[key / 32] & (1U << (key % 32)))) return;
+
+        head = g_hash_table_lookup(search->buckets, GUINT_TO_POINTER(key + 1));
+
+        for (i = GPOINTER_TO_UINT(head) - 1; i != NO_PATTERN;
+                i = search->next[i]) {
+            if (search->lengths[i] <= len - pos &&
+                    memcmp(str + pos, search->patterns[i],
+                        search->lengths[i]) == 0) {
+                func(location, cp_index, pos, i, user_data);
+            }
+        }
+    }
+}
+
+/*
+ * Search one string, available is the number of readable bytes at str which
+ * may be larger than len
+ */
+static void search_string(JavaStringSearch *search, const guchar *str,
+        guint32 len, guint32 available, const gchar *location,
+        guint16 cp_index, JavaStringMatchFunc func, gpointer user_data)
+{
+    guint32 pos = 0;
+
+    // without patterns there are no needles to compare with
+    if (search->n_first == 0) return;
+
+#ifdef __SSE2__
+    if (search->n_first <= MAX_SIMD_FIRST_BYTES) {
+        __m128i needles[MAX_SIMD_FIRST_BYTES];
+
+        for (guint i = 0; i < search->n_first; i++) {
+            needles[i] = _mm_set1_epi8((char) search->first_bytes[i]);
+        }
+
+        // 16 bytes at a time as long as we can load them from the buffer
+        for (; pos < len && pos + 16 <= available; pos += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*) (str + pos));
+            __m128i hits = _mm_cmpeq_epi8(block, needles[0]);
+            guint mask = 0;
+
+            for (guint i = 1; i < search->n_first; i++) {
+                hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[i]));
+            }
+
+            mask = _mm_movemask_epi8(hits);
+            // ignore the bytes after the end of the string
+            if (len - pos < 16) mask &= (1U << (len - pos)) - 1;
+
+            while (mask != 0) {
+                guint bit = __builtin_ctz(mask);
+                verify(search, str, len, pos + bit, location, cp_index, func,
+                        user_data);
+                mask &= mask - 1;
+            }
+        }
+    }
+#endif
+
+    for (; pos < len; pos++) {
+        if (search->first[str[pos]]) {
+            verify(search, str, len, pos, location, cp_index, func,
+                    user_data);
+        }
+    }
+}
+
+static guint16 read_u16(const guchar *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+gboolean javastringsearch_scan(JavaStringSearch *search,
+        const guchar *classbytes, guint32 length, const gchar *location,
+        JavaStringMatchFunc func, gpointer user_data, GError **error)
+{
+    scan_scratch *scratch = NULL;
+    guint32 offset = 10;
+    guint32 n_strings = 0;
+    guint16 count = 0;
+
+    if (length < 10 || read_u16(classbytes) != 0xCAFE ||
+            read_u16(classbytes + 2) != 0xBABE) {
+        g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_TAG_UNKNOWN,
+                "Error parsing class file: File is not a valid CLASS file!\n");
+        return FALSE;
+    }
+
+    count = read_u16(classbytes + 8);
+    scratch = get_scratch(count);
+
+    for (guint i = 1; i < count; i++) {
+        guint32 size = 0;
+
+        scratch->utf8[i] = 0;
+
+        if (offset >= length) {
+            g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_TAG_UNKNOWN,
+                    "Error parsing class file: Truncated constant pool\n");
+            return FALSE;
+        }
+
+        switch (classbytes[offset]) {
+            case TAG_UTF8:
+                if (offset + 3 > length) break;
+                scratch->utf8[i] = offset + 1;
+                size = 3 + read_u16(classbytes + offset + 1);
+                break;
+            case TAG_STRING:
+                if (offset + 3 > length) break;
+                scratch->strings[n_strings * 2] = i;
+                scratch->strings[n_strings * 2 + 1] =
+                    read_u16(classbytes + offset + 1);
+                n_strings++;
+                size = 3;
+                break;
+            case TAG_CLASS:
+            case TAG_METHODTYPE:
+            case TAG_MODULE:
+            case TAG_PACKAGE:
+                size = 3;
+                break;
+            case TAG_METHODHANDLE:
+                size = 4;
+                break;
+            case TAG_INTEGER:
+            case TAG_FLOAT:
+            case TAG_FIELDREF:
+            case TAG_METHODREF:
+            case TAG_INTERFACEMETHODREF:
+            case TAG_NAMEANDTYPE:
+            case TAG_DYNAMIC:
+            case TAG_INVOKEDYNAMIC:
+                size = 5;
+                break;
+            case TAG_LONG:
+            case TAG_DOUBLE:
+                // take two slots
+                size = 9;
+                if (i + 1 < count) scratch->utf8[++i] = 0;
+                break;
+            default:
+                g_set_error(error, JAVACLASS_GERROR,
+                        JAVACLASS_ERROR_TAG_UNKNOWN,
+                        "Error parsing class file: Unknown constant pool tag %d\n",
+                        classbytes[offset]);
+                return FALSE;
+        }
+
+        if (size == 0 || offset + size > length) {
+            g_set_error(error, JAVACLASS_GERROR, JAVACLASS_ERROR_TAG_UNKNOWN,
+                    "Error parsing class file: Truncated constant pool\n");
+            return FALSE;
+        }
+
+        offset += size;
+    }
+
+    for (guint32 i = 0; i < n_strings; i++) {
+        guint16 cp_index = scratch->strings[i * 2];
+        guint16 target = scratch->strings[i * 2 + 1];
+        guint32 pos = 0;
+
+        if (target == 0 || target >= count || scratch->utf8[target] == 0)
+            continue;
+
+        pos = scratch->utf8[target];
+        search_string(search, classbytes + pos + 2,
+                read_u16(classbytes + pos), length - pos - 2, location,
+                cp_index, func, user_data);
+    }
+
+    return TRUE;
+}
+
+guint javastringsearch_scan_archive(JavaStringSearch *search,
+        JavaArchive *archive, JavaStringMatchFunc func, gpointer user_data)
+{
+    GString *location = g_string_new(javaarchive_get_filename(archive));
+    gsize prefix = 0;
+    guint scanned = 0;
+
+    g_string_append_c(location, '!');
+    prefix = location->len;
+
+    for (guint i = 0; i < javaarchive_get_entry_count(archive); i++) {
+        const JavaArchiveEntry *entry = javaarchive_get_entry(archive, i);
+        GBytes *bytes = NULL;
+        gsize length = 0;
+        const guchar *data = NULL;
+
+        if (!javaarchive_entry_is_class(entry)) continue;
+
+        bytes = javaarchive_read_entry(archive, entry, NULL);
+        if (bytes == NULL) continue;
+
+        g_string_truncate(location, prefix);
+        g_string_append(location, entry->name);
+
+        data = g_bytes_get_data(bytes, &length);
+        if (javastringsearch_scan(search, data, length, location->str, func,
+                    user_data, NULL)) {
+            scanned++;
+        }
+
+        g_bytes_unref(bytes);
+    }
+
+    g_string_free(location, TRUE);
+
+    return scanned;
+}
+
+void javastringsearch_free(JavaStringSearch *search)
+{
+    if (search != NULL) {
+        for (guint i = 0; i < search->n_patterns; i++) {
+            g_free(search->patterns[i]);
+        }
+
+        g_free(search->patterns);
+        g_free(search->lengths);
+        g_free(search->next);
+        g_hash_table_destroy(search->buckets);
+        g_free(search);
+    }
+}
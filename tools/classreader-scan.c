@@ -0,0 +1,327 @@
+/*
+The MIT License (MIT) 
+Copyright (c) 2009,2010,2016 Andreas Heck <aheck@gmx.de>
+
+Permission to use, copy, modify, and/or distribute this software for any
+purpose with or without fee is hereby granted, provided that the above
+copyright notice and this permission notice appear in all copies.
+
+THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+*/
+
+/*
+ * classreader-scan: parse all classes in directories and archives in
+ * parallel and write a summary of every class as JSON Lines or as a column
+ * file (see javacolumns.h), or statistics of the bytecode of all classes as
+ * JSON (see javacodestats.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "javaclass.h"
+#include "javacodestats.h"
+#include "javacolumns.h"
+#include "javapipeline.h"
+
+typedef struct _scan_state
+{
+    FILE *out;
+    JavaColumnWriter *columns;
+    JavaCodeStats *codestats;
+    GString *line;
+    gboolean failed;
+} scan_state;
+
+static gint jobs = 0;
+static gchar *format = NULL;
+static gchar *output = NULL;
+static gboolean quiet = FALSE;
+static gchar **paths = NULL;
+
+static GOptionEntry entries[] = {
+    {"jobs", 'j', 0, G_OPTION_ARG_INT, &jobs,
+        "Number of parser threads (default: number of CPUs)", "N"},
+    {"format", 'f', 0, G_OPTION_ARG_STRING, &format,
+        "Output format: jsonl (default), columns or codestats", "FORMAT"},
+    {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+        "Write the output to FILE (required for columns)", "FILE"},
+    {"quiet", 'q', 0, G_OPTION_ARG_NONE, &quiet,
+        "Don't print throughput statistics", NULL},
+    {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &paths, NULL,
+        "PATH..."},
+    {NULL}
+};
+
+/*
+ * Append a string as a JSON string literal
+ */
+static void append_json_string(GString *line, const gchar *string)
+{
+    g_string_append_c(line, '"');
+
+    for (const guchar *p = (const guchar*) string; p != NULL && *p; p++) {
+        switch (*p) {
+            case '"':
+                g_string_append(line, "\\\"");
+                break;
+            case '\\':
+                g_string_append(line, "\\\\");
+                break;
+            case '\n':
+                g_string_append(line, "\\n");
+                break;
+            case '\t':
+                g_string_append(line, "\\t");
+                break;
+            default:
+                if (*p < 0x20) {
+                    g_string_append_printf(line, "\\u%04x", *p);
+                } else {
+                    g_string_append_c(line, *p);
+                }
+        }
+    }
+
+    g_string_append_c(line, '"');
+}
+
+static void write_json(scan_state *state, const gchar *location, JavaClass *c,
+        const GError *error)
+{
+    GString *line = state->line;
+
+    g_string_truncate(line, 0);
+    g_string_append(line, "{\"location\":");
+    append_json_string(line, location);
+
+    if (c == NULL) {
+        // the messages of the library end with a newline
+        gchar *message = g_strstrip(g_strdup(error->message));
+
+        g_string_append(line, ",\"error\":");
+        append_json_string(line, message);
+        g_string_append(line, "}\n");
+        g_free(message);
+        fputs(line->str, state->out);
+        return;
+    }
+
+    g_string_append(line, ",\"name\":");
+    append_json_string(line, javaclass_get_fq_name(c));
+
+    g_string_append(line, ",\"parent\":");
+    if (javaclass_get_fq_parent(c) != NULL) {
+        append_json_string(line, javaclass_get_fq_parent(c));
+    } else {
+        g_string_append(line, "null");
+    }
+
+    g_string_append(line, ",\"interfaces\":[");
+    for (guint16 i = 0; i < javaclass_get_interface_number(c); i++) {
+        if (i > 0) g_string_append_c(line, ',');
+        append_json_string(line, javaclass_get_interfaces(c)[i]);
+    }
+
+    g_string_append(line, "],\"version\":");
+    append_json_string(line, javaclass_get_version_name(c));
+    g_string_append_printf(line, ",\"fields\":%u,\"methods\":%u}\n",
+            javaclass_get_field_number(c), javaclass_get_method_number(c));
+
+    fputs(line->str, state->out);
+}
+
+static void consume(const gchar *location, JavaClass *c, const GError *error,
+        gpointer user_data)
+{
+    scan_state *state = user_data;
+    GError *suberror = NULL;
+
+    if (state->columns == NULL && state->codestats == NULL) {
+        write_json(state, location, c, error);
+        return;
+    }
+
+    if (c == NULL) {
+        fprintf(stderr, "%s: %s", location, error->message);
+        return;
+    }
+
+    if (state->columns != NULL && !state->failed &&
+            javacolumnwriter_add_class(state->columns, c, &suberror) < 0) {
+        fprintf(stderr, "%s", suberror->message);
+        g_error_free(suberror);
+        state->failed = TRUE;
+    }
+}
+
+static void write_histogram(GString *json, const gchar *name,
+        const guint64 *buckets)
+{
+    g_string_append_printf(json, ",\"%s\":[", name);
+
+    for (guint i = 0; i < JAVACODESTATS_BUCKET_COUNT; i++) {
+        g_string_append_printf(json, "%s%" G_GUINT64_FORMAT, i > 0 ? "," : "",
+                buckets[i]);
+    }
+
+    g_string_append_c(json, ']');
+}
+
+static void write_codestats(scan_state *state)
+{
+    JavaCodeStats *stats = state->codestats;
+    GString *json = state->line;
+    gboolean first = TRUE;
+
+    g_string_truncate(json, 0);
+    g_string_append_printf(json, "{\"classes\":%" G_GUINT64_FORMAT
+            ",\"methods\":%" G_GUINT64_FORMAT
+            ",\"invalid_methods\":%" G_GUINT64_FORMAT
+            ",\"instructions\":%" G_GUINT64_FORMAT
+            ",\"code_bytes\":%" G_GUINT64_FORMAT
+            ",\"exception_handlers\":%" G_GUINT64_FORMAT,
+            stats->classes, stats->methods, stats->invalid_methods,
+            stats->instructions, stats->code_bytes,
+            stats->exception_handlers);
+
+    // opcodes that occur as {"name":[instructions,methods]}
+    g_string_append(json, ",\"opcodes\":{");
+    for (guint i = 0; i < JAVABYTECODE_OPCODE_COUNT; i++) {
+        if (stats->opcodes[i] == 0) continue;
+
+        g_string_append_printf(json, "%s\"%s\":[%" G_GUINT64_FORMAT ",%"
+                G_GUINT64_FORMAT "]", first ? "" : ",",
+                javabytecode_get_opcode_name(i), stats->opcodes[i],
+                stats->methods_using[i]);
+        first = FALSE;
+    }
+    g_string_append_c(json, '}');
+
+    write_histogram(json, "code_sizes", stats->code_sizes);
+    write_histogram(json, "max_stack", stats->max_stack);
+    write_histogram(json, "max_locals", stats->max_locals);
+    g_string_append(json, "}\n");
+
+    fputs(json->str, state->out);
+}
+
+int main(int argc, char *argv[])
+{
+    GOptionContext *context = NULL;
+    GError *error = NULL;
+    JavaPipeline *pipeline = NULL;
+    JavaPipelineStats stats;
+    JavaCodeStats codestats;
+    scan_state state = {stdout, NULL, NULL, NULL, FALSE};
+    gint64 start = 0;
+    gdouble seconds = 0;
+    int status = EXIT_SUCCESS;
+
+    context = g_option_context_new("- summarize Java classes");
+    g_option_context_set_summary(context,
+            "Parses all classes in the given directories, JAR files and class "
+            "files in parallel.");
+    g_option_context_add_main_entries(context, entries, NULL);
+
+    if (!g_option_context_parse(context, &argc, &argv, &error)) {
+        fprintf(stderr, "%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free(context);
+
+    if (paths == NULL) {
+        fprintf(stderr, "No paths given, see --help\n");
+        return EXIT_FAILURE;
+    }
+
+    if (jobs <= 0) jobs = g_get_num_processors();
+
+    if (format != NULL && strcmp(format, "columns") == 0) {
+        if (output == NULL) {
+            fprintf(stderr, "The columns format needs --output\n");
+            return EXIT_FAILURE;
+        }
+
+        state.columns = javacolumnwriter_new(output, &error);
+        if (state.columns == NULL) {
+            fprintf(stderr, "%s", error->message);
+            return EXIT_FAILURE;
+        }
+    } else if (format != NULL && strcmp(format, "codestats") != 0 &&
+            strcmp(format, "jsonl") != 0) {
+        fprintf(stderr, "Unknown format %s\n", format);
+        return EXIT_FAILURE;
+    } else if (output != NULL) {
+        state.out = fopen(output, "w");
+        if (state.out == NULL) {
+            perror(output);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (format != NULL && strcmp(format, "codestats") == 0) {
+        javacodestats_init(&codestats);
+        state.codestats = &codestats;
+    }
+
+    state.line = g_string_sized_new(1024);
+
+    // reading is mostly waiting for I/O, so a few readers feed all parsers
+    pipeline = javapipeline_new(MAX(jobs / 4, 1), jobs, jobs * 64);
+    for (int i = 0; paths[i] != NULL; i++) {
+        javapipeline_add_path(pipeline, paths[i]);
+    }
+
+    // the column file has the code sizes of the methods
+    javapipeline_set_include_code(pipeline, state.columns != NULL);
+
+    start = g_get_monotonic_time();
+    if (state.codestats != NULL) {
+        javacodestats_collect(state.codestats, pipeline, consume, &state,
+                &stats);
+        write_codestats(&state);
+    } else {
+        javapipeline_run(pipeline, consume, &state, &stats);
+    }
+    seconds = (g_get_monotonic_time() - start) / 1e6;
+    javapipeline_free(pipeline);
+
+    if (state.columns != NULL) {
+        if (!javacolumnwriter_close(state.columns, &error)) {
+            fprintf(stderr, "%s", error->message);
+            g_error_free(error);
+            state.failed = TRUE;
+        }
+    } else if (fflush(state.out) != 0 ||
+            (state.out != stdout && fclose(state.out) != 0)) {
+        perror(output != NULL ? output : "stdout");
+        state.failed = TRUE;
+    }
+
+    if (!quiet) {
+        fprintf(stderr, "%u classes, %u errors, %.1f MB in %.3f s: "
+                "%.0f classes/s, %.1f MB/s (%d jobs)\n",
+                stats.classes, stats.errors, stats.bytes / 1e6, seconds,
+                seconds > 0 ? stats.classes / seconds : 0,
+                seconds > 0 ? stats.bytes / 1e6 / seconds : 0, jobs);
+    }
+
+    if (state.failed || stats.errors > 0) status = EXIT_FAILURE;
+
+    g_string_free(state.line, TRUE);
+    g_strfreev(paths);
+    g_free(format);
+    g_free(output);
+
+    return status;
+}